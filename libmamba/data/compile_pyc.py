@@ -9,6 +9,17 @@ def main():
     if max_workers <= 0:
         max_workers = None
 
+    if max_workers == 1:
+        # Compile in this process, parallelism is handled by running multiple workers
+        success = True
+        with sys.stdin:
+            while True:
+                name = sys.stdin.readline().strip()
+                if not name:
+                    break
+                success = compile_file(name, quiet=1) and success
+        return success
+
     results = []
     with sys.stdin:
         with ProcessPoolExecutor(max_workers=max_workers) as executor:
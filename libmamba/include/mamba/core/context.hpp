@@ -8,6 +8,7 @@
 #define MAMBA_CORE_CONTEXT_HPP
 
 #include <map>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -60,6 +61,11 @@ namespace mamba
     class Logger;
     class Context;
 
+    namespace download
+    {
+        class CURLConnectionPool;
+    }
+
     std::string env_name(const Context& context, const fs::u8path& prefix);
     std::string env_name(const Context& context);
 
@@ -93,6 +99,11 @@ namespace mamba
             int retry_backoff{ 3 };  // retry_timeout * retry_backoff
             int max_retries{ 3 };    // max number of retries
 
+            // Download scheduler budgets, 0 means unlimited
+            std::size_t max_host_connections{ 0 };
+            std::size_t max_download_speed{ 0 };       // bytes per second, all hosts
+            std::size_t max_host_download_speed{ 0 };  // bytes per second, per host
+
             std::map<std::string, std::string> proxy_servers;
         };
 
@@ -161,6 +172,8 @@ namespace mamba
         bool auto_activate_base = false;
 
         bool extract_sparse = false;
+        bool extract_batched_writes = false;
+        bool extract_to_content_store = false;
 
         bool dev = false;  // TODO this is always used as default=false and isn't set anywhere => to
                            // be removed if this is the case...
@@ -259,6 +272,9 @@ namespace mamba
         void set_verbosity(int lvl);
         void set_log_level(log_level level);
 
+        /** The curl handles kept alive between the downloads made with this context. */
+        const download::CURLConnectionPool& curl_connection_pool() const;
+
         Context(const ContextOptions& options = {});
         ~Context();
 
@@ -279,6 +295,8 @@ namespace mamba
 
         TaskSynchronizer tasksync;
 
+        std::shared_ptr<download::CURLConnectionPool> m_curl_connection_pool;
+
 
         // Enables the provided context setup signal handling.
         // This function must be called only for one Context in the lifetime of the program.
@@ -289,6 +307,13 @@ namespace mamba
         void enable_logging();
     };
 
+    /**
+     * The number of threads for local work, such as extracting, linking, or removing files.
+     *
+     * It follows the ``extract_threads`` semantic: a positive value is the number of threads,
+     * zero is the host concurrency, and a negative value is subtracted from it.
+     */
+    [[nodiscard]] auto local_threads_count(const Context::ThreadsParams& params) -> std::size_t;
 
 }  // namespace mamba
 
@@ -44,6 +44,15 @@ namespace mamba
          */
         void rename_or_move(const fs::u8path& from, const fs::u8path& to, std::error_code& ec);
 
+        /**
+         * Copy a file and its permissions to a path that does not exist yet.
+         *
+         * On Linux, the data is copied in the kernel: the copy first shares the blocks of
+         * ``from`` (reflink, on btrfs or XFS for instance), then falls back to
+         * ``copy_file_range``, and finally to a copy through a large buffer.
+         * Elsewhere, and for files that are not regular files, this is ``fs::copy``.
+         */
+        void copy_file(const fs::u8path& from, const fs::u8path& to, std::error_code& ec);
     }
 }
 #endif
@@ -55,8 +55,6 @@ namespace mamba
 
     private:
 
-        bool unlink_path(const nlohmann::json& path_data);
-
         specs::PackageInfo m_pkg_info;
         fs::u8path m_cache_path;
         std::string m_specifier;
@@ -79,7 +77,10 @@ namespace mamba
     private:
 
         std::tuple<std::string, std::string> link_path(const PathData& path_data, bool noarch_python);
-        std::vector<fs::u8path> compile_pyc_files(const std::vector<fs::u8path>& py_files);
+        std::vector<fs::u8path> compile_pyc_files(
+            const std::vector<fs::u8path>& py_files,
+            const std::vector<std::string>& py_sources
+        );
         auto
         create_python_entry_point(const fs::u8path& path, const python_entry_point_parsed& entry_point);
         void create_application_entry_point(
@@ -27,10 +27,24 @@ namespace mamba
         mamba_exe,
     };
 
+    // Determine how the extracted files are written to disk.
+    enum class extract_write_mode
+    {
+        /** Every entry is written sequentially by libarchive. */
+        sequential,
+        /** Small regular files are created and written concurrently, in batches. */
+        batched,
+    };
+
     struct ExtractOptions
     {
         bool sparse = false;
         extract_subproc_mode subproc_mode;
+        extract_write_mode write_mode = extract_write_mode::sequential;
+        /** Number of threads writing the files in batched mode. */
+        std::size_t write_threads = 1;
+        /** Hard link the extracted files to the content store of the package cache. */
+        bool content_store = false;
         static ExtractOptions from_context(const Context&);
     };
 
@@ -73,6 +87,14 @@ namespace mamba
     void
     extract_subproc(const fs::u8path& file, const fs::u8path& dest, const ExtractOptions& options);
 
+    bool transmute(
+        const fs::u8path& pkg_file,
+        const fs::u8path& target,
+        int compression_level,
+        int compression_threads
+    );
+
+    [[deprecated("since version 2.0 use the overload without ``ExtractOptions``")]]
     bool transmute(
         const fs::u8path& pkg_file,
         const fs::u8path& target,
@@ -0,0 +1,46 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#ifndef MAMBA_CORE_PACKAGE_STORE_HPP
+#define MAMBA_CORE_PACKAGE_STORE_HPP
+
+#include <cstddef>
+
+#include "mamba/fs/filesystem.hpp"
+
+namespace mamba
+{
+    /**
+     * The content-addressed store of a package cache.
+     *
+     * Files of extracted packages are hard links to the store entries, named after their
+     * sha256 and permissions, so that identical files are stored once per package cache.
+     */
+    [[nodiscard]] auto content_store_path(const fs::u8path& pkgs_dir) -> fs::u8path;
+
+    /**
+     * Replace the files of an extracted package by hard links into a content store.
+     *
+     * Regular files listed in ``info/paths.json`` with a sha256 are linked to the store entry
+     * with the same content, or added to the store when there is none.
+     * The sha256 of a file is verified before it is added to the store.
+     * Files that cannot be hard linked (e.g. across file systems) are left untouched.
+     *
+     * @return The number of bytes that are no longer duplicated on disk.
+     */
+    auto deduplicate_package_files(const fs::u8path& extracted_dir, const fs::u8path& store_dir)
+        -> std::size_t;
+
+    /**
+     * Remove the entries of a content store that are not linked by any package anymore.
+     *
+     * @return The number of bytes freed, or that would be freed on a dry run.
+     */
+    auto collect_content_store_garbage(const fs::u8path& store_dir, bool dry_run = false)
+        -> std::size_t;
+}
+
+#endif
@@ -9,6 +9,7 @@
 
 #include <map>
 #include <string>
+#include <utility>
 
 #include "mamba/core/error_handling.hpp"
 #include "mamba/core/history.hpp"
@@ -24,8 +25,28 @@ namespace mamba
 
         using package_map = std::map<std::string, specs::PackageInfo>;
 
-        static expected_t<PrefixData>
-        create(const fs::u8path& prefix_path, ChannelContext& channel_context);
+        /**
+         * Load the packages installed in a prefix.
+         *
+         * The ``conda-meta`` records are read in parallel by up to ``threads_count`` threads,
+         * usually given by ``local_threads_count``.
+         */
+        static expected_t<PrefixData> create(
+            const fs::u8path& prefix_path,
+            ChannelContext& channel_context,
+            std::size_t threads_count = 1
+        );
+
+        /**
+         * Update the prefix index after the ``conda-meta`` records have changed.
+         *
+         * The index caches the package metadata of the records, and only the records that
+         * changed are read again.
+         * It must be called while holding the lock of the prefix, since loading a prefix
+         * only reads the index and never updates it.
+         * Failures are logged and otherwise ignored, since the index is only a cache.
+         */
+        static void refresh_index(const fs::u8path& prefix_path, std::size_t threads_count = 1);
 
         void add_packages(const std::vector<specs::PackageInfo>& packages);
         const package_map& records() const;
@@ -42,10 +63,19 @@ namespace mamba
 
     private:
 
-        PrefixData(const fs::u8path& prefix_path, ChannelContext& channel_context);
+        PrefixData(
+            const fs::u8path& prefix_path,
+            ChannelContext& channel_context,
+            std::size_t threads_count
+        );
+
+        /** Add a record read from ``conda-meta``, resolving its channel to a platform URL. */
+        void add_record(specs::PackageInfo&& prec);
 
         History m_history;
         package_map m_package_records;
+        // Resolved platform URL for each pair of channel and platform found in records
+        std::map<std::pair<std::string, std::string>, std::string> m_channel_urls;
         fs::u8path m_prefix_path;
 
         ChannelContext& m_channel_context;
@@ -9,6 +9,8 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <nlohmann/json_fwd.hpp>
 
@@ -200,6 +202,21 @@ namespace mamba
     std::string cache_fn_url(const std::string& url);
     std::string create_cache_dir(const fs::u8path& cache_path);
 
+    /**
+     * Read the records of some packages from a ``repodata.json`` file.
+     *
+     * The file is scanned with an on-demand parser that only materializes the records of the
+     * requested package filenames, instead of the whole repodata.
+     * Filenames ending in ``.tar.bz2`` are looked up in ``packages`` and the ones ending in
+     * ``.conda`` in ``packages.conda``.
+     * Packages that are not found are absent from the result, and a file that cannot be read
+     * or parsed gives no record at all.
+     */
+    [[nodiscard]] auto read_repodata_records(
+        const fs::u8path& repodata_file,
+        const std::vector<std::string>& filenames
+    ) -> std::unordered_map<std::string, nlohmann::json>;
+
 }  // namespace mamba
 
 #endif  // MAMBA_SUBDIRDATA_HPP
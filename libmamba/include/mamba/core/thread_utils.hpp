@@ -7,6 +7,8 @@
 #ifndef MAMBA_CORE_THREAD_UTILS_HPP
 #define MAMBA_CORE_THREAD_UTILS_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <csignal>
 #include <exception>
@@ -14,6 +16,7 @@
 #include <mutex>
 #include <thread>
 #include <utility>
+#include <vector>
 
 namespace mamba
 {
@@ -227,6 +230,86 @@ namespace mamba
         m_value += new_max - m_max;
         m_max = new_max;
     }
+
+    /*********************
+     * parallel_for_each *
+     *********************/
+
+    /**
+     * Call ``func(i)`` for each ``i`` in ``[0, count)`` from a pool of threads.
+     *
+     * At most ``max_threads`` threads are used, usually given by ``local_threads_count``, each
+     * given at least ``min_items_per_thread`` items, so that small workloads run on the calling
+     * thread.
+     * All items are processed even if some fail, after which the error of the first failing
+     * item is rethrown.
+     */
+    template <typename Func>
+    void parallel_for_each(
+        std::size_t max_threads,
+        std::size_t count,
+        Func&& func,
+        std::size_t min_items_per_thread = 1
+    );
+
+    /************************************
+     * parallel_for_each implementation *
+     ************************************/
+
+    template <typename Func>
+    void parallel_for_each(
+        std::size_t max_threads,
+        std::size_t count,
+        Func&& func,
+        std::size_t min_items_per_thread
+    )
+    {
+        const auto per_thread = std::max<std::size_t>(min_items_per_thread, 1);
+        const auto n_threads = std::min(max_threads, (count + per_thread - 1) / per_thread);
+
+        auto errors = std::vector<std::exception_ptr>(count);
+        auto next = std::atomic<std::size_t>{ 0 };
+        const auto work = [&]()
+        {
+            for (auto i = next++; i < count; i = next++)
+            {
+                try
+                {
+                    func(i);
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+
+        if (n_threads <= 1)
+        {
+            work();
+        }
+        else
+        {
+            auto workers = std::vector<std::thread>();
+            workers.reserve(n_threads);
+            for (std::size_t t = 0; t < n_threads; ++t)
+            {
+                workers.emplace_back(work);
+            }
+            for (auto& w : workers)
+            {
+                w.join();
+            }
+        }
+
+        for (const auto& error : errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
 }  // namespace mamba
 
 #endif
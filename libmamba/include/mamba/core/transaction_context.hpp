@@ -7,7 +7,10 @@
 #ifndef MAMBA_CORE_TRANSACTION_CONTEXT
 #define MAMBA_CORE_TRANSACTION_CONTEXT
 
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <reproc++/reproc.hpp>
 
@@ -54,8 +57,27 @@ namespace mamba
             std::vector<specs::MatchSpec> requested_specs
         );
         ~TransactionContext();
+        /**
+         * Send Python files to the pyc compilation workers.
+         *
+         * Files are spread across worker processes, which are started as files are sent, up
+         * to one per file and at most the number given by the ``extract_threads`` parameter.
+         */
         bool try_pyc_compilation(const std::vector<fs::u8path>& py_files);
-        void wait_for_pyc_compilation();
+        /**
+         * Wait for all pyc compilation workers, returning whether they all succeeded.
+         *
+         * Failures are logged, at the info level since they are expected when
+         * cross-compiling.
+         */
+        [[nodiscard]] bool wait_for_pyc_compilation();
+        /**
+         * Register a pyc file to add to the package cache once compiled.
+         *
+         * Upon successful compilation, the file compiled in the prefix is hard-linked (or copied)
+         * to the cache location, so that later links of the same package can reuse it.
+         */
+        void add_pyc_cache_entry(fs::u8path compiled, fs::u8path cached);
 
         bool has_python = false;
         fs::u8path target_prefix;
@@ -79,11 +101,18 @@ namespace mamba
 
     private:
 
-        bool start_pyc_compilation_process();
+        bool start_pyc_compilation_processes(std::size_t n_processes);
+        void store_pyc_cache_entries();
 
-        std::unique_ptr<reproc::process> m_pyc_process = nullptr;
-        std::unique_ptr<TemporaryFile> m_pyc_script_file = nullptr;
+        std::vector<std::unique_ptr<reproc::process>> m_pyc_processes = {};
+        std::vector<std::unique_ptr<TemporaryFile>> m_pyc_script_files = {};
         std::unique_ptr<TemporaryFile> m_pyc_compileall = nullptr;
+        // Worker receiving the next file, so that small batches are also spread out
+        std::size_t m_pyc_next_process = 0;
+        // Files sent to the workers, bounding the number of workers
+        std::size_t m_pyc_files_count = 0;
+        // Compiled pyc files in the prefix and where to cache them
+        std::vector<std::pair<fs::u8path, fs::u8path>> m_pyc_cache_entries = {};
 
         const Context* m_context = nullptr;  // TODO: replace by a struct with the necessary params.
 
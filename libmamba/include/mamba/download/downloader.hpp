@@ -8,6 +8,7 @@
 #define MAMBA_DOWNLOAD_DOWNLOADER_HPP
 
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <variant>
@@ -73,6 +74,11 @@ namespace mamba::download
     );
 
     bool check_resource_exists(const std::string& url, const Context& context);
+
+    class CURLConnectionPool;
+
+    /** Create the pool of curl handles kept alive by a ``Context``. */
+    std::shared_ptr<CURLConnectionPool> make_curl_connection_pool();
 }
 
 #endif
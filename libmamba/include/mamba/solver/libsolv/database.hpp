@@ -11,8 +11,12 @@
 #include <memory>
 #include <optional>
 #include <string_view>
+#include <type_traits>
+#include <vector>
 
 #include "mamba/core/error_handling.hpp"
+#include "mamba/solver/libsolv/package_table.hpp"
+#include "mamba/solver/libsolv/package_view.hpp"
 #include "mamba/solver/libsolv/parameters.hpp"
 #include "mamba/solver/libsolv/repo_info.hpp"
 #include "mamba/specs/channel.hpp"
@@ -48,6 +52,9 @@ namespace mamba::solver::libsolv
      * The database contains the solvable (packages) information required from the @ref Solver.
      * The database can be reused by multiple solvers to solve different requirements with the
      * same ecosystem.
+     *
+     * Separate databases share no state and can be used concurrently from different threads.
+     * A single database must not be modified while it is used from another thread.
      */
     class Database
     {
@@ -118,6 +125,13 @@ namespace mamba::solver::libsolv
 
         [[nodiscard]] auto package_count() const -> std::size_t;
 
+        /**
+         * Call a function on all packages in the given repository.
+         *
+         * The function is called with a @ref specs::PackageInfo if it accepts one, otherwise
+         * with a @ref PackageView which avoids copying all package attributes.
+         * If the function returns a @ref util::LoopControl, it can be used to stop iterating.
+         */
         template <typename Func>
         void for_each_package_in_repo(RepoInfo repo, Func&&) const;
 
@@ -127,6 +141,17 @@ namespace mamba::solver::libsolv
         template <typename Func>
         void for_each_package_depending_on(const specs::MatchSpec& ms, Func&&);
 
+        /**
+         * Export the attributes of all packages in columns.
+         *
+         * This is a single pass over the packages, meant for bulk analyses where creating a
+         * @ref specs::PackageInfo for each package would be too slow.
+         */
+        [[nodiscard]] auto package_table() const -> PackageTable;
+
+        /** Export the attributes of all packages in the given repository in columns. */
+        [[nodiscard]] auto package_table_in_repo(RepoInfo repo) const -> PackageTable;
+
         /**
          * An access control wrapper.
          *
@@ -160,6 +185,14 @@ namespace mamba::solver::libsolv
 
         [[nodiscard]] auto package_id_to_package_info(PackageId id) const -> specs::PackageInfo;
 
+        [[nodiscard]] auto package_id_to_package_view(PackageId id) const -> PackageView;
+
+        template <typename Func>
+        auto invoke_on_package(Func& func, PackageId id) const;
+
+        template <typename Func>
+        void for_each_package_id(const std::vector<PackageId>& ids, Func& func) const;
+
         [[nodiscard]] auto packages_in_repo(RepoInfo repo) const -> std::vector<PackageId>;
 
         [[nodiscard]] auto
@@ -200,64 +233,55 @@ namespace mamba::solver::libsolv
         return add_repo_from_packages(packages.begin(), packages.end(), name, add);
     }
 
-    // TODO(C++20): Use ranges::transform
     template <typename Func>
-    void Database::for_each_package_in_repo(RepoInfo repo, Func&& func) const
+    auto Database::invoke_on_package(Func& func, PackageId id) const
     {
-        for (auto id : packages_in_repo(repo))
+        if constexpr (std::is_invocable_v<Func&, specs::PackageInfo>)
         {
-            if constexpr (std::is_same_v<decltype(func(package_id_to_package_info(id))), util::LoopControl>)
-            {
-                if (func(package_id_to_package_info(id)) == util::LoopControl::Break)
-                {
-                    break;
-                }
-            }
-            else
-            {
-                func(package_id_to_package_info(id));
-            }
+            return func(package_id_to_package_info(id));
+        }
+        else
+        {
+            return func(package_id_to_package_view(id));
         }
     }
 
     // TODO(C++20): Use ranges::transform
     template <typename Func>
-    void Database::for_each_package_matching(const specs::MatchSpec& ms, Func&& func)
+    void Database::for_each_package_id(const std::vector<PackageId>& ids, Func& func) const
     {
-        for (auto id : packages_matching_ids(ms))
+        for (auto id : ids)
         {
-            if constexpr (std::is_same_v<decltype(func(package_id_to_package_info(id))), util::LoopControl>)
+            if constexpr (std::is_same_v<decltype(invoke_on_package(func, id)), util::LoopControl>)
             {
-                if (func(package_id_to_package_info(id)) == util::LoopControl::Break)
+                if (invoke_on_package(func, id) == util::LoopControl::Break)
                 {
                     break;
                 }
             }
             else
             {
-                func(package_id_to_package_info(id));
+                invoke_on_package(func, id);
             }
         }
     }
 
-    // TODO(C++20): Use ranges::transform
+    template <typename Func>
+    void Database::for_each_package_in_repo(RepoInfo repo, Func&& func) const
+    {
+        for_each_package_id(packages_in_repo(repo), func);
+    }
+
+    template <typename Func>
+    void Database::for_each_package_matching(const specs::MatchSpec& ms, Func&& func)
+    {
+        for_each_package_id(packages_matching_ids(ms), func);
+    }
+
     template <typename Func>
     void Database::for_each_package_depending_on(const specs::MatchSpec& ms, Func&& func)
     {
-        for (auto id : packages_depending_on_ids(ms))
-        {
-            if constexpr (std::is_same_v<decltype(func(package_id_to_package_info(id))), util::LoopControl>)
-            {
-                if (func(package_id_to_package_info(id)) == util::LoopControl::Break)
-                {
-                    break;
-                }
-            }
-            else
-            {
-                func(package_id_to_package_info(id));
-            }
-        }
+        for_each_package_id(packages_depending_on_ids(ms), func);
     }
 }
 #endif
@@ -0,0 +1,114 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#ifndef MAMBA_SOLVER_LIBSOLV_PACKAGE_TABLE_HPP
+#define MAMBA_SOLVER_LIBSOLV_PACKAGE_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mamba::solver::libsolv
+{
+    class PackageView;
+
+    /**
+     * A column of strings stored contiguously.
+     *
+     * The layout is the one of Arrow ``large_string`` arrays: the string at position ``i`` is
+     * found in the concatenated data between ``offsets()[i]`` and ``offsets()[i + 1]``.
+     */
+    class StringColumn
+    {
+    public:
+
+        using offset_type = std::int64_t;
+
+        [[nodiscard]] auto size() const -> std::size_t;
+        [[nodiscard]] auto operator[](std::size_t pos) const -> std::string_view;
+
+        /** The concatenation of all strings, in UTF-8. */
+        [[nodiscard]] auto data() const -> const std::string&;
+        /** The start of each string in the data, followed by the size of the data. */
+        [[nodiscard]] auto offsets() const -> const std::vector<offset_type>&;
+
+        void reserve(std::size_t size);
+        void push_back(std::string_view str);
+
+    private:
+
+        std::string m_data = {};
+        std::vector<offset_type> m_offsets = { 0 };
+    };
+
+    /**
+     * A column of lists of strings.
+     *
+     * The layout is the one of Arrow ``large_list<large_string>`` arrays: the list at position
+     * ``i`` is made of the values between ``offsets()[i]`` and ``offsets()[i + 1]``.
+     */
+    class StringListColumn
+    {
+    public:
+
+        using offset_type = std::int64_t;
+
+        [[nodiscard]] auto size() const -> std::size_t;
+        [[nodiscard]] auto operator[](std::size_t pos) const -> std::vector<std::string_view>;
+
+        /** All strings of all lists. */
+        [[nodiscard]] auto values() const -> const StringColumn&;
+        /** The start of each list in the values, followed by the number of values. */
+        [[nodiscard]] auto offsets() const -> const std::vector<offset_type>&;
+
+        void reserve(std::size_t size);
+        void push_back(const std::vector<std::string>& strings);
+
+    private:
+
+        StringColumn m_values = {};
+        std::vector<offset_type> m_offsets = { 0 };
+    };
+
+    /**
+     * A snapshot of packages attributes, stored by columns.
+     *
+     * Each column holds the given attribute for all packages, in the same order.
+     * Contrary to a list of @ref specs::PackageInfo, the strings of a column share a single
+     * buffer instead of being allocated one by one, and the columns can be exported without
+     * conversion to tools working on columnar data.
+     * The dependencies and constraints are still formatted from libsolv into temporary strings
+     * for each package while the table is filled.
+     *
+     * @see Database::package_table
+     */
+    struct PackageTable
+    {
+        StringColumn name = {};
+        StringColumn version = {};
+        StringColumn build_string = {};
+        std::vector<std::uint64_t> build_number = {};
+        StringColumn channel = {};
+        StringColumn package_url = {};
+        StringColumn platform = {};
+        StringColumn filename = {};
+        StringColumn license = {};
+        StringColumn md5 = {};
+        StringColumn sha256 = {};
+        std::vector<std::uint64_t> size = {};
+        std::vector<std::uint64_t> timestamp = {};
+        StringListColumn dependencies = {};
+        StringListColumn constrains = {};
+
+        [[nodiscard]] auto package_count() const -> std::size_t;
+
+        void reserve(std::size_t count);
+        void push_back(const PackageView& pkg);
+    };
+}
+#endif
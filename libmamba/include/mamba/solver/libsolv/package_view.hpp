@@ -0,0 +1,90 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#ifndef MAMBA_SOLVER_LIBSOLV_PACKAGE_VIEW_HPP
+#define MAMBA_SOLVER_LIBSOLV_PACKAGE_VIEW_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mamba/specs/package_info.hpp"
+
+namespace solv
+{
+    class ObjPool;
+}
+
+namespace mamba::solver::libsolv
+{
+    class Database;
+
+    /**
+     * A lightweight view on a package stored in the @ref Database.
+     *
+     * The attributes are read directly from the libsolv string pool without copying, contrary
+     * to a @ref specs::PackageInfo which needs to copy all of them.
+     * Use @ref PackageView::to_package_info to get a full package on demand.
+     *
+     * The view, and the strings it returns, are only valid as long as the @ref Database is
+     * alive and not modified.
+     * @see Database::for_each_package_in_repo
+     * @see Database::for_each_package_matching
+     * @see Database::for_each_package_depending_on
+     */
+    class PackageView
+    {
+    public:
+
+        using PackageId = int;
+
+        PackageView(const PackageView&) = default;
+        PackageView(PackageView&&) = default;
+        auto operator=(const PackageView&) -> PackageView& = default;
+        auto operator=(PackageView&&) -> PackageView& = default;
+
+        [[nodiscard]] auto id() const -> PackageId;
+
+        [[nodiscard]] auto name() const -> std::string_view;
+        [[nodiscard]] auto version() const -> std::string_view;
+        [[nodiscard]] auto build_string() const -> std::string_view;
+        [[nodiscard]] auto build_number() const -> std::size_t;
+        [[nodiscard]] auto noarch() const -> specs::NoArchType;
+        [[nodiscard]] auto channel() const -> std::string_view;
+        [[nodiscard]] auto package_url() const -> std::string_view;
+        [[nodiscard]] auto platform() const -> std::string_view;
+        [[nodiscard]] auto filename() const -> std::string_view;
+        [[nodiscard]] auto license() const -> std::string_view;
+        [[nodiscard]] auto md5() const -> std::string_view;
+        [[nodiscard]] auto sha256() const -> std::string_view;
+        [[nodiscard]] auto size() const -> std::size_t;
+        [[nodiscard]] auto timestamp() const -> std::size_t;
+
+        /** The dependencies, which are formatted from libsolv upon call. */
+        [[nodiscard]] auto dependencies() const -> std::vector<std::string>;
+
+        /** The constraints, which are formatted from libsolv upon call. */
+        [[nodiscard]] auto constrains() const -> std::vector<std::string>;
+
+        /** Copy all the attributes into a new package. */
+        [[nodiscard]] auto to_package_info() const -> specs::PackageInfo;
+
+    private:
+
+        const solv::ObjPool* m_pool = nullptr;  // This is a view managed by the Database
+        PackageId m_id = 0;
+
+        PackageView(const solv::ObjPool& pool, PackageId id);
+
+        friend class Database;
+        friend auto operator==(PackageView lhs, PackageView rhs) -> bool;
+    };
+
+    auto operator==(PackageView lhs, PackageView rhs) -> bool;
+    auto operator!=(PackageView lhs, PackageView rhs) -> bool;
+}
+#endif
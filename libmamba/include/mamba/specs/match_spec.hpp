@@ -8,6 +8,7 @@
 #define MAMBA_SPECS_MATCH_SPEC
 
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -57,6 +58,16 @@ namespace mamba::specs
 
         [[nodiscard]] static auto parse_url(std::string_view spec) -> expected_parse_t<MatchSpec>;
 
+        /**
+         * Parse through a process-wide cache of immutable MatchSpecs.
+         *
+         * The same dependency strings recur many times across repodata, history, and lockfiles.
+         * All the callers parsing the same string share the same MatchSpec.
+         * Parse errors are not cached.
+         */
+        [[nodiscard]] static auto parse_cached(std::string_view spec)
+            -> expected_parse_t<std::shared_ptr<const MatchSpec>>;
+
         [[nodiscard]] auto channel() const -> const std::optional<UnresolvedChannel>&;
         void set_channel(std::optional<UnresolvedChannel> chan);
 
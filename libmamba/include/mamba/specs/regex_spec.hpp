@@ -7,6 +7,7 @@
 #ifndef MAMBA_SPECS_REGEX_SPEC
 #define MAMBA_SPECS_REGEX_SPEC
 
+#include <memory>
 #include <regex>
 #include <string>
 #include <string_view>
@@ -17,8 +18,13 @@
 
 namespace mamba::specs
 {
+    class RegexProgram;
+
     /**
      * A matcher for regex expression.
+     *
+     * Patterns are matched with a linear time automaton when they only use common constructs,
+     * and with ``std::regex`` otherwise.
      */
     class RegexSpec
     {
@@ -63,6 +69,8 @@ namespace mamba::specs
 
         std::regex m_pattern;
         std::string m_raw_pattern;
+        // Shared since it is immutable, empty if the pattern is not supported by the automaton
+        std::shared_ptr<const RegexProgram> m_program;
     };
 }
 
@@ -106,13 +106,23 @@ namespace mamba::specs
         static auto parse(std::string_view str) -> expected_parse_t<Version>;
 
         /** Construct version ``0.0``. */
-        Version() noexcept = default;
-        Version(std::size_t epoch, CommonVersion version, CommonVersion local = {}) noexcept;
+        Version() noexcept;
+        Version(std::size_t epoch, CommonVersion version, CommonVersion local = {});
 
         [[nodiscard]] auto epoch() const noexcept -> std::size_t;
         [[nodiscard]] auto version() const noexcept -> const CommonVersion&;
         [[nodiscard]] auto local() const noexcept -> const CommonVersion&;
 
+        /**
+         * A binary key with the same ordering as versions.
+         *
+         * Comparing the keys of two versions bytewise (as with ``memcmp``) gives the same
+         * result as comparing the versions, equivalent versions such as ``1.0`` and ``1``
+         * have the same key.
+         * The key is computed upon construction and is used by all comparison operators.
+         */
+        [[nodiscard]] auto sort_key() const noexcept -> const std::string&;
+
         /**
          * A string representation of the version.
          *
@@ -158,11 +168,30 @@ namespace mamba::specs
          */
         [[nodiscard]] auto compatible_with(const Version& older, std::size_t level) const -> bool;
 
+        /**
+         * A prefix shared by the sort keys of all versions starting with this one.
+         *
+         * The converse does not hold: since literals may differ in a prefix match
+         * (``1a.2`` starts with ``1.2``), the prefix only pins down the epoch and the
+         * first atom.
+         */
+        [[nodiscard]] auto starts_with_key_prefix() const -> std::string;
+
+        /**
+         * A prefix shared by the sort keys of all versions compatible with this one.
+         *
+         * The prefix pins down the epoch and the non empty parts that compatible versions
+         * must share at the given level.
+         * The converse does not hold.
+         */
+        [[nodiscard]] auto compatible_with_key_prefix(std::size_t level) const -> std::string;
+
     private:
 
         // Stored in decreasing size order for performance
         CommonVersion m_version = {};
         CommonVersion m_local = {};
+        std::string m_sort_key = {};
         std::size_t m_epoch = 0;
     };
 
@@ -0,0 +1,147 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#ifndef MAMBA_SPECS_VERSION_INTERVAL_SET_HPP
+#define MAMBA_SPECS_VERSION_INTERVAL_SET_HPP
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mamba/specs/version.hpp"
+
+namespace mamba::specs
+{
+    /**
+     * A set of versions represented as a union of disjoint half-open intervals.
+     *
+     * Bounds are expressed on the space of Version::sort_key, so that checking if a version
+     * belongs to the set, or finding the versions of a sorted range that belong to the set, are
+     * done with binary searches rather than evaluating predicates.
+     *
+     * Some sets of versions, such as the versions starting with a given prefix, are not intervals
+     * in that space.
+     * Such sets are approximated by a larger set, in which case the set is not exact, and
+     * ``contains`` answering true only means that the version may be in the original set.
+     */
+    class VersionIntervalSet
+    {
+    public:
+
+        using key_type = std::string;
+
+        /**
+         * The interval ``[lower, upper)`` over sort keys.
+         *
+         * An empty lower bound is unbounded since it is the smallest key, an empty optional
+         * upper bound is unbounded.
+         */
+        struct Interval
+        {
+            key_type lower = {};
+            std::optional<key_type> upper = {};
+
+            [[nodiscard]] auto contains(std::string_view key) const -> bool;
+        };
+
+        [[nodiscard]] static auto make_empty() -> VersionIntervalSet;
+        [[nodiscard]] static auto make_free() -> VersionIntervalSet;
+        [[nodiscard]] static auto make_equal_to(const Version& ver) -> VersionIntervalSet;
+        [[nodiscard]] static auto make_not_equal_to(const Version& ver) -> VersionIntervalSet;
+        [[nodiscard]] static auto make_greater(const Version& ver) -> VersionIntervalSet;
+        [[nodiscard]] static auto make_greater_equal(const Version& ver) -> VersionIntervalSet;
+        [[nodiscard]] static auto make_less(const Version& ver) -> VersionIntervalSet;
+        [[nodiscard]] static auto make_less_equal(const Version& ver) -> VersionIntervalSet;
+
+        /** The set of all versions whose sort key starts with the given prefix. */
+        [[nodiscard]] static auto make_key_prefix(std::string_view prefix) -> VersionIntervalSet;
+
+        /** Construct the set of all versions. */
+        VersionIntervalSet();
+
+        [[nodiscard]] auto intervals() const -> const std::vector<Interval>&;
+
+        /** False if the set is a superset of the one it was computed from. */
+        [[nodiscard]] auto is_exact() const -> bool;
+        void set_exact(bool exact);
+
+        [[nodiscard]] auto is_empty() const -> bool;
+        [[nodiscard]] auto is_free() const -> bool;
+
+        [[nodiscard]] auto contains(const Version& point) const -> bool;
+        [[nodiscard]] auto contains_key(std::string_view key) const -> bool;
+
+        /** The intersection, exact only if both sets are. */
+        [[nodiscard]] auto intersection(const VersionIntervalSet& other) const
+            -> VersionIntervalSet;
+
+        /** The union, exact only if both sets are. */
+        [[nodiscard]] auto union_with(const VersionIntervalSet& other) const
+            -> VersionIntervalSet;
+
+        /**
+         * The complement.
+         *
+         * The complement of a superset is not a superset of the complement, so if this set
+         * is not exact, the result is the (not exact) set of all versions.
+         */
+        [[nodiscard]] auto complement() const -> VersionIntervalSet;
+
+        /**
+         * Call ``func(first, last)`` on the maximal sub-ranges lying in the set.
+         *
+         * The range ``[first, last)`` must be sorted by increasing sort keys, as returned by
+         * ``key(elem)``.
+         * This makes two binary searches per interval in the set.
+         */
+        template <typename Iter, typename KeyFunc, typename Func>
+        void for_each_range(Iter first, Iter last, KeyFunc&& key, Func&& func) const;
+
+        [[nodiscard]] auto operator==(const VersionIntervalSet& other) const -> bool;
+        [[nodiscard]] auto operator!=(const VersionIntervalSet& other) const -> bool;
+
+    private:
+
+        std::vector<Interval> m_intervals = {};
+        bool m_exact = true;
+
+        explicit VersionIntervalSet(std::vector<Interval> intervals, bool exact = true);
+    };
+
+    /***************************************
+     *  VersionIntervalSet Implementation  *
+     ***************************************/
+
+    template <typename Iter, typename KeyFunc, typename Func>
+    void VersionIntervalSet::for_each_range(Iter first, Iter last, KeyFunc&& key, Func&& func) const
+    {
+        for (const auto& inter : m_intervals)
+        {
+            first = std::partition_point(
+                first,
+                last,
+                [&](const auto& elem) { return std::string_view(key(elem)) < inter.lower; }
+            );
+            auto inter_last = last;
+            if (inter.upper.has_value())
+            {
+                inter_last = std::partition_point(
+                    first,
+                    last,
+                    [&](const auto& elem) { return std::string_view(key(elem)) < *inter.upper; }
+                );
+            }
+            if (first != inter_last)
+            {
+                func(first, inter_last);
+            }
+            first = inter_last;
+        }
+    }
+}
+#endif
@@ -9,6 +9,7 @@
 
 #include <array>
 #include <functional>
+#include <memory>
 #include <string_view>
 #include <variant>
 
@@ -16,6 +17,7 @@
 
 #include "mamba/specs/error.hpp"
 #include "mamba/specs/version.hpp"
+#include "mamba/specs/version_interval_set.hpp"
 #include "mamba/util/flat_bool_expr_tree.hpp"
 #include "mamba/util/tuple_hash.hpp"
 
@@ -48,6 +50,14 @@ namespace mamba::specs
          */
         [[nodiscard]] auto contains(const Version& point) const -> bool;
 
+        /**
+         * The set of versions contained in the predicate.
+         *
+         * Prefix and compatibility predicates are not intervals and are approximated by a
+         * (not exact) larger set.
+         */
+        [[nodiscard]] auto to_interval_set() const -> VersionIntervalSet;
+
         [[nodiscard]] auto str() const -> std::string;
 
         /**
@@ -191,6 +201,28 @@ namespace mamba::specs
          */
         [[nodiscard]] auto contains(const Version& point) const -> bool;
 
+        /**
+         * Compile the expression into a union of intervals.
+         *
+         * The result is exact unless the expression contains predicates that cannot be
+         * represented as intervals, in which case it is a larger set that can be used to
+         * prefilter versions before calling @ref contains.
+         */
+        [[nodiscard]] auto to_interval_set() const -> VersionIntervalSet;
+
+        /**
+         * Call ``func`` on the elements of a range that the VersionSpec contains.
+         *
+         * The range ``[first, last)`` must be sorted by increasing versions, as returned by
+         * ``version(elem)``.
+         * Rather than evaluating the expression on every element, the matching sub-ranges are
+         * found by binary search on the compiled interval set.
+         * The set is compiled on first use and shared by the copies of the VersionSpec.
+         * The expression is only evaluated on the candidates when the set is not exact.
+         */
+        template <typename Iter, typename VersionFunc, typename Func>
+        void for_each_contained(Iter first, Iter last, VersionFunc&& version, Func&& func) const;
+
         /**
          * Return the size of the boolean expression tree.
          */
@@ -209,6 +241,9 @@ namespace mamba::specs
     private:
 
         tree_type m_tree;
+        mutable std::shared_ptr<const VersionIntervalSet> m_interval_set = {};
+
+        [[nodiscard]] auto cached_interval_set() const -> std::shared_ptr<const VersionIntervalSet>;
 
         friend class ::fmt::formatter<VersionSpec>;
     };
@@ -217,6 +252,33 @@ namespace mamba::specs
     {
         auto operator""_vs(const char* str, std::size_t len) -> VersionSpec;
     }
+
+    /********************************
+     *  VersionSpec Implementation  *
+     ********************************/
+
+    template <typename Iter, typename VersionFunc, typename Func>
+    void
+    VersionSpec::for_each_contained(Iter first, Iter last, VersionFunc&& version, Func&& func) const
+    {
+        const auto set_ptr = cached_interval_set();
+        const auto& set = *set_ptr;
+        set.for_each_range(
+            first,
+            last,
+            [&](const auto& elem) -> const std::string& { return version(elem).sort_key(); },
+            [&](Iter range_first, Iter range_last)
+            {
+                for (; range_first != range_last; ++range_first)
+                {
+                    if (set.is_exact() || contains(version(*range_first)))
+                    {
+                        func(*range_first);
+                    }
+                }
+            }
+        );
+    }
 }
 
 template <>
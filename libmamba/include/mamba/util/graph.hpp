@@ -12,6 +12,8 @@
 #include <functional>
 #include <iterator>
 #include <map>
+#include <optional>
+#include <stdexcept>
 #include <utility>
 #include <vector>
 
@@ -42,7 +44,8 @@ namespace mamba::util
         std::size_t number_of_edges() const noexcept;
         std::size_t in_degree(node_id id) const noexcept;
         std::size_t out_degree(node_id id) const noexcept;
-        const node_map& nodes() const;
+        // Build a map of all existing nodes, prefer for_each_node_id and node to avoid a copy
+        node_map nodes() const;
         const node_t& node(node_id id) const;
         node_t& node(node_id id);
         const node_id_list& successors(node_id id) const;
@@ -88,12 +91,14 @@ namespace mamba::util
         template <class V>
         node_id add_node_impl(V&& value);
 
-        // Source of truth for exsising nodes
-        node_map m_node_map;
+        // Source of truth for exsising nodes, indexed by node_id.
+        // May contains empty slots after `remove_node`
+        std::vector<std::optional<node_t>> m_nodes;
         // May contains empty slots after `remove_node`
         adjacency_list m_predecessors;
         // May contains empty slots after `remove_node`
         adjacency_list m_successors;
+        std::size_t m_number_of_nodes = 0;
         std::size_t m_number_of_edges = 0;
     };
 
@@ -252,7 +257,7 @@ namespace mamba::util
     template <typename N, typename G>
     auto DiGraphBase<N, G>::number_of_nodes() const noexcept -> std::size_t
     {
-        return m_node_map.size();
+        return m_number_of_nodes;
     }
 
     template <typename N, typename G>
@@ -274,21 +279,31 @@ namespace mamba::util
     }
 
     template <typename N, typename G>
-    auto DiGraphBase<N, G>::nodes() const -> const node_map&
+    auto DiGraphBase<N, G>::nodes() const -> node_map
     {
-        return m_node_map;
+        auto out = node_map();
+        for_each_node_id([&](node_id id) { out.emplace_hint(out.end(), id, node(id)); });
+        return out;
     }
 
     template <typename N, typename G>
     auto DiGraphBase<N, G>::node(node_id id) const -> const node_t&
     {
-        return m_node_map.at(id);
+        if (!has_node(id))
+        {
+            throw std::out_of_range("Invalid node id");
+        }
+        return *m_nodes[id];
     }
 
     template <typename N, typename G>
     auto DiGraphBase<N, G>::node(node_id id) -> node_t&
     {
-        return m_node_map.at(id);
+        if (!has_node(id))
+        {
+            throw std::out_of_range("Invalid node id");
+        }
+        return *m_nodes[id];
     }
 
     template <typename N, typename G>
@@ -318,7 +333,7 @@ namespace mamba::util
     template <typename N, typename G>
     auto DiGraphBase<N, G>::has_node(node_id id) const -> bool
     {
-        return nodes().count(id) > 0;
+        return (id < m_nodes.size()) && m_nodes[id].has_value();
     }
 
     template <typename N, typename G>
@@ -344,9 +359,10 @@ namespace mamba::util
     auto DiGraphBase<N, G>::add_node_impl(V&& value) -> node_id
     {
         const node_id id = number_of_node_id();
-        m_node_map.emplace(id, std::forward<V>(value));
+        m_nodes.emplace_back(std::forward<V>(value));
         m_successors.push_back(node_id_list());
         m_predecessors.push_back(node_id_list());
+        ++m_number_of_nodes;
         return id;
     }
 
@@ -368,7 +384,8 @@ namespace mamba::util
         {
             remove_edge(from, id);
         }
-        m_node_map.erase(id);
+        m_nodes[id].reset();
+        --m_number_of_nodes;
 
         return true;
     }
@@ -403,9 +420,13 @@ namespace mamba::util
     template <typename UnaryFunc>
     UnaryFunc DiGraphBase<N, G>::for_each_node_id(UnaryFunc func) const
     {
-        for (const auto& [i, _] : m_node_map)
+        const auto n_ids = number_of_node_id();
+        for (node_id i = 0; i < n_ids; ++i)
         {
-            func(i);
+            if (m_nodes[i].has_value())
+            {
+                func(i);
+            }
         }
         return func;
     }
@@ -536,6 +557,12 @@ namespace mamba::util
             no
         };
 
+        /**
+         * Depth first search from a start node, with the same events as a recursive search.
+         *
+         * An explicit stack is used rather than recursion so that deep graphs cannot overflow
+         * the call stack.
+         */
         template <typename Graph, typename Visitor>
         void dfs_raw_impl(
             const Graph& graph,
@@ -545,31 +572,61 @@ namespace mamba::util
             const typename Graph::adjacency_list& adjacency
         )
         {
+            using node_id = typename Graph::node_id;
+
+            struct Frame
+            {
+                node_id node;
+                std::size_t next_child;
+            };
+
             assert(status.size() == graph.successors().size());
             assert(adjacency.size() == graph.successors().size());
             assert(start < status.size());
+
+            auto stack = std::vector<Frame>();
             status[start] = Visited::ongoing;
             visitor.start_node(start, graph);
-            for (auto child : adjacency[start])
+            stack.push_back({ start, 0 });
+            while (!stack.empty())
             {
-                visitor.start_edge(start, child, graph);
-                if (status[child] == Visited::no)
-                {
-                    visitor.tree_edge(start, child, graph);
-                    dfs_raw_impl(graph, visitor, child, status, adjacency);
-                }
-                else if (status[child] == Visited::ongoing)
+                const auto node = stack.back().node;
+                const auto& children = adjacency[node];
+                if (const auto idx = stack.back().next_child; idx < children.size())
                 {
-                    visitor.back_edge(start, child, graph);
+                    ++stack.back().next_child;
+                    const auto child = children[idx];
+                    visitor.start_edge(node, child, graph);
+                    if (status[child] == Visited::no)
+                    {
+                        visitor.tree_edge(node, child, graph);
+                        status[child] = Visited::ongoing;
+                        visitor.start_node(child, graph);
+                        stack.push_back({ child, 0 });
+                        // The edge is finished when the child is
+                        continue;
+                    }
+                    else if (status[child] == Visited::ongoing)
+                    {
+                        visitor.back_edge(node, child, graph);
+                    }
+                    else
+                    {
+                        visitor.forward_or_cross_edge(node, child, graph);
+                    }
+                    visitor.finish_edge(node, child, graph);
                 }
                 else
                 {
-                    visitor.forward_or_cross_edge(start, child, graph);
+                    status[node] = Visited::yes;
+                    visitor.finish_node(node, graph);
+                    stack.pop_back();
+                    if (!stack.empty())
+                    {
+                        visitor.finish_edge(stack.back().node, node, graph);
+                    }
                 }
-                visitor.finish_edge(start, child, graph);
             }
-            status[start] = Visited::yes;
-            visitor.finish_node(start, graph);
         }
     }
 
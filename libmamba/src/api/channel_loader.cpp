@@ -31,7 +31,11 @@ namespace mamba
                 // TODO : us tl::expected mechanism
                 throw std::runtime_error("Specified pkgs_dir does not exist\n");
             }
-            auto sprefix_data = PrefixData::create(pkgs_dir, channel_context);
+            auto sprefix_data = PrefixData::create(
+                pkgs_dir,
+                channel_context,
+                local_threads_count(ctx.threads_params)
+            );
             if (!sprefix_data)
             {
                 throw std::runtime_error("Specified pkgs_dir does not exist\n");
@@ -4,12 +4,24 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <set>
+#include <system_error>
+#include <vector>
+
+#include <simdjson.h>
 
 #include "mamba/api/clean.hpp"
 #include "mamba/api/configuration.hpp"
+#include "mamba/core/channel_context.hpp"
 #include "mamba/core/context.hpp"
 #include "mamba/core/package_cache.hpp"
+#include "mamba/core/package_store.hpp"
+#include "mamba/core/prefix_data.hpp"
+#include "mamba/core/thread_utils.hpp"
 #include "mamba/core/util.hpp"
 #include "mamba/fs/filesystem.hpp"
 #include "mamba/util/string.hpp"
@@ -18,6 +30,159 @@
 
 namespace mamba
 {
+    namespace
+    {
+        /**
+         * The size freed by removing a folder, without following symlinks.
+         *
+         * Files that are also hard linked elsewhere, such as in a content store, are not freed
+         * and not counted.
+         */
+        auto folder_size(const fs::u8path& path) -> std::size_t
+        {
+            std::size_t size = 0;
+            std::error_code ec;
+            for (auto& fp : fs::recursive_directory_iterator(path, ec))
+            {
+                if (!fp.is_symlink(ec) && !fp.is_directory(ec) && (fp.hard_link_count(ec) == 1))
+                {
+                    const auto file_size = fp.file_size(ec);
+                    size += ec ? 0 : file_size;
+                }
+            }
+            return size;
+        }
+
+        /**
+         * The size of an extracted package as recorded in its ``info/paths.json``.
+         *
+         * Reading a single file is much faster than walking the package folder, at the cost of
+         * ignoring files added after extraction, such as compiled Python files, and of counting
+         * files that are hard linked elsewhere.
+         * It is only an estimate, used for dry runs.
+         */
+        auto recorded_folder_size(const fs::u8path& path) -> std::size_t
+        {
+            auto content = simdjson::padded_string::load((path / "info" / "paths.json").string());
+            if (content.error())
+            {
+                return folder_size(path);
+            }
+
+            thread_local auto parser = simdjson::ondemand::parser();
+            std::size_t size = 0;
+            try
+            {
+                auto doc = parser.iterate(content.value_unsafe());
+                for (auto entry : doc["paths"].get_array())
+                {
+                    std::uint64_t entry_size = 0;
+                    if (!entry["size_in_bytes"].get(entry_size))
+                    {
+                        size += entry_size;
+                    }
+                }
+            }
+            catch (const simdjson::simdjson_error&)
+            {
+                return folder_size(path);
+            }
+            return size;
+        }
+
+        /**
+         * The names of the package folders used by the given environments.
+         *
+         * The records are loaded through the prefix index, so that only the records that changed
+         * since the last transaction are parsed, and the environments are left untouched.
+         */
+        auto collect_installed_packages(
+            const std::vector<fs::u8path>& envs,
+            ChannelContext& channels,
+            std::size_t threads_count
+        ) -> std::set<std::string>
+        {
+            std::set<std::string> installed_pkgs;
+            for (const auto& env : envs)
+            {
+                auto prefix_data = PrefixData::create(env, channels, threads_count);
+                if (prefix_data)
+                {
+                    for (const auto& [name, pkg] : prefix_data.value().records())
+                    {
+                        installed_pkgs.insert(pkg.str());
+                    }
+                    continue;
+                }
+
+                LOG_WARNING << "Could not load environment " << env.string()
+                            << ", using its record file names: " << prefix_data.error().what();
+                for (auto& pkg : fs::directory_iterator(env / "conda-meta"))
+                {
+                    if (util::ends_with(pkg.path().string(), ".json"))
+                    {
+                        std::string pkg_name = pkg.path().filename().string();
+                        installed_pkgs.insert(pkg_name.substr(0, pkg_name.size() - 5));
+                    }
+                }
+            }
+            return installed_pkgs;
+        }
+
+        /** Remove files and folders in parallel, showing the progress. */
+        void remove_all_with_progress(
+            const std::vector<fs::u8path>& paths,
+            const std::string& label,
+            std::size_t threads_count
+        )
+        {
+            auto progress = Console::instance().add_progress_bar(label, paths.size());
+            auto& pbar_manager = Console::instance().progress_bar_manager();
+            if (progress && !pbar_manager.started())
+            {
+                pbar_manager.watch_print();
+            }
+
+            auto removed = std::atomic<std::size_t>{ 0 };
+            auto progress_mutex = std::mutex();
+            parallel_for_each(
+                threads_count,
+                paths.size(),
+                [&](std::size_t i)
+                {
+                    std::error_code ec;
+                    fs::remove_all(paths[i], ec);
+                    if (ec)
+                    {
+                        LOG_WARNING << "Could not remove '" << paths[i].string()
+                                    << "': " << ec.message();
+                    }
+                    const auto done = ++removed;
+                    if (progress)
+                    {
+                        auto lock = std::lock_guard(progress_mutex);
+                        progress.update_current(std::max(done, progress.current()));
+                    }
+                }
+            );
+
+            if (progress && pbar_manager.started())
+            {
+                progress.mark_as_completed();
+                pbar_manager.terminate();
+                pbar_manager.clear_progress_bars();
+            }
+        }
+
+        /** A file or folder of a package cache that can be removed. */
+        struct CacheEntry
+        {
+            fs::u8path cache;
+            fs::u8path path;
+            std::size_t size = 0;
+        };
+    }
+
     void clean(Configuration& config, int options)
     {
         auto& ctx = config.context();
@@ -33,6 +198,7 @@ namespace mamba
         bool clean_locks = options & MAMBA_CLEAN_LOCKS;
         bool clean_trash = options & MAMBA_CLEAN_TRASH;
         bool clean_force_pkgs_dirs = options & MAMBA_CLEAN_FORCE_PKGS_DIRS;
+        const auto threads_count = local_threads_count(ctx.threads_params);
 
         if (!(clean_all || clean_index || clean_pkgs || clean_tarballs || clean_locks || clean_trash
               || clean_force_pkgs_dirs))
@@ -140,20 +306,6 @@ namespace mamba
             clean_trash_files(ctx.prefix_params.root_prefix, true);
         }
 
-        // globally, collect installed packages
-        std::set<std::string> installed_pkgs;
-        for (auto& env : envs)
-        {
-            for (auto& pkg : fs::directory_iterator(env / "conda-meta"))
-            {
-                if (util::ends_with(pkg.path().string(), ".json"))
-                {
-                    std::string pkg_name = pkg.path().filename().string();
-                    installed_pkgs.insert(pkg_name.substr(0, pkg_name.size() - 5));
-                }
-            }
-        }
-
         auto get_file_size = [](const auto& s) -> std::string
         {
             std::stringstream ss;
@@ -161,33 +313,47 @@ namespace mamba
             return ss.str();
         };
 
-        auto collect_tarballs = [&]()
+        // A table of all entries, or only their count and size per cache on dry runs
+        auto print_entries = [&](const std::vector<CacheEntry>& entries,
+                                 const std::string& header,
+                                 bool estimated_size)
         {
-            std::vector<fs::u8path> res;
             std::size_t total_size = 0;
-            std::vector<printers::FormattedString> header = { "Package file", "Size" };
-            mamba::printers::Table t(header);
+            for (const auto& entry : entries)
+            {
+                total_size += entry.size;
+            }
+            if (total_size == 0)
+            {
+                return;
+            }
+
+            mamba::printers::Table t({ header, "Size" });
             t.set_alignment({ printers::alignment::left, printers::alignment::right });
             t.set_padding({ 2, 4 });
-
             for (auto* pkg_cache : caches.writable_caches())
             {
-                std::string header_line = util::concat(
-                    "Package cache folder: ",
-                    pkg_cache->path().string()
-                );
                 std::vector<std::vector<printers::FormattedString>> rows;
-                for (auto& p : fs::directory_iterator(pkg_cache->path()))
+                std::size_t count = 0;
+                std::size_t cache_size = 0;
+                for (const auto& entry : entries)
                 {
-                    std::string fname = p.path().filename().string();
-                    if (!p.is_directory()
-                        && (util::ends_with(p.path().string(), ".tar.bz2")
-                            || util::ends_with(p.path().string(), ".conda")))
+                    if (entry.cache == pkg_cache->path())
+                    {
+                        const auto name = entry.path.filename().string();
+                        rows.push_back({ name, get_file_size(entry.size) });
+                        count += 1;
+                        cache_size += entry.size;
+                    }
+                }
+                if (ctx.dry_run)
+                {
+                    if (count == 0)
                     {
-                        res.push_back(p.path());
-                        rows.push_back({ p.path().filename().string(), get_file_size(p.file_size()) });
-                        total_size += p.file_size();
+                        continue;
                     }
+                    rows = { { util::concat(std::to_string(count), " entries"),
+                               get_file_size(cache_size) } };
                 }
                 std::sort(
                     rows.begin(),
@@ -196,11 +362,30 @@ namespace mamba
                 );
                 t.add_rows(pkg_cache->path().string(), rows);
             }
-            if (total_size)
+            t.add_rows(
+                {},
+                { { estimated_size ? "Estimated total size: " : "Total size: ",
+                    get_file_size(total_size) } }
+            );
+            t.print(std::cout);
+        };
+
+        auto collect_tarballs = [&]()
+        {
+            std::vector<CacheEntry> res;
+            for (auto* pkg_cache : caches.writable_caches())
             {
-                t.add_rows({}, { { "Total size: ", get_file_size(total_size) } });
-                t.print(std::cout);
+                for (auto& p : fs::directory_iterator(pkg_cache->path()))
+                {
+                    if (!p.is_directory()
+                        && (util::ends_with(p.path().string(), ".tar.bz2")
+                            || util::ends_with(p.path().string(), ".conda")))
+                    {
+                        res.push_back({ pkg_cache->path(), p.path(), p.file_size() });
+                    }
+                }
             }
+            print_entries(res, "Package file", false);
             return res;
         };
 
@@ -215,78 +400,86 @@ namespace mamba
                 {
                     LOG_INFO << "No cached tarballs found";
                 }
-                else if (!ctx.dry_run && Console::prompt("\nRemove tarballs", 'y'))
+                else if (Console::prompt("\nRemove tarballs", 'y'))
                 {
+                    std::vector<fs::u8path> paths;
                     for (auto& tbr : to_be_removed)
                     {
-                        fs::remove(tbr);
+                        paths.push_back(tbr.path);
                     }
+                    remove_all_with_progress(paths, "Removing tarballs", threads_count);
                 }
             }
         }
 
-        auto get_folder_size = [](auto& p)
+        auto collect_package_folders = [&](const std::set<std::string>& installed_pkgs)
         {
-            std::size_t size = 0;
-            for (auto& fp : fs::recursive_directory_iterator(p))
+            std::vector<CacheEntry> candidates;
+            for (auto* pkg_cache : caches.writable_caches())
             {
-                if (!fp.is_symlink() && !fp.is_directory())
+                for (auto& p : fs::directory_iterator(pkg_cache->path()))
                 {
-                    size += fp.file_size();
+                    // do not remove installed packages
+                    const auto name = p.path().filename().string();
+                    if (p.is_directory() && installed_pkgs.find(name) == installed_pkgs.end())
+                    {
+                        candidates.push_back({ pkg_cache->path(), p.path() });
+                    }
                 }
             }
-            return size;
-        };
 
-        auto collect_package_folders = [&]()
-        {
-            std::vector<fs::u8path> res;
-            std::size_t total_size = 0;
-            std::vector<printers::FormattedString> header = { "Package folder", "Size" };
-            mamba::printers::Table t(header);
-            t.set_alignment({ printers::alignment::left, printers::alignment::right });
-            t.set_padding({ 2, 4 });
-
-            for (auto* pkg_cache : caches.writable_caches())
+            // Dry runs read the recorded package sizes instead of walking the folders, unless
+            // the folder files are linked to a content store and would not be freed.
+            auto recorded_size_caches = std::set<fs::u8path>();
+            if (ctx.dry_run)
             {
-                std::string header_line = util::concat(
-                    "Package cache folder: ",
-                    pkg_cache->path().string()
-                );
-                std::vector<std::vector<printers::FormattedString>> rows;
-                for (auto& p : fs::directory_iterator(pkg_cache->path()))
+                for (auto* pkg_cache : caches.writable_caches())
                 {
-                    if (p.is_directory() && fs::exists(p.path() / "info" / "index.json"))
+                    if (!fs::exists(content_store_path(pkg_cache->path())))
                     {
-                        if (installed_pkgs.find(p.path().filename().string()) != installed_pkgs.end())
-                        {
-                            // do not remove installed packages
-                            continue;
-                        }
-                        res.push_back(p.path());
-                        std::size_t folder_size = get_folder_size(p);
-                        rows.push_back({ p.path().filename().string(), get_file_size(folder_size) });
-                        total_size += folder_size;
+                        recorded_size_caches.insert(pkg_cache->path());
                     }
                 }
-                std::sort(
-                    rows.begin(),
-                    rows.end(),
-                    [](const auto& a, const auto& b) { return a[0].s < b[0].s; }
-                );
-                t.add_rows(pkg_cache->path().string(), rows);
             }
-            if (total_size)
+
+            // Folders are checked and walked concurrently
+            auto is_package = std::vector<char>(candidates.size(), false);
+            parallel_for_each(
+                threads_count,
+                candidates.size(),
+                [&](std::size_t i)
+                {
+                    auto& candidate = candidates[i];
+                    if (fs::exists(candidate.path / "info" / "index.json"))
+                    {
+                        is_package[i] = true;
+                        candidate.size = recorded_size_caches.count(candidate.cache)
+                                             ? recorded_folder_size(candidate.path)
+                                             : folder_size(candidate.path);
+                    }
+                }
+            );
+
+            std::vector<CacheEntry> res;
+            bool estimated_size = false;
+            for (std::size_t i = 0; i < candidates.size(); ++i)
             {
-                t.add_rows({}, { { "Total size: ", get_file_size(total_size) } });
-                t.print(std::cout);
+                if (is_package[i])
+                {
+                    estimated_size |= recorded_size_caches.count(candidates[i].cache) > 0;
+                    res.push_back(std::move(candidates[i]));
+                }
             }
+            print_entries(res, "Package folder", estimated_size);
             return res;
         };
 
         if (clean_all || clean_pkgs)
         {
-            auto to_be_removed = collect_package_folders();
+            auto channel_context = ChannelContext::make_conda_compatible(ctx);
+            auto to_be_removed = collect_package_folders(
+                collect_installed_packages(envs, channel_context, threads_count)
+            );
             if (!ctx.dry_run)
             {
                 Console::instance().print("Cleaning packages..");
@@ -303,13 +496,33 @@ namespace mamba
 
                     if (Console::prompt("\nRemove unused packages", 'y'))
                     {
+                        std::vector<fs::u8path> paths;
                         for (auto& tbr : to_be_removed)
                         {
-                            fs::remove_all(tbr);
+                            paths.push_back(tbr.path);
                         }
+                        remove_all_with_progress(paths, "Removing packages", threads_count);
                     }
                 }
             }
+
+            // Store entries are only freed once no package directory links them anymore
+            std::size_t store_size = 0;
+            for (auto* pkg_cache : caches.writable_caches())
+            {
+                store_size += collect_content_store_garbage(
+                    content_store_path(pkg_cache->path()),
+                    ctx.dry_run
+                );
+            }
+            if (store_size)
+            {
+                Console::instance().print(util::concat(
+                    ctx.dry_run ? "Unused content store entries: "
+                                : "Removed content store entries: ",
+                    get_file_size(store_size)
+                ));
+            }
         }
 
         if (clean_force_pkgs_dirs)
@@ -1490,6 +1490,47 @@ namespace mamba
                    .set_env_var_names()
                    .description("The maximum number of retries each HTTP connection should attempt."));
 
+        insert(
+            Configurable(
+                "remote_max_host_connections", &m_context.remote_fetch_params.max_host_connections
+            )
+                .group("Network")
+                .set_rc_configurable()
+                .set_env_var_names()
+                .description("The maximum number of parallel connections to a single host")
+                .long_description(unindent(R"(
+                        The maximum number of parallel connections opened to a single host
+                        during a download. The total number of parallel connections is still
+                        bounded by 'download_threads'. 0 (default) means no per host limit.)"))
+        );
+
+        insert(
+            Configurable(
+                "remote_max_download_speed", &m_context.remote_fetch_params.max_download_speed
+            )
+                .group("Network")
+                .set_rc_configurable()
+                .set_env_var_names()
+                .description("The maximum total download speed, in bytes per second")
+                .long_description(unindent(R"(
+                        The maximum download speed, in bytes per second, shared by all the
+                        parallel downloads. 0 (default) means no limit.)"))
+        );
+
+        insert(
+            Configurable(
+                "remote_max_host_download_speed",
+                &m_context.remote_fetch_params.max_host_download_speed
+            )
+                .group("Network")
+                .set_rc_configurable()
+                .set_env_var_names()
+                .description("The maximum download speed from a single host, in bytes per second")
+                .long_description(unindent(R"(
+                        The maximum download speed, in bytes per second, shared by all the
+                        parallel downloads from a single host. 0 (default) means no limit.)"))
+        );
+
 
         // Solver
         insert(Configurable("channel_priority", &m_context.channel_priority)
@@ -1624,6 +1665,29 @@ namespace mamba
                         host max concurrency minus the value, zero (default) is the host max
                         concurrency value.)")));
 
+        insert(Configurable("extract_batched_writes", &m_context.extract_batched_writes)
+                   .group("Extract, Link & Install")
+                   .set_rc_configurable()
+                   .set_env_var_names()
+                   .description("Write small extracted files concurrently")
+                   .long_description(unindent(R"(
+                        Create and write the small files of a package concurrently when
+                        extracting it, instead of one after the other. This reduces the
+                        extraction time of packages made of many small files, notably on
+                        overlay filesystems. Not available on Windows.)")));
+
+        insert(Configurable("extract_to_content_store", &m_context.extract_to_content_store)
+                   .group("Extract, Link & Install")
+                   .set_rc_configurable()
+                   .set_env_var_names()
+                   .description("Deduplicate extracted package files in a content store")
+                   .long_description(unindent(R"(
+                        Store the files of extracted packages once per package cache, in a
+                        store addressed by their sha256, and hard link them from the package
+                        directories. Identical files shared by several packages, such as
+                        licenses or builds for different Python versions, then use disk
+                        space only once. Unused store entries are removed by 'clean'.)")));
+
         insert(Configurable("allow_softlinks", &m_context.allow_softlinks)
                    .group("Extract, Link & Install")
                    .set_rc_configurable()
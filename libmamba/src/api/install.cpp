@@ -432,7 +432,11 @@ namespace mamba
                 throw std::runtime_error(exp_load.error().what());
             }
 
-            auto exp_prefix_data = PrefixData::create(ctx.prefix_params.target_prefix, channel_context);
+            auto exp_prefix_data = PrefixData::create(
+                ctx.prefix_params.target_prefix,
+                channel_context,
+                local_threads_count(ctx.threads_params)
+            );
             if (!exp_prefix_data)
             {
                 throw std::runtime_error(exp_prefix_data.error().what());
@@ -598,7 +602,11 @@ namespace mamba
             // context. We need to create channels from the specs to be able
             // to download packages.
             init_channels_from_package_urls(ctx, channel_context, specs);
-            auto exp_prefix_data = PrefixData::create(ctx.prefix_params.target_prefix, channel_context);
+            auto exp_prefix_data = PrefixData::create(
+                ctx.prefix_params.target_prefix,
+                channel_context,
+                local_threads_count(ctx.threads_params)
+            );
             if (!exp_prefix_data)
             {
                 // TODO: propagate tl::expected mechanism
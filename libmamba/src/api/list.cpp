@@ -44,7 +44,11 @@ namespace mamba
 
         void list_packages(const Context& ctx, std::string regex, ChannelContext& channel_context)
         {
-            auto sprefix_data = PrefixData::create(ctx.prefix_params.target_prefix, channel_context);
+            auto sprefix_data = PrefixData::create(
+                ctx.prefix_params.target_prefix,
+                channel_context,
+                local_threads_count(ctx.threads_params)
+            );
             if (!sprefix_data)
             {
                 // TODO: propagate tl::expected mechanism
@@ -41,7 +41,11 @@ namespace mamba
 
         if (remove_all)
         {
-            auto sprefix_data = PrefixData::create(ctx.prefix_params.target_prefix, channel_context);
+            auto sprefix_data = PrefixData::create(
+                ctx.prefix_params.target_prefix,
+                channel_context,
+                local_threads_count(ctx.threads_params)
+            );
             if (!sprefix_data)
             {
                 // TODO: propagate tl::expected mechanism
@@ -122,7 +126,11 @@ namespace mamba
                 throw std::runtime_error("Aborted.");
             }
 
-            auto exp_prefix_data = PrefixData::create(ctx.prefix_params.target_prefix, channel_context);
+            auto exp_prefix_data = PrefixData::create(
+                ctx.prefix_params.target_prefix,
+                channel_context,
+                local_threads_count(ctx.threads_params)
+            );
             if (!exp_prefix_data)
             {
                 // TODO: propagate tl::expected mechanism
@@ -164,7 +164,11 @@ namespace mamba
             throw std::runtime_error(exp_loaded.error().what());
         }
 
-        auto exp_prefix_data = PrefixData::create(ctx.prefix_params.target_prefix, channel_context);
+        auto exp_prefix_data = PrefixData::create(
+            ctx.prefix_params.target_prefix,
+            channel_context,
+            local_threads_count(ctx.threads_params)
+        );
         if (!exp_prefix_data)
         {
             // TODO: propagate tl::expected mechanism
@@ -0,0 +1,133 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#ifndef MAMBA_CORE_BOUNDED_QUEUE_HPP
+#define MAMBA_CORE_BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace mamba
+{
+    /**
+     * Blocking FIFO queue holding at most ``capacity`` items, used to connect
+     * the stages of a producer / consumer pipeline.
+     *
+     * The producer calls ``close`` once all the items have been pushed, the
+     * consumer then drains the remaining items. Either side can ``cancel`` the
+     * queue to unblock the other one, e.g. when an error occurs.
+     */
+    template <class T>
+    class bounded_queue
+    {
+    public:
+
+        explicit bounded_queue(std::size_t capacity);
+
+        bounded_queue(const bounded_queue&) = delete;
+        bounded_queue& operator=(const bounded_queue&) = delete;
+        bounded_queue(bounded_queue&&) = delete;
+        bounded_queue& operator=(bounded_queue&&) = delete;
+
+        /** Blocks while the queue is full, returns false if it was cancelled. */
+        bool push(T value);
+
+        /** Blocks while the queue is empty, returns nothing once closed and drained. */
+        std::optional<T> pop();
+
+        void close();
+        void cancel();
+        bool is_cancelled() const;
+
+    private:
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_not_full;
+        std::condition_variable m_not_empty;
+        std::deque<T> m_items;
+        std::size_t m_capacity;
+        bool m_closed = false;
+        bool m_cancelled = false;
+    };
+
+    /********************************
+     * bounded_queue implementation *
+     ********************************/
+
+    template <class T>
+    bounded_queue<T>::bounded_queue(std::size_t capacity)
+        : m_capacity(capacity > 0 ? capacity : 1)
+    {
+    }
+
+    template <class T>
+    bool bounded_queue<T>::push(T value)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_not_full.wait(lock, [this] { return m_cancelled || m_items.size() < m_capacity; });
+            if (m_cancelled)
+            {
+                return false;
+            }
+            m_items.push_back(std::move(value));
+        }
+        m_not_empty.notify_one();
+        return true;
+    }
+
+    template <class T>
+    std::optional<T> bounded_queue<T>::pop()
+    {
+        std::optional<T> res;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_not_empty.wait(lock, [this] { return m_cancelled || m_closed || !m_items.empty(); });
+            if (m_cancelled || m_items.empty())
+            {
+                return std::nullopt;
+            }
+            res = std::move(m_items.front());
+            m_items.pop_front();
+        }
+        m_not_full.notify_one();
+        return res;
+    }
+
+    template <class T>
+    void bounded_queue<T>::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_not_empty.notify_all();
+    }
+
+    template <class T>
+    void bounded_queue<T>::cancel()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cancelled = true;
+        }
+        m_not_full.notify_all();
+        m_not_empty.notify_all();
+    }
+
+    template <class T>
+    bool bounded_queue<T>::is_cancelled() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_cancelled;
+    }
+}
+
+#endif
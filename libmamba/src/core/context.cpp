@@ -4,7 +4,9 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <algorithm>
 #include <iostream>
+#include <thread>
 
 #include <fmt/ostream.h>
 #include <fmt/ranges.h>
@@ -18,6 +20,7 @@
 #include "mamba/core/thread_utils.hpp"
 #include "mamba/core/util.hpp"
 #include "mamba/core/util_os.hpp"
+#include "mamba/download/downloader.hpp"
 #include "mamba/util/encoding.hpp"
 #include "mamba/util/environment.hpp"
 #include "mamba/util/path_manip.hpp"
@@ -175,6 +178,7 @@ namespace mamba
     }
 
     Context::Context(const ContextOptions& options)
+        : m_curl_connection_pool(download::make_curl_connection_pool())
     {
         on_ci = static_cast<bool>(util::get_env("CI"));
         prefix_params.root_prefix = util::get_env("MAMBA_ROOT_PREFIX").value_or("");
@@ -220,6 +224,19 @@ namespace mamba
 
     Context::~Context() = default;
 
+    auto local_threads_count(const Context::ThreadsParams& params) -> std::size_t
+    {
+        const auto hardware = static_cast<int>(std::thread::hardware_concurrency());
+        const int n_threads = (params.extract_threads > 0) ? params.extract_threads
+                                                           : hardware + params.extract_threads;
+        return static_cast<std::size_t>(std::max(n_threads, 1));
+    }
+
+    const download::CURLConnectionPool& Context::curl_connection_pool() const
+    {
+        return *m_curl_connection_pool;
+    }
+
     void Context::set_verbosity(int lvl)
     {
         this->output_params.verbosity = lvl;
@@ -417,6 +434,8 @@ namespace mamba
         PRINT_CTX(out, dry_run);
         PRINT_CTX(out, always_yes);
         PRINT_CTX(out, allow_softlinks);
+        PRINT_CTX(out, extract_batched_writes);
+        PRINT_CTX(out, extract_to_content_store);
         PRINT_CTX(out, offline);
         PRINT_CTX(out, output_params.quiet);
         PRINT_CTX(out, src_params.no_rc);
@@ -427,6 +446,9 @@ namespace mamba
         PRINT_CTX(out, remote_fetch_params.retry_backoff);
         PRINT_CTX(out, remote_fetch_params.max_retries);
         PRINT_CTX(out, remote_fetch_params.connect_timeout_secs);
+        PRINT_CTX(out, remote_fetch_params.max_host_connections);
+        PRINT_CTX(out, remote_fetch_params.max_download_speed);
+        PRINT_CTX(out, remote_fetch_params.max_host_download_speed);
         PRINT_CTX(out, add_pip_as_python_dependency);
         PRINT_CTX(out, override_channels_enabled);
         PRINT_CTX(out, use_only_tar_bz2);
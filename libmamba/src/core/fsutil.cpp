@@ -16,6 +16,18 @@
 #include "mamba/util/path_manip.hpp"
 #include "mamba/util/string.hpp"
 
+#ifdef __linux__
+#include <cerrno>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace mamba::path
 {
     bool starts_with_home(const fs::u8path& p)
@@ -168,4 +180,150 @@ namespace mamba::mamba_fs
             }
         }
     }
+
+    namespace
+    {
+#ifdef __linux__
+        auto last_error() -> std::error_code
+        {
+            return { errno, std::generic_category() };
+        }
+
+        auto full_write(int fd, const char* data, std::size_t size) -> bool
+        {
+            while (size > 0)
+            {
+                const auto n = ::write(fd, data, size);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    return false;
+                }
+                data += n;
+                size -= static_cast<std::size_t>(n);
+            }
+            return true;
+        }
+
+        /** Copy the data of ``in`` to ``out`` with the fastest method the file systems allow. */
+        auto copy_file_data(int in, int out, std::size_t size) -> std::error_code
+        {
+#ifdef FICLONE
+            // Both files share the same blocks until one of them is written
+            if (::ioctl(out, FICLONE, in) == 0)
+            {
+                return {};
+            }
+#endif
+
+            std::size_t copied = 0;
+#ifdef SYS_copy_file_range
+            while (copied < size)
+            {
+                const auto n = ::syscall(
+                    SYS_copy_file_range,
+                    in,
+                    nullptr,
+                    out,
+                    nullptr,
+                    size - copied,
+                    0u
+                );
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                // Not supported, across file systems on older kernels for instance
+                if (n <= 0)
+                {
+                    break;
+                }
+                copied += static_cast<std::size_t>(n);
+            }
+#endif
+
+            // Whatever has not been copied yet goes through user space, from the current offsets
+            auto buffer = std::vector<char>(std::size_t(1) << 20);
+            for (;;)
+            {
+                const auto n = ::read(in, buffer.data(), buffer.size());
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n < 0)
+                {
+                    return last_error();
+                }
+                if (n == 0)
+                {
+                    return {};
+                }
+                if (!full_write(out, buffer.data(), static_cast<std::size_t>(n)))
+                {
+                    return last_error();
+                }
+            }
+        }
+
+        auto copy_regular_file(const fs::u8path& from, const fs::u8path& to) -> std::error_code
+        {
+            const int in = ::open(from.string().c_str(), O_RDONLY | O_CLOEXEC);
+            if (in < 0)
+            {
+                return last_error();
+            }
+            const auto close_in = on_scope_exit([&] { ::close(in); });
+
+            struct stat st;
+            if (::fstat(in, &st) != 0)
+            {
+                return last_error();
+            }
+            const mode_t mode = st.st_mode & 07777;
+            const int out = ::open(
+                to.string().c_str(),
+                O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                mode
+            );
+            if (out < 0)
+            {
+                return last_error();
+            }
+
+            auto ec = copy_file_data(in, out, static_cast<std::size_t>(st.st_size));
+            // The mode given to open is restricted by the umask
+            if (!ec && (::fchmod(out, mode) != 0))
+            {
+                ec = last_error();
+            }
+            if ((::close(out) != 0) && !ec)
+            {
+                ec = last_error();
+            }
+            if (ec)
+            {
+                std::error_code lec;
+                fs::remove(to, lec);
+            }
+            return ec;
+        }
+#endif
+    }
+
+    void copy_file(const fs::u8path& from, const fs::u8path& to, std::error_code& ec)
+    {
+#ifdef __linux__
+        if (fs::is_regular_file(from, ec))
+        {
+            ec = copy_regular_file(from, to);
+            return;
+        }
+#endif
+        ec.clear();
+        fs::copy(from, to, ec);
+    }
 }
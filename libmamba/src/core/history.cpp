@@ -201,9 +201,9 @@ namespace mamba
             v.reserve(sv.size());
             for (const auto& el : sv)
             {
-                v.emplace_back(specs::MatchSpec::parse(el)
-                                   .or_else([](specs::ParseError&& err) { throw std::move(err); })
-                                   .value());
+                v.emplace_back(*specs::MatchSpec::parse_cached(el)
+                                    .or_else([](specs::ParseError&& err) { throw std::move(err); })
+                                    .value());
             }
             return v;
         };
@@ -4,18 +4,28 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <algorithm>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <regex>
+#include <set>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include <reproc++/reproc.hpp>
 #include <reproc++/run.hpp>
+#include <simdjson.h>
 
+#include "mamba/core/fsutil.hpp"
 #include "mamba/core/link.hpp"
 #include "mamba/core/menuinst.hpp"
 #include "mamba/core/output.hpp"
+#include "mamba/core/thread_utils.hpp"
 #include "mamba/core/transaction_context.hpp"
 #include "mamba/specs/match_spec.hpp"
 #include "mamba/util/build.hpp"
@@ -33,7 +43,30 @@
 
 namespace mamba
 {
-    static const std::regex MENU_PATH_REGEX("^menu[/\\\\].*\\.json$", std::regex_constants::icase);
+    namespace
+    {
+        auto iequal(std::string_view lhs, std::string_view rhs) -> bool
+        {
+            return std::equal(
+                lhs.cbegin(),
+                lhs.cend(),
+                rhs.cbegin(),
+                rhs.cend(),
+                [](char a, char b) { return util::to_lower(a) == util::to_lower(b); }
+            );
+        }
+
+        /** Whether the path matches ``^menu[/\\].*\.json$`` ignoring case. */
+        auto is_menu_path(std::string_view path) -> bool
+        {
+            static constexpr std::string_view menu_dir = "menu";
+            static constexpr std::string_view json_ext = ".json";
+            return (path.size() >= menu_dir.size() + 1 + json_ext.size())
+                   && iequal(path.substr(0, menu_dir.size()), menu_dir)
+                   && ((path[menu_dir.size()] == '/') || (path[menu_dir.size()] == '\\'))
+                   && iequal(path.substr(path.size() - json_ext.size()), json_ext);
+        }
+    }
 
     void python_entry_point_template(std::ostream& out, const python_entry_point_parsed& p)
     {
@@ -86,6 +119,74 @@ namespace mamba
         }
     }
 
+    namespace
+    {
+        /** Directory of an extracted package where its pyc files are cached. */
+        auto pyc_cache_directory(const fs::u8path& extracted_dir, const std::string& py_ver)
+            -> fs::u8path
+        {
+            return extracted_dir / "info" / "pyc_cache" / py_ver;
+        }
+
+        /**
+         * Whether two files have the same modification time.
+         *
+         * A pyc file records the time of its source, so a cached pyc is only valid for linked
+         * sources, not for copied or patched ones.
+         */
+        bool has_same_write_time(const fs::u8path& lhs, const fs::u8path& rhs)
+        {
+            std::error_code lec;
+            std::error_code rec;
+            const auto lhs_time = fs::last_write_time(lhs, lec);
+            const auto rhs_time = fs::last_write_time(rhs, rec);
+            return !lec && !rec && (lhs_time == rhs_time);
+        }
+
+        /** Hard-link, or copy, a cached pyc file into the prefix, if it exists. */
+        bool link_cached_pyc(const fs::u8path& cached, const fs::u8path& target, bool copy)
+        {
+            std::error_code ec;
+            if (!fs::is_regular_file(cached, ec))
+            {
+                return false;
+            }
+            fs::create_directories(target.parent_path(), ec);
+            fs::remove(target, ec);
+            if (!copy)
+            {
+                fs::create_hard_link(cached, target, ec);
+                if (!ec)
+                {
+                    return true;
+                }
+                ec.clear();
+            }
+            mamba_fs::copy_file(cached, target, ec);
+            return !ec;
+        }
+
+        /** Overwrite ranges of a file with the bytes at the same offsets in ``data``. */
+        void write_file_ranges(
+            const fs::u8path& file,
+            const std::string& data,
+            const std::vector<std::pair<std::size_t, std::size_t>>& ranges
+        )
+        {
+            std::fstream out(file.std_path(), std::ios::in | std::ios::out | std::ios::binary);
+            for (const auto& [start, size] : ranges)
+            {
+                out.seekp(static_cast<std::streamoff>(start));
+                out.write(data.data() + start, static_cast<std::streamsize>(size));
+            }
+            out.close();
+            if (out.fail())
+            {
+                throw std::runtime_error("Could not write the patched file " + file.string());
+            }
+        }
+    }
+
     python_entry_point_parsed parse_entry_point(const std::string& ep_def)
     {
         // def looks like: "wheel = wheel.cli:main"
@@ -480,53 +581,121 @@ namespace mamba
         assert(m_context != nullptr);
     }
 
-    bool UnlinkPackage::unlink_path(const nlohmann::json& path_data)
+    namespace
     {
-        const auto& context = m_context->context();
-        std::string subtarget = path_data["_path"].get<std::string>();
-        fs::u8path dst = m_context->target_prefix / subtarget;
+        /**
+         * Read the list of files of a ``conda-meta`` record.
+         *
+         * The on-demand parser only materializes the paths, skipping other package metadata.
+         */
+        auto read_record_paths(const fs::u8path& json) -> std::vector<std::string>
+        {
+            auto content = simdjson::padded_string::load(json.string());
+            if (content.error())
+            {
+                throw std::runtime_error("Could not read package record " + json.string());
+            }
 
-        LOG_TRACE << "Unlinking '" << dst.string() << "'";
-        std::error_code err;
+            auto parser = simdjson::ondemand::parser();
+            auto doc = parser.iterate(content.value_unsafe());
+            auto out = std::vector<std::string>();
+            auto paths = doc["paths_data"]["paths"].get_array();
+            if (paths.error())
+            {
+                return out;
+            }
+            for (auto path : paths.value_unsafe())
+            {
+                out.emplace_back(std::string_view(path["_path"].get_string()));
+            }
+            return out;
+        }
 
-        if (remove_or_rename(context, dst) == 0)
+        /** Remove files, in parallel when there are many of them. */
+        void remove_files(const Context& context, const std::vector<fs::u8path>& files)
         {
-            LOG_DEBUG << "Error when removing file '" << dst.string() << "' will be ignored";
+            parallel_for_each(
+                local_threads_count(context.threads_params),
+                files.size(),
+                [&](std::size_t i)
+                {
+                    LOG_TRACE << "Unlinking '" << files[i].string() << "'";
+                    if (remove_or_rename(context, files[i]) == 0)
+                    {
+                        LOG_DEBUG << "Error when removing file '" << files[i].string()
+                                  << "' will be ignored";
+                    }
+                },
+                /* min_items_per_thread= */ 256
+            );
         }
 
-        // TODO what do we do with empty directories?
-        // remove empty parent path
-        auto parent_path = dst.parent_path();
-        while (true)
+        /**
+         * Remove the directories that became empty after removing the given files.
+         *
+         * Only directories that lost a child are considered, each of them once, from the
+         * deepest to the shallowest so that a directory is checked after all its children.
+         * The prefix itself is never removed.
+         */
+        void remove_empty_parent_directories(
+            const Context& context,
+            const fs::u8path& prefix,
+            const std::vector<fs::u8path>& removed_files
+        )
         {
-            bool exists = fs::exists(parent_path, err);
-            if (err)
+            const auto prefix_str = prefix.string();
+            auto is_in_prefix = [&](const fs::u8path& dir)
             {
-                break;
+                const auto dir_str = dir.string();
+                return (dir_str.size() > prefix_str.size())
+                       && util::starts_with(dir_str, prefix_str);
+            };
+            auto depth = [](const fs::u8path& dir) -> std::size_t
+            {
+                const auto& p = dir.std_path();
+                return static_cast<std::size_t>(std::distance(p.begin(), p.end()));
+            };
+
+            // Deepest directories come first
+            using entry = std::pair<std::size_t, fs::u8path>;
+            auto pending = std::set<entry, std::greater<entry>>();
+            for (const auto& file : removed_files)
+            {
+                auto parent = file.parent_path();
+                if (is_in_prefix(parent))
+                {
+                    const auto d = depth(parent);
+                    pending.emplace(d, std::move(parent));
+                }
             }
-            if (exists)
+
+            while (!pending.empty())
             {
-                bool is_empty = fs::is_empty(parent_path, err);
-                if (err)
+                auto node = pending.extract(pending.begin());
+                const auto& [dir_depth, dir] = node.value();
+
+                std::error_code ec;
+                const bool exists = fs::exists(dir, ec);
+                if (ec)
                 {
-                    break;
+                    continue;
                 }
-                if (is_empty)
+                if (exists)
                 {
-                    remove_or_rename(context, parent_path);
+                    const bool is_empty = fs::is_empty(dir, ec);
+                    if (ec || !is_empty)
+                    {
+                        continue;
+                    }
+                    remove_or_rename(context, dir);
                 }
-                else
+
+                if (auto parent = dir.parent_path(); is_in_prefix(parent))
                 {
-                    break;
+                    pending.emplace(dir_depth - 1, std::move(parent));
                 }
             }
-            parent_path = parent_path.parent_path();
-            if (parent_path == m_context->target_prefix)
-            {
-                break;
-            }
         }
-        return true;
     }
 
     bool UnlinkPackage::execute()
@@ -537,22 +706,22 @@ namespace mamba
         LOG_INFO << "Unlinking package '" << m_specifier << "'";
         LOG_DEBUG << "Use metadata found at '" << json.string() << "'";
 
-        std::ifstream json_file = open_ifstream(json);
-        nlohmann::json json_record;
-        json_file >> json_record;
+        auto paths = read_record_paths(json);
+        std::sort(paths.begin(), paths.end());
 
-        for (auto& path : json_record["paths_data"]["paths"])
+        auto files = std::vector<fs::u8path>();
+        files.reserve(paths.size());
+        for (const auto& path : paths)
         {
-            std::string fpath = path["_path"];
-            if (std::regex_match(fpath, MENU_PATH_REGEX))
+            files.push_back(m_context->target_prefix / path);
+            if (is_menu_path(path))
             {
-                remove_menu_from_json(context, m_context->target_prefix / fpath, m_context);
+                remove_menu_from_json(context, files.back(), m_context);
             }
-
-            unlink_path(path);
         }
 
-        json_file.close();
+        remove_files(context, files);
+        remove_empty_parent_directories(context, m_context->target_prefix, files);
 
         fs::remove(json);
 
@@ -632,6 +801,9 @@ namespace mamba
             // TODO windows does something else here
 
             std::string buffer;
+            // Byte ranges changed in a binary file, when its size did not change
+            std::vector<std::pair<std::size_t, std::size_t>> patched_ranges;
+            bool same_size = false;
             if (path_data.file_mode != FileMode::BINARY)
             {
                 buffer = read_contents(src, std::ios::in | std::ios::binary);
@@ -709,6 +881,7 @@ namespace mamba
                 std::string padding(padding_size, '\0');
 
                 std::size_t pos = buffer.find(path_data.prefix_placeholder);
+                same_size = true;
                 while (pos != std::string::npos)
                 {
 #if defined(__APPLE__)
@@ -724,6 +897,8 @@ namespace mamba
                     }
 
                     std::string replacement = util::concat(new_prefix, suffix, padding);
+                    same_size = same_size && (replacement.size() == end - pos);
+                    patched_ranges.emplace_back(pos, replacement.size());
                     buffer.replace(pos, end - pos, replacement);
 
                     pos = buffer.find(path_data.prefix_placeholder, pos + new_prefix.size());
@@ -731,11 +906,24 @@ namespace mamba
 #endif
             }
 
-            std::ofstream fo = open_ofstream(dst, std::ios::out | std::ios::binary);
-            fo << buffer;
-            fo.close();
-
             std::error_code lec;
+            if (same_size)
+            {
+                // Unchanged blocks are copied, or shared, by the file system
+                mamba_fs::copy_file(src, dst, lec);
+            }
+            if (same_size && !lec)
+            {
+                fs::permissions(dst, fs::perms::owner_write, fs::perm_options::add, lec);
+                write_file_ranges(dst, buffer, patched_ranges);
+            }
+            else
+            {
+                std::ofstream fo = open_ofstream(dst, std::ios::out | std::ios::binary);
+                fo << buffer;
+                fo.close();
+            }
+
             fs::permissions(dst, fs::status(src).permissions(), lec);
             if (lec)
             {
@@ -788,7 +976,12 @@ namespace mamba
             }
             if (copy)
             {
-                fs::copy(src, dst);
+                std::error_code lec;
+                mamba_fs::copy_file(src, dst, lec);
+                if (lec)
+                {
+                    throw fs::filesystem_error("copy", src.std_path(), dst.std_path(), lec);
+                }
                 LOG_TRACE << "copied '" << src.string() << "'" << std::endl
                           << " --> '" << dst.string() << "'";
             }
@@ -815,21 +1008,53 @@ namespace mamba
         );
     }
 
-    std::vector<fs::u8path> LinkPackage::compile_pyc_files(const std::vector<fs::u8path>& py_files)
+    std::vector<fs::u8path> LinkPackage::compile_pyc_files(
+        const std::vector<fs::u8path>& py_files,
+        const std::vector<std::string>& py_sources
+    )
     {
         if (py_files.size() == 0)
         {
             return {};
         }
 
+        const auto& py_ver = m_context->short_python_version;
+        const auto& prefix = m_context->target_prefix;
+        const auto cache_dir = pyc_cache_directory(m_source, py_ver);
+
         std::vector<fs::u8path> pyc_files;
-        for (auto& f : py_files)
+        std::vector<fs::u8path> to_compile;
+        std::vector<std::pair<fs::u8path, fs::u8path>> to_cache;
+        for (std::size_t i = 0; i < py_files.size(); ++i)
         {
-            pyc_files.push_back(pyc_path(f, m_context->short_python_version));
+            pyc_files.push_back(pyc_path(py_files[i], py_ver));
+            if (!m_context->compile_pyc)
+            {
+                continue;
+            }
+            if (has_same_write_time(m_source / py_sources[i], prefix / py_files[i]))
+            {
+                auto cached_pyc = cache_dir / pyc_path(py_sources[i], py_ver);
+                if (link_cached_pyc(cached_pyc, prefix / pyc_files.back(), m_context->always_copy))
+                {
+                    continue;
+                }
+                to_cache.emplace_back(prefix / pyc_files.back(), std::move(cached_pyc));
+            }
+            to_compile.push_back(py_files[i]);
         }
+
         if (m_context->compile_pyc)
         {
-            m_context->try_pyc_compilation(py_files);
+            LOG_DEBUG << (py_files.size() - to_compile.size()) << " pyc files reused from '"
+                      << cache_dir.string() << "'";
+        }
+        if (!to_compile.empty() && m_context->try_pyc_compilation(to_compile))
+        {
+            for (auto& [compiled, cached] : to_cache)
+            {
+                m_context->add_pyc_cache_entry(std::move(compiled), std::move(cached));
+            }
         }
         return pyc_files;
     }
@@ -1018,6 +1243,7 @@ namespace mamba
             }
 
             std::vector<fs::u8path> for_compilation;
+            std::vector<std::string> for_compilation_sources;
             static std::regex py_file_re("^site-packages[/\\\\][^\\t\\n\\r\\f\\v]+\\.py$");
             for (auto& sub_path_json : paths_data)
             {
@@ -1026,10 +1252,14 @@ namespace mamba
                     for_compilation.push_back(
                         get_python_noarch_target_path(sub_path_json.path, m_context->site_packages_path)
                     );
+                    for_compilation_sources.push_back(sub_path_json.path);
                 }
             }
 
-            std::vector<fs::u8path> pyc_files = compile_pyc_files(for_compilation);
+            std::vector<fs::u8path> pyc_files = compile_pyc_files(
+                for_compilation,
+                for_compilation_sources
+            );
             for (const fs::u8path& pyc_path : pyc_files)
             {
                 out_json["paths_data"]["paths"].push_back({ { "_path", pyc_path.string() },
@@ -1075,7 +1305,7 @@ namespace mamba
         {
             for (auto& path : paths_data)
             {
-                if (std::regex_match(path.path, MENU_PATH_REGEX))
+                if (is_menu_path(path.path))
                 {
                     create_menu_from_json(context, m_context->target_prefix / path.path, m_context);
                 }
@@ -6,6 +6,7 @@
 
 #include "mamba/core/invoke.hpp"
 #include "mamba/core/package_fetcher.hpp"
+#include "mamba/core/package_store.hpp"
 #include "mamba/core/util.hpp"
 #include "mamba/specs/archive.hpp"
 #include "mamba/util/string.hpp"
@@ -283,6 +284,10 @@ namespace mamba
                 // Be sure the first writable cache doesn't contain invalid extracted package
                 clear_extract_path(extract_path);
                 extract_impl(m_tarball_path, extract_path, options);
+                if (options.content_store)
+                {
+                    deduplicate_package_files(extract_path, content_store_path(m_cache_path));
+                }
 
                 interruption_point();
                 LOG_DEBUG << "Extracted to '" << extract_path.string() << "'";
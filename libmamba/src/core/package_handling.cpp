@@ -5,6 +5,24 @@
 // The full license is in the file LICENSE, distributed with this software.
 
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <archive.h>
 #include <archive_entry.h>
 #include <reproc++/run.hpp>
@@ -15,10 +33,12 @@
 #include "mamba/core/package_paths.hpp"
 #include "mamba/core/thread_utils.hpp"
 #include "mamba/core/util_os.hpp"
+#include "mamba/core/util_scope.hpp"
 #include "mamba/util/string.hpp"
 #include "mamba/validation/tools.hpp"
 
 #include "../download/compression.hpp"
+#include "bounded_queue.hpp"
 #include "nlohmann/json.hpp"
 
 namespace mamba
@@ -30,6 +50,10 @@ namespace mamba
             /* .subproc_mode = */ context.command_params.is_mamba_exe
                 ? extract_subproc_mode::mamba_exe
                 : extract_subproc_mode::mamba_package,
+            /* .write_mode = */ context.extract_batched_writes ? extract_write_mode::batched
+                                                               : extract_write_mode::sequential,
+            /* .write_threads = */ local_threads_count(context.threads_params),
+            /* .content_store = */ context.extract_to_content_store,
         };
     }
 
@@ -176,31 +200,483 @@ namespace mamba
         const ExtractOptions& options
     );
 
-    static int copy_data(scoped_archive_read& ar, scoped_archive_write& aw)
+    namespace
     {
-        int r = 0;
-        const void* buff = nullptr;
-        std::size_t size = 0;
-        la_int64_t offset = 0;
+        struct archive_entry_deleter
+        {
+            void operator()(archive_entry* entry) const
+            {
+                archive_entry_free(entry);
+            }
+        };
 
-        while (true && !is_sig_interrupted())
+        /**
+         * Unit of work passed from the decompression stage to the write stage
+         * of the extraction: either the header of a new entry, or a block of
+         * data of the current one.
+         */
+        struct extract_item
         {
-            r = archive_read_data_block(ar, &buff, &size, &offset);
-            if (r == ARCHIVE_EOF)
+            std::unique_ptr<archive_entry, archive_entry_deleter> entry;
+            std::vector<char> data;
+            la_int64_t offset = 0;
+        };
+
+        constexpr std::size_t extract_queue_capacity = 64;
+
+        void write_disk_header(scoped_archive_write& ext, archive_entry* entry)
+        {
+            if (archive_write_header(ext, entry) < ARCHIVE_OK)
             {
-                return ARCHIVE_OK;
+                throw std::runtime_error(archive_error_string(ext));
             }
+        }
+
+        void write_disk_data(scoped_archive_write& ext, const extract_item& item)
+        {
+            auto r = archive_write_data_block(ext, item.data.data(), item.data.size(), item.offset);
             if (r < ARCHIVE_OK)
             {
-                throw std::runtime_error(archive_error_string(ar));
+                const char* err_str = archive_error_string(ext);
+                throw std::runtime_error(
+                    err_str ? err_str : "Extraction: writing data was not successful."
+                );
             }
-            r = static_cast<int>(archive_write_data_block(aw, buff, size, offset));
-            if (r < ARCHIVE_OK)
+        }
+
+        void finish_disk_entry(scoped_archive_write& ext)
+        {
+            int r = archive_write_finish_entry(ext);
+            if (r == ARCHIVE_WARN)
+            {
+                LOG_WARNING << "libarchive warning: " << archive_error_string(ext);
+            }
+            else if (r < ARCHIVE_OK)
+            {
+                throw std::runtime_error(archive_error_string(ext));
+            }
+        }
+
+        void write_extracted_entries(bounded_queue<extract_item>& queue, scoped_archive_write& ext)
+        {
+            bool has_entry = false;
+            while (auto item = queue.pop())
+            {
+                if (item->entry)
+                {
+                    if (has_entry)
+                    {
+                        finish_disk_entry(ext);
+                    }
+                    write_disk_header(ext, item->entry.get());
+                    has_entry = true;
+                }
+                else
+                {
+                    write_disk_data(ext, *item);
+                }
+            }
+            if (has_entry && !queue.is_cancelled())
+            {
+                finish_disk_entry(ext);
+            }
+        }
+
+#ifndef _WIN32
+        /**
+         * A small regular file, buffered in memory until it is written by
+         * the batched_file_writer.
+         */
+        struct file_job
+        {
+            std::string path;
+            std::vector<char> data;
+            mode_t mode = 0;
+            timespec times[2] = {};
+        };
+
+        void write_file_job(const file_job& job)
+        {
+            auto throw_error = [&job](const char* action)
+            {
+                throw std::runtime_error(
+                    fmt::format("Could not {} '{}': {}", action, job.path, std::strerror(errno))
+                );
+            };
+
+            // Same as ARCHIVE_EXTRACT_UNLINK
+            if (::unlink(job.path.c_str()) != 0 && errno != ENOENT)
+            {
+                throw_error("unlink");
+            }
+            const int fd = ::open(
+                job.path.c_str(),
+                O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW,
+                S_IRUSR | S_IWUSR
+            );
+            if (fd < 0)
+            {
+                throw_error("create");
+            }
+            on_scope_exit close_fd([fd]() { ::close(fd); });
+
+            std::size_t written = 0;
+            while (written < job.data.size())
+            {
+                const auto res = ::write(fd, job.data.data() + written, job.data.size() - written);
+                if (res < 0 && errno != EINTR)
+                {
+                    throw_error("write");
+                }
+                written += res > 0 ? static_cast<std::size_t>(res) : 0;
+            }
+            // Same as ARCHIVE_EXTRACT_PERM and ARCHIVE_EXTRACT_TIME
+            if (::fchmod(fd, job.mode) != 0)
+            {
+                throw_error("set permissions of");
+            }
+            if (::futimens(fd, job.times) != 0)
+            {
+                throw_error("set times of");
+            }
+        }
+
+        /**
+         * Pool of threads creating and writing small files concurrently.
+         * Syscalls latency, not bandwidth, dominates the extraction of packages
+         * made of many small files, especially on overlay filesystems.
+         */
+        class batched_file_writer : non_copyable_base
+        {
+        public:
+
+            explicit batched_file_writer(std::size_t n_threads);
+            ~batched_file_writer();
+
+            void submit(file_job job);
+            // Waits for all the submitted files to be written
+            void flush();
+            void finish();
+
+        private:
+
+            void run();
+            void throw_if_failed();
+
+            bounded_queue<file_job> m_jobs;
+            std::vector<std::thread> m_workers;
+            std::mutex m_mutex;
+            std::condition_variable m_done;
+            std::size_t m_pending = 0;
+            std::exception_ptr m_error;
+        };
+
+        batched_file_writer::batched_file_writer(std::size_t n_threads)
+            : m_jobs(4 * n_threads)
+        {
+            for (std::size_t i = 0; i < n_threads; ++i)
+            {
+                m_workers.emplace_back([this]() { run(); });
+            }
+        }
+
+        batched_file_writer::~batched_file_writer()
+        {
+            m_jobs.cancel();
+            for (auto& worker : m_workers)
+            {
+                worker.join();
+            }
+        }
+
+        void batched_file_writer::submit(file_job job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                throw_if_failed();
+                ++m_pending;
+            }
+            if (!m_jobs.push(std::move(job)))
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_pending;
+                throw_if_failed();
+            }
+        }
+
+        void batched_file_writer::flush()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this]() { return m_pending == 0 || m_error; });
+            throw_if_failed();
+        }
+
+        void batched_file_writer::finish()
+        {
+            flush();
+            m_jobs.close();
+            for (auto& worker : m_workers)
+            {
+                worker.join();
+            }
+            m_workers.clear();
+        }
+
+        void batched_file_writer::run()
+        {
+            while (auto job = m_jobs.pop())
+            {
+                std::exception_ptr error;
+                try
+                {
+                    write_file_job(*job);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                    m_jobs.cancel();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    --m_pending;
+                    if (error && !m_error)
+                    {
+                        m_error = error;
+                    }
+                }
+                m_done.notify_all();
+            }
+        }
+
+        void batched_file_writer::throw_if_failed()
+        {
+            if (m_error)
+            {
+                std::rethrow_exception(m_error);
+            }
+        }
+
+        // Larger files are written by libarchive
+        constexpr la_int64_t max_batched_file_size = 1024 * 1024;
+        // Pending files are waited for once there are that many of them, or that many bytes
+        constexpr std::size_t max_pending_files = 4096;
+        constexpr std::size_t max_pending_bytes = 64 * 1024 * 1024;
+
+        // Relative path of an entry without any leading "./", empty if it
+        // must be checked by libarchive (absolute path or ".." component).
+        std::string batchable_path(const char* entry_path)
+        {
+            std::string_view path = (entry_path != nullptr) ? entry_path : "";
+            while (util::starts_with(path, "./"))
+            {
+                path.remove_prefix(2);
+            }
+            if (path.empty() || path.front() == '/')
+            {
+                return {};
+            }
+            for (const auto& part : util::split(path, "/"))
+            {
+                if (part == "..")
+                {
+                    return {};
+                }
+            }
+            return std::string(path);
+        }
+
+        bool
+        has_symlink_parent(const std::string& path, const std::unordered_set<std::string>& symlinks)
+        {
+            for (auto pos = path.find('/'); pos != std::string::npos; pos = path.find('/', pos + 1))
+            {
+                if (symlinks.count(path.substr(0, pos)) > 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Whether a parent directory of path, below destination, is a symlink on disk.
+        // Such entries are left to libarchive, which rejects them with
+        // ARCHIVE_EXTRACT_SECURE_SYMLINKS.
+        bool has_symlink_parent_on_disk(const fs::u8path& destination, const std::string& path)
+        {
+            auto dir = destination;
+            const auto parts = util::split(path, "/");
+            for (std::size_t i = 0; i + 1 < parts.size(); ++i)
+            {
+                dir /= parts[i];
+                std::error_code ec;
+                const auto status = fs::symlink_status(dir, ec);
+                if (ec || !fs::exists(status))
+                {
+                    // The remaining directories are created
+                    return false;
+                }
+                if (fs::is_symlink(status))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Whether an entry written by libarchive may refer to pending files, i.e. it
+        // overwrites or hard links one of them, or replaces one of their parent directories.
+        bool depends_on_pending(
+            archive_entry* entry,
+            const std::string& path,
+            const std::set<std::string>& pending_paths
+        )
+        {
+            if (pending_paths.empty())
+            {
+                return false;
+            }
+            if (path.empty() || pending_paths.count(path) > 0)
+            {
+                return true;
+            }
+            if (archive_entry_filetype(entry) != AE_IFDIR)
+            {
+                const auto dir = path + "/";
+                const auto child = pending_paths.lower_bound(dir);
+                if (child != pending_paths.cend() && util::starts_with(*child, dir))
+                {
+                    return true;
+                }
+            }
+            if (const char* target = archive_entry_hardlink(entry))
+            {
+                const auto target_path = batchable_path(target);
+                return target_path.empty() || pending_paths.count(target_path) > 0;
+            }
+            return false;
+        }
+
+        /**
+         * Same as write_extracted_entries, except that small regular files are
+         * written concurrently by a batched_file_writer. Other entries still go
+         * through libarchive, after flushing the pending files they may depend on.
+         */
+        void write_extracted_entries_batched(
+            bounded_queue<extract_item>& queue,
+            scoped_archive_write& ext,
+            const fs::u8path& destination,
+            std::size_t n_threads
+        )
+        {
+            batched_file_writer files(std::max<std::size_t>(n_threads, 1));
+            std::unordered_set<std::string> created_dirs;
+            std::unordered_set<std::string> symlinks;
+            // Ordered to find the pending files below a directory
+            std::set<std::string> pending_paths;
+            std::size_t pending_bytes = 0;
+            std::optional<file_job> job;
+            bool has_disk_entry = false;
+
+            auto flush_pending = [&]()
+            {
+                files.flush();
+                pending_paths.clear();
+                pending_bytes = 0;
+            };
+
+            auto finish_current_entry = [&]()
+            {
+                if (job.has_value())
+                {
+                    files.submit(std::move(job).value());
+                    job.reset();
+                }
+                else if (has_disk_entry)
+                {
+                    finish_disk_entry(ext);
+                    has_disk_entry = false;
+                }
+            };
+
+            while (auto item = queue.pop())
+            {
+                if (!item->entry)
+                {
+                    if (job.has_value())
+                    {
+                        const auto offset = static_cast<std::size_t>(item->offset);
+                        if (job->data.size() < offset + item->data.size())
+                        {
+                            job->data.resize(offset + item->data.size());
+                        }
+                        std::copy(item->data.begin(), item->data.end(), job->data.data() + offset);
+                    }
+                    else
+                    {
+                        write_disk_data(ext, *item);
+                    }
+                    continue;
+                }
+
+                finish_current_entry();
+                if (pending_paths.size() >= max_pending_files || pending_bytes >= max_pending_bytes)
+                {
+                    flush_pending();
+                }
+                archive_entry* entry = item->entry.get();
+                // Empty for absolute paths and paths containing "..", which are left to
+                // libarchive along with the paths going through a symlink.
+                const std::string path = batchable_path(archive_entry_pathname(entry));
+                const auto full_path = destination / path;
+                const auto parent = full_path.parent_path().string();
+
+                if (!path.empty() && archive_entry_filetype(entry) == AE_IFREG
+                    && archive_entry_hardlink(entry) == nullptr
+                    && archive_entry_size(entry) <= max_batched_file_size
+                    && !has_symlink_parent(path, symlinks) && pending_paths.count(path) == 0
+                    && (created_dirs.count(parent) > 0
+                        || !has_symlink_parent_on_disk(destination, path)))
+                {
+                    if (created_dirs.count(parent) == 0)
+                    {
+                        fs::create_directories(parent);
+                        created_dirs.insert(parent);
+                    }
+
+                    job = file_job{};
+                    job->path = full_path.string();
+                    job->data.reserve(static_cast<std::size_t>(archive_entry_size(entry)));
+                    job->mode = archive_entry_perm(entry) & 07777;
+                    job->times[1] = { archive_entry_mtime(entry), archive_entry_mtime_nsec(entry) };
+                    job->times[0] = archive_entry_atime_is_set(entry)
+                                        ? timespec{ archive_entry_atime(entry),
+                                                    archive_entry_atime_nsec(entry) }
+                                        : job->times[1];
+                    pending_paths.insert(path);
+                    pending_bytes += static_cast<std::size_t>(archive_entry_size(entry));
+                }
+                else
+                {
+                    if (depends_on_pending(entry, path, pending_paths))
+                    {
+                        flush_pending();
+                    }
+                    if (!path.empty() && archive_entry_filetype(entry) == AE_IFLNK)
+                    {
+                        symlinks.insert(path);
+                    }
+                    write_disk_header(ext, entry);
+                    has_disk_entry = true;
+                }
+            }
+
+            if (!queue.is_cancelled())
             {
-                throw std::runtime_error(archive_error_string(aw));
+                finish_current_entry();
+                files.finish();
             }
         }
-        return r;
+#endif
     }
 
     bool path_has_prefix(const fs::u8path& path, const fs::u8path& prefix)
@@ -232,79 +708,93 @@ namespace mamba
         return init_order;
     }
 
-    // Bundle up all files in directory and create destination archive
-    void create_archive(
-        const fs::u8path& directory,
-        const fs::u8path& destination,
-        compression_algorithm ca,
-        int compression_level,
-        int compression_threads,
-        bool (*filter)(const fs::u8path&)
-    )
+    namespace
     {
-        int r;
-
-        extraction_guard g(destination);
-
-        fs::u8path abs_out_path = fs::absolute(destination);
-        scoped_archive_write a;
-        if (ca == compression_algorithm::bzip2)
+        void set_archive_compression(
+            scoped_archive_write& a,
+            compression_algorithm ca,
+            int compression_level,
+            int compression_threads
+        )
         {
-            archive_write_set_format_gnutar(a);
-            archive_write_set_format_pax_restricted(a);  // Note 1
-            archive_write_add_filter_bzip2(a);
-
-            if (compression_level < 0 || compression_level > 9)
+            if (ca == compression_algorithm::bzip2)
             {
-                throw std::runtime_error("bzip2 compression level should be between 0 and 9");
-            }
-            std::string comp_level = std::string("bzip2:compression-level=")
-                                     + std::to_string(compression_level);
-            archive_write_set_options(a, comp_level.c_str());
-        }
-        if (ca == compression_algorithm::zip)
-        {
-            archive_write_set_format_zip(a);
+                archive_write_set_format_gnutar(a);
+                archive_write_set_format_pax_restricted(a);  // Note 1
+                archive_write_add_filter_bzip2(a);
 
-            if (compression_level < 0 || compression_level > 9)
-            {
-                throw std::runtime_error("zip compression level should be between 0 and 9");
+                if (compression_level < 0 || compression_level > 9)
+                {
+                    throw std::runtime_error("bzip2 compression level should be between 0 and 9");
+                }
+                std::string comp_level = std::string("bzip2:compression-level=")
+                                         + std::to_string(compression_level);
+                archive_write_set_options(a, comp_level.c_str());
             }
-            std::string comp_level = std::string("zip:compression-level=")
-                                     + std::to_string(compression_level);
-            archive_write_set_options(a, comp_level.c_str());
-        }
-        if (ca == compression_algorithm::zstd)
-        {
-            archive_write_set_format_gnutar(a);
-            archive_write_set_format_pax_restricted(a);  // Note 1
-            archive_write_add_filter_zstd(a);
-
-            if (compression_level < 1 || compression_level > 22)
+            if (ca == compression_algorithm::zip)
             {
-                throw std::runtime_error("zstd compression level should be between 1 and 22");
+                archive_write_set_format_zip(a);
+
+                if (compression_level < 0 || compression_level > 9)
+                {
+                    throw std::runtime_error("zip compression level should be between 0 and 9");
+                }
+                std::string comp_level = std::string("zip:compression-level=")
+                                         + std::to_string(compression_level);
+                archive_write_set_options(a, comp_level.c_str());
             }
+            if (ca == compression_algorithm::zstd)
+            {
+                archive_write_set_format_gnutar(a);
+                archive_write_set_format_pax_restricted(a);  // Note 1
+                archive_write_add_filter_zstd(a);
 
-            std::string comp_level = std::string("zstd:compression-level=")
-                                     + std::to_string(compression_level);
+                if (compression_level < 1 || compression_level > 22)
+                {
+                    throw std::runtime_error("zstd compression level should be between 1 and 22");
+                }
 
-            int res = archive_write_set_options(a, comp_level.c_str());
-            if (res != 0)
-            {
-                LOG_ERROR << "libarchive error (" << res << ") " << archive_error_string(a);
-            }
+                std::string comp_level = std::string("zstd:compression-level=")
+                                         + std::to_string(compression_level);
 
-            if (compression_threads > 2)
-            {
-                std::string comp_threads_level = std::string("zstd:threads=")
-                                                 + std::to_string(compression_threads);
-                res = archive_write_set_options(a, comp_threads_level.c_str());
+                int res = archive_write_set_options(a, comp_level.c_str());
                 if (res != 0)
                 {
                     LOG_ERROR << "libarchive error (" << res << ") " << archive_error_string(a);
                 }
+
+                // Multi-threaded zstd compresses chunks of the input in parallel
+                if (compression_threads > 1)
+                {
+                    std::string comp_threads_level = std::string("zstd:threads=")
+                                                     + std::to_string(compression_threads);
+                    res = archive_write_set_options(a, comp_threads_level.c_str());
+                    if (res != 0)
+                    {
+                        LOG_ERROR << "libarchive error (" << res << ") " << archive_error_string(a);
+                    }
+                }
             }
         }
+    }
+
+    // Bundle up all files in directory and create destination archive
+    void create_archive(
+        const fs::u8path& directory,
+        const fs::u8path& destination,
+        compression_algorithm ca,
+        int compression_level,
+        int compression_threads,
+        bool (*filter)(const fs::u8path&)
+    )
+    {
+        int r;
+
+        extraction_guard g(destination);
+
+        fs::u8path abs_out_path = fs::absolute(destination);
+        scoped_archive_write a;
+        set_archive_compression(a, ca, compression_level, compression_threads);
 
         archive_write_open_filename(a, abs_out_path.string().c_str());
 
@@ -421,6 +911,33 @@ namespace mamba
         fs::current_path(prev_path);
     }
 
+    namespace
+    {
+        /** Zip the info and pkg archives of a ``.conda`` package, adding its metadata. */
+        void write_conda_container(
+            const fs::u8path& parts_dir,
+            const fs::u8path& out_file,
+            int compression_threads
+        )
+        {
+            nlohmann::json pkg_metadata;
+            pkg_metadata["conda_pkg_format_version"] = 2;
+            const auto metadata_file_path = parts_dir / "metadata.json";
+            std::ofstream metadata_file(metadata_file_path.std_path());
+            metadata_file << pkg_metadata;
+            metadata_file.close();
+
+            create_archive(
+                parts_dir,
+                out_file,
+                zip,
+                0,
+                compression_threads,
+                [](const fs::u8path&) { return false; }
+            );
+        }
+    }
+
     // note the info folder must have already been created!
     void create_package(
         const fs::u8path& directory,
@@ -465,23 +982,106 @@ namespace mamba
                     return p.std_path().begin() != p.std_path().end()
                            && *p.std_path().begin() == "info";
                 }
-            );
-
-            nlohmann::json pkg_metadata;
-            pkg_metadata["conda_pkg_format_version"] = 2;
-            const auto metadata_file_path = tdir.path() / "metadata.json";
-            std::ofstream metadata_file(metadata_file_path.std_path());
-            metadata_file << pkg_metadata;
-            metadata_file.close();
+            );
+
+            write_conda_container(tdir.path(), out_file_abs, compression_threads);
+        }
+    }
+
+    namespace
+    {
+        /**
+         * Reads a file ahead of libarchive on a separate thread, so that
+         * reading from disk overlaps with decompression.
+         */
+        class archive_read_ahead : non_copyable_base
+        {
+        public:
+
+            explicit archive_read_ahead(const fs::u8path& file);
+            ~archive_read_ahead();
+
+            int open(scoped_archive_read& a);
+
+        private:
+
+            static constexpr std::size_t block_size = 1024 * 1024;
+            static constexpr std::size_t max_pending_blocks = 8;
+
+            void read_file();
+            static la_ssize_t read(archive* a, void* client_data, const void** buff);
+
+            fs::u8path m_file;
+            bounded_queue<std::vector<char>> m_blocks;
+            std::vector<char> m_current;
+            std::string m_error;
+            std::thread m_reader;
+        };
+
+        archive_read_ahead::archive_read_ahead(const fs::u8path& file)
+            : m_file(file)
+            , m_blocks(max_pending_blocks)
+        {
+        }
+
+        archive_read_ahead::~archive_read_ahead()
+        {
+            m_blocks.cancel();
+            if (m_reader.joinable())
+            {
+                m_reader.join();
+            }
+        }
+
+        int archive_read_ahead::open(scoped_archive_read& a)
+        {
+            m_reader = std::thread([this] { read_file(); });
+            archive_read_set_read_callback(a, read);
+            archive_read_set_callback_data(a, this);
+            return archive_read_open1(a);
+        }
+
+        void archive_read_ahead::read_file()
+        {
+            std::ifstream in = open_ifstream(m_file);
+            if (!in)
+            {
+                m_error = fmt::format("Could not open {}: {}", m_file.string(), std::strerror(errno));
+            }
+            while (in)
+            {
+                std::vector<char> block(block_size);
+                in.read(block.data(), static_cast<std::streamsize>(block.size()));
+                block.resize(static_cast<std::size_t>(in.gcount()));
+                if (block.empty() || !m_blocks.push(std::move(block)))
+                {
+                    break;
+                }
+            }
+            if (in.bad())
+            {
+                m_error = fmt::format("Could not read {}: {}", m_file.string(), std::strerror(errno));
+            }
+            m_blocks.close();
+        }
 
-            create_archive(
-                tdir.path(),
-                out_file_abs,
-                zip,
-                0,
-                compression_threads,
-                [](const fs::u8path&) { return false; }
-            );
+        la_ssize_t archive_read_ahead::read(archive* a, void* client_data, const void** buff)
+        {
+            auto* self = static_cast<archive_read_ahead*>(client_data);
+            auto block = self->m_blocks.pop();
+            if (!block.has_value())
+            {
+                // The reader thread has finished when the queue is drained
+                if (!self->m_error.empty())
+                {
+                    archive_set_error(a, EIO, "%s", self->m_error.c_str());
+                    return -1;
+                }
+                return 0;
+            }
+            self->m_current = std::move(block).value();
+            *buff = self->m_current.data();
+            return static_cast<la_ssize_t>(self->m_current.size());
         }
     }
 
@@ -497,7 +1097,8 @@ namespace mamba
         archive_read_support_filter_all(a);
 
         auto lock = LockFile(file);
-        int r = archive_read_open_filename(a, file.string().c_str(), 10240);
+        archive_read_ahead read_ahead(file);
+        int r = read_ahead.open(a);
 
         if (r != ARCHIVE_OK)
         {
@@ -530,11 +1131,14 @@ namespace mamba
     )
     {
         auto prev_path = fs::current_path();
+        const auto abs_destination = fs::absolute(destination);
         if (!fs::exists(destination))
         {
             fs::create_directories(destination);
         }
         fs::current_path(destination);
+        // Also restored when a rejected entry aborts the extraction
+        on_scope_exit restore_path([&prev_path]() { fs::current_path(prev_path); });
 
         /* Select which attributes we want to restore. */
         int flags = ARCHIVE_EXTRACT_TIME;
@@ -553,9 +1157,50 @@ namespace mamba
         archive_write_disk_set_options(ext, flags);
         archive_write_disk_set_standard_lookup(ext);
 
+        // Decompression happens on this thread while the filesystem writes
+        // are done by the writer thread.
+        bounded_queue<extract_item> queue(extract_queue_capacity);
+        std::exception_ptr write_error;
+        std::thread writer(
+            [&queue, &ext, &write_error, &abs_destination, &options]()
+            {
+                try
+                {
+#ifndef _WIN32
+                    if (options.write_mode == extract_write_mode::batched)
+                    {
+                        write_extracted_entries_batched(
+                            queue,
+                            ext,
+                            abs_destination,
+                            options.write_threads
+                        );
+                        return;
+                    }
+#endif
+                    write_extracted_entries(queue, ext);
+                }
+                catch (...)
+                {
+                    write_error = std::current_exception();
+                    queue.cancel();
+                }
+            }
+        );
+        on_scope_exit join_writer(
+            [&queue, &writer]()
+            {
+                if (writer.joinable())
+                {
+                    queue.cancel();
+                    writer.join();
+                }
+            }
+        );
+
         int r;
         archive_entry* entry;
-        for (;;)
+        while (!queue.is_cancelled())
         {
             if (is_sig_interrupted())
             {
@@ -572,40 +1217,44 @@ namespace mamba
                 throw std::runtime_error(archive_error_string(a));
             }
 
-            r = archive_write_header(ext, entry);
-            if (r < ARCHIVE_OK)
+            extract_item header;
+            header.entry.reset(archive_entry_clone(entry));
+            if (!queue.push(std::move(header)) || archive_entry_size(entry) <= 0)
             {
-                throw std::runtime_error(archive_error_string(ext));
+                continue;
             }
-            else if (archive_entry_size(entry) > 0)
+
+            const void* buff = nullptr;
+            std::size_t size = 0;
+            la_int64_t offset = 0;
+            while (!is_sig_interrupted())
             {
-                r = copy_data(a, ext);
+                r = archive_read_data_block(a, &buff, &size, &offset);
+                if (r == ARCHIVE_EOF)
+                {
+                    break;
+                }
                 if (r < ARCHIVE_OK)
                 {
-                    const char* err_str = archive_error_string(ext);
-                    if (err_str == nullptr)
-                    {
-                        err_str = archive_error_string(a);
-                    }
-                    if (err_str != nullptr)
-                    {
-                        throw std::runtime_error(err_str);
-                    }
-                    throw std::runtime_error("Extraction: writing data was not successful.");
+                    throw std::runtime_error(archive_error_string(a));
+                }
+                extract_item block;
+                const auto* data = static_cast<const char*>(buff);
+                block.data.assign(data, data + size);
+                block.offset = offset;
+                if (!queue.push(std::move(block)))
+                {
+                    break;
                 }
-            }
-            r = archive_write_finish_entry(ext);
-            if (r == ARCHIVE_WARN)
-            {
-                LOG_WARNING << "libarchive warning: " << archive_error_string(a);
-            }
-            else if (r < ARCHIVE_OK)
-            {
-                throw std::runtime_error(archive_error_string(ext));
             }
         }
 
-        fs::current_path(prev_path);
+        queue.close();
+        writer.join();
+        if (write_error)
+        {
+            std::rethrow_exception(write_error);
+        }
     }
 
     static la_ssize_t file_read(archive*, void* client_data, const void** buff)
@@ -793,33 +1442,558 @@ namespace mamba
         }
     }
 
+    namespace
+    {
+        /** Call a function on every entry of an archive opened for reading. */
+        template <typename Func>
+        void for_each_archive_entry(scoped_archive_read& a, Func&& func)
+        {
+            archive_entry* entry = nullptr;
+            for (;;)
+            {
+                if (is_sig_interrupted())
+                {
+                    throw std::runtime_error("SIGINT received. Aborting.");
+                }
+                const int r = archive_read_next_header(a, &entry);
+                if (r == ARCHIVE_EOF)
+                {
+                    break;
+                }
+                if (r < ARCHIVE_WARN)
+                {
+                    throw std::runtime_error(archive_error_string(a));
+                }
+                func(a, entry);
+            }
+        }
+
+        /** Read the data of the current entry of a source archive. */
+        auto archive_data_reader(archive* source)
+        {
+            return [source](char* buffer, std::size_t size)
+            {
+                const auto len = archive_read_data(source, buffer, size);
+                if (len < 0)
+                {
+                    throw std::runtime_error(
+                        util::concat("libarchive error: ", archive_error_string(source))
+                    );
+                }
+                return static_cast<std::streamsize>(len);
+            };
+        }
+
+        /**
+         * Call a function on every file entry of a package, decompressing it on the fly.
+         *
+         * For ``.conda`` packages, the entries of the ``info`` part come first.
+         * The container is read only once: as the ``info`` part is usually stored last, a
+         * ``pkg`` part preceding it is kept aside, still compressed, in a file of ``spool_dir``.
+         */
+        template <typename Func>
+        void
+        for_each_package_entry(const fs::u8path& pkg_file, const fs::u8path& spool_dir, Func&& func)
+        {
+            if (util::ends_with(pkg_file.string(), ".tar.bz2"))
+            {
+                scoped_archive_read a;
+                archive_read_support_format_tar(a);
+                archive_read_support_filter_all(a);
+
+                archive_read_ahead read_ahead(pkg_file);
+                if (read_ahead.open(a) != ARCHIVE_OK)
+                {
+                    throw std::runtime_error(archive_error_string(a));
+                }
+                for_each_archive_entry(a, func);
+            }
+            else if (util::ends_with(pkg_file.string(), ".conda"))
+            {
+                scoped_archive_read a;
+                archive_read_support_format_zip(a);
+
+                conda_extract_context context(a);
+                const auto path = pkg_file.string();
+                if (archive_read_open_filename(a, path.c_str(), context.buffer.size())
+                    != ARCHIVE_OK)
+                {
+                    throw std::runtime_error(archive_error_string(a));
+                }
+
+                const auto for_each_part_entry = [&]()
+                {
+                    scoped_archive_read inner;
+                    archive_read_support_filter_zstd(inner);
+                    archive_read_support_format_tar(inner);
+                    if (archive_read_open_archive_entry(inner, &context) != ARCHIVE_OK)
+                    {
+                        throw std::runtime_error(archive_error_string(inner));
+                    }
+                    for_each_archive_entry(inner, func);
+                };
+
+                bool info_done = false;
+                auto deferred_pkg = std::optional<TemporaryFile>();
+                for_each_archive_entry(
+                    a,
+                    [&](archive* source, archive_entry* entry)
+                    {
+                        const auto name = fs::u8path(archive_entry_pathname(entry))
+                                              .filename()
+                                              .string();
+                        if (!util::ends_with(name, ".tar.zst"))
+                        {
+                            return;
+                        }
+                        if (util::starts_with(name, "info-"))
+                        {
+                            for_each_part_entry();
+                            info_done = true;
+                        }
+                        else if (util::starts_with(name, "pkg-") && info_done)
+                        {
+                            for_each_part_entry();
+                        }
+                        else if (util::starts_with(name, "pkg-"))
+                        {
+                            deferred_pkg.emplace("mambaf", ".tar.zst", spool_dir);
+                            auto out = open_ofstream(deferred_pkg->path());
+                            const auto read_data = archive_data_reader(source);
+                            std::array<char, 64 * 1024> buffer;
+                            while (const auto len = read_data(buffer.data(), buffer.size()))
+                            {
+                                out.write(buffer.data(), len);
+                            }
+                            if (!out.flush())
+                            {
+                                throw std::runtime_error("Could not spool package " + path);
+                            }
+                        }
+                    }
+                );
+
+                if (deferred_pkg.has_value())
+                {
+                    scoped_archive_read inner;
+                    archive_read_support_filter_zstd(inner);
+                    archive_read_support_format_tar(inner);
+                    const auto deferred_path = deferred_pkg->path().string();
+                    if (archive_read_open_filename(inner, deferred_path.c_str(), 64 * 1024)
+                        != ARCHIVE_OK)
+                    {
+                        throw std::runtime_error(archive_error_string(inner));
+                    }
+                    for_each_archive_entry(inner, func);
+                }
+            }
+            else
+            {
+                throw std::runtime_error("Unknown package format (" + pkg_file.string() + ")");
+            }
+        }
+
+        /**
+         * The path of an entry, without the ``./`` prefix and ``/`` suffix some tools add.
+         *
+         * Empty for the root of the package.
+         */
+        auto package_entry_path(archive_entry* entry) -> fs::u8path
+        {
+            auto path = util::rstrip(archive_entry_pathname(entry), '/');
+            while (util::starts_with(path, "./"))
+            {
+                path = util::lstrip(path.substr(2), '/');
+            }
+            if (path == ".")
+            {
+                return {};
+            }
+            return path;
+        }
+
+        /** The order of the entries written by ``create_archive``. */
+        auto entry_sort_key(const fs::u8path& path) -> std::pair<int, fs::u8path>
+        {
+            return { order(path), path };
+        }
+
+        /**
+         * Write an entry, header and data, to an archive.
+         *
+         * The data is read with ``read_data(buffer, size)`` until it returns zero.
+         */
+        template <typename ReadData>
+        void write_package_entry(archive_entry* entry, archive* dest, ReadData&& read_data)
+        {
+            // clean out UID and GID, as when creating a package from a directory
+            archive_entry_set_uid(entry, 0);
+            archive_entry_set_gid(entry, 0);
+            archive_entry_set_gname(entry, "");
+            archive_entry_set_uname(entry, "");
+
+            if (archive_write_header(dest, entry) < ARCHIVE_OK)
+            {
+                throw std::runtime_error(
+                    util::concat("libarchive error: ", archive_error_string(dest))
+                );
+            }
+
+            std::array<char, 64 * 1024> buffer;
+            for (;;)
+            {
+                const auto len = read_data(buffer.data(), buffer.size());
+                if (len == 0)
+                {
+                    break;
+                }
+                if (archive_write_data(dest, buffer.data(), static_cast<std::size_t>(len)) < 0)
+                {
+                    throw std::runtime_error(
+                        util::concat("libarchive error: ", archive_error_string(dest))
+                    );
+                }
+            }
+
+            const int r = archive_write_finish_entry(dest);
+            if (r == ARCHIVE_WARN)
+            {
+                LOG_WARNING << "libarchive warning: " << archive_error_string(dest);
+            }
+            else if (r < ARCHIVE_OK)
+            {
+                throw std::runtime_error(
+                    util::concat("libarchive error: ", archive_error_string(dest))
+                );
+            }
+        }
+
+        /**
+         * Copy the entries of a package in the same order as ``create_archive``, without the
+         * directories that are implicitly added by the files therein.
+         *
+         * Entries are written as they are read, which only works when the package is already
+         * in order, such as packages made by ``create_archive`` or conda-build.
+         * Returns false as soon as an entry is out of order, in which case the archives written
+         * so far must be discarded.
+         *
+         * @param select_dest Return the archive in which an entry path is written.
+         */
+        template <typename SelectDest>
+        auto stream_package_entries(
+            const fs::u8path& pkg_file,
+            const fs::u8path& spool_dir,
+            SelectDest&& select_dest
+        ) -> bool
+        {
+            struct unsorted_entry
+            {
+            };
+
+            // In a sorted package, the content of a directory directly follows it, so the
+            // directory is known to be empty when the next entry is not in it.
+            auto pending_dir = std::unique_ptr<archive_entry, archive_entry_deleter>();
+            auto pending_dir_path = fs::u8path();
+            const auto write_pending_dir = [&]()
+            {
+                write_package_entry(
+                    pending_dir.get(),
+                    select_dest(pending_dir_path),
+                    [](char*, std::size_t) { return std::streamsize(0); }
+                );
+            };
+
+            auto last_key = std::optional<std::pair<int, fs::u8path>>();
+            try
+            {
+                for_each_package_entry(
+                    pkg_file,
+                    spool_dir,
+                    [&](archive* source, archive_entry* entry)
+                    {
+                        auto path = package_entry_path(entry);
+                        if (path.empty())
+                        {
+                            return;
+                        }
+                        auto key = entry_sort_key(path);
+                        if (last_key.has_value() && !(last_key.value() < key))
+                        {
+                            throw unsorted_entry{};
+                        }
+                        last_key = std::move(key);
+
+                        if (pending_dir != nullptr)
+                        {
+                            if (!path_has_prefix(path, pending_dir_path))
+                            {
+                                write_pending_dir();
+                            }
+                            pending_dir.reset();
+                        }
+                        if (archive_entry_filetype(entry) == AE_IFDIR)
+                        {
+                            pending_dir.reset(archive_entry_clone(entry));
+                            pending_dir_path = std::move(path);
+                        }
+                        else
+                        {
+                            write_package_entry(
+                                entry,
+                                select_dest(path),
+                                archive_data_reader(source)
+                            );
+                        }
+                    }
+                );
+            }
+            catch (const unsorted_entry&)
+            {
+                return false;
+            }
+            if (pending_dir != nullptr)
+            {
+                write_pending_dir();
+            }
+            return true;
+        }
+
+        /** An entry of a package whose data was spooled to a file. */
+        struct spooled_entry
+        {
+            std::unique_ptr<archive_entry, archive_entry_deleter> entry;
+            fs::u8path path;
+            std::streamoff offset = 0;
+            std::streamsize size = 0;
+        };
+
+        /**
+         * Read all entries of a package, spooling their data to a file.
+         *
+         * Packages can only be read sequentially, so the data of unsorted packages is kept
+         * aside to write the entries in the same order as ``create_archive``, without the
+         * directories that are implicitly added by the files therein.
+         */
+        auto spool_package_entries(
+            const fs::u8path& pkg_file,
+            const fs::u8path& spool_dir,
+            const fs::u8path& spool_file
+        ) -> std::vector<spooled_entry>
+        {
+            auto entries = std::vector<spooled_entry>();
+            auto parent_dirs = std::set<fs::u8path>();
+            auto spool = open_ofstream(spool_file, std::ios::out | std::ios::binary);
+            std::streamoff offset = 0;
+
+            for_each_package_entry(
+                pkg_file,
+                spool_dir,
+                [&](archive* source, archive_entry* entry)
+                {
+                    auto path = package_entry_path(entry);
+                    if (path.empty())
+                    {
+                        return;
+                    }
+                    auto& spooled = entries.emplace_back();
+                    spooled.entry.reset(archive_entry_clone(entry));
+                    spooled.path = std::move(path);
+                    spooled.offset = offset;
+                    for (auto dir = spooled.path.parent_path(); !dir.empty();
+                         dir = dir.parent_path())
+                    {
+                        parent_dirs.insert(dir);
+                    }
+
+                    std::array<char, 64 * 1024> buffer;
+                    const auto read_data = archive_data_reader(source);
+                    while (const auto len = read_data(buffer.data(), buffer.size()))
+                    {
+                        spool.write(buffer.data(), len);
+                        spooled.size += len;
+                    }
+                    offset += spooled.size;
+                }
+            );
+            if (!spool.flush())
+            {
+                throw std::runtime_error("Could not spool package " + pkg_file.string());
+            }
+
+            const auto is_parent_dir = [&](const spooled_entry& e)
+            {
+                return (archive_entry_filetype(e.entry.get()) == AE_IFDIR)
+                       && (parent_dirs.count(e.path) > 0);
+            };
+            entries.erase(
+                std::remove_if(entries.begin(), entries.end(), is_parent_dir),
+                entries.end()
+            );
+            std::stable_sort(
+                entries.begin(),
+                entries.end(),
+                [](const spooled_entry& a, const spooled_entry& b)
+                { return entry_sort_key(a.path) < entry_sort_key(b.path); }
+            );
+            return entries;
+        }
+
+        /**
+         * Copy the entries of a package, spooling them only if they are not in order.
+         *
+         * @param reset_dest Reopen the destination archives, discarding what was streamed.
+         */
+        template <typename SelectDest, typename ResetDest>
+        void copy_package_entries(
+            const fs::u8path& pkg_file,
+            const fs::u8path& spool_dir,
+            SelectDest&& select_dest,
+            ResetDest&& reset_dest
+        )
+        {
+            if (stream_package_entries(pkg_file, spool_dir, select_dest))
+            {
+                return;
+            }
+
+            LOG_DEBUG << "Entries of " << pkg_file << " are not sorted, spooling them";
+            reset_dest();
+            TemporaryFile spool_file("mambaf", ".spool", spool_dir);
+            const auto entries = spool_package_entries(pkg_file, spool_dir, spool_file.path());
+            auto spool = open_ifstream(spool_file.path(), std::ios::in | std::ios::binary);
+            for (const auto& spooled : entries)
+            {
+                spool.seekg(spooled.offset);
+                auto remaining = spooled.size;
+                write_package_entry(
+                    spooled.entry.get(),
+                    select_dest(spooled.path),
+                    [&](char* buffer, std::size_t size)
+                    {
+                        const auto len = std::min<std::streamsize>(
+                            remaining,
+                            static_cast<std::streamsize>(size)
+                        );
+                        if ((len > 0) && !spool.read(buffer, len))
+                        {
+                            throw std::runtime_error(
+                                "Could not read spooled entry " + spooled.path.string()
+                            );
+                        }
+                        remaining -= len;
+                        return len;
+                    }
+                );
+            }
+        }
+
+        void open_archive_write(scoped_archive_write& a, const fs::u8path& file)
+        {
+            if (archive_write_open_filename(a, file.string().c_str()) != ARCHIVE_OK)
+            {
+                throw std::runtime_error(
+                    util::concat("libarchive error: ", archive_error_string(a))
+                );
+            }
+        }
+
+        void close_archive_write(scoped_archive_write& a)
+        {
+            if (archive_write_close(a) != ARCHIVE_OK)
+            {
+                throw std::runtime_error(
+                    util::concat("libarchive error: ", archive_error_string(a))
+                );
+            }
+        }
+    }
+
     bool transmute(
         const fs::u8path& pkg_file,
         const fs::u8path& target,
         int compression_level,
-        int compression_threads,
-        const ExtractOptions& options
+        int compression_threads
     )
     {
-        TemporaryDirectory extract_dir;
+        // Entries are copied from the source package into the new one, without extracting
+        // them on disk.
+        const fs::u8path target_abs = fs::absolute(target);
 
-        if (util::ends_with(pkg_file.string(), ".tar.bz2"))
+        if (util::ends_with(target.string(), ".tar.bz2"))
         {
-            extract_archive(pkg_file, extract_dir, options);
+            extraction_guard g(target_abs);
+            auto a = std::make_unique<scoped_archive_write>();
+            const auto open_dest = [&]()
+            {
+                a = std::make_unique<scoped_archive_write>();
+                set_archive_compression(*a, bzip2, compression_level, compression_threads);
+                open_archive_write(*a, target_abs);
+            };
+            open_dest();
+            copy_package_entries(
+                pkg_file,
+                target_abs.parent_path(),
+                [&](const fs::u8path&) -> archive* { return *a; },
+                open_dest
+            );
+            close_archive_write(*a);
         }
-        else if (util::ends_with(pkg_file.string(), ".conda"))
+        else if (util::ends_with(target.string(), ".conda"))
         {
-            extract_conda(pkg_file, extract_dir, options);
+            // Only the compressed parts are written in the temporary directory
+            TemporaryDirectory tdir;
+            const auto stem = target.stem().string();
+            {
+                auto info = std::make_unique<scoped_archive_write>();
+                auto pkg = std::make_unique<scoped_archive_write>();
+                const auto open_dest = [&]()
+                {
+                    info = std::make_unique<scoped_archive_write>();
+                    set_archive_compression(*info, zstd, compression_level, compression_threads);
+                    open_archive_write(
+                        *info,
+                        tdir.path() / util::concat("info-", stem, ".tar.zst")
+                    );
+
+                    pkg = std::make_unique<scoped_archive_write>();
+                    set_archive_compression(*pkg, zstd, compression_level, compression_threads);
+                    open_archive_write(
+                        *pkg,
+                        tdir.path() / util::concat("pkg-", stem, ".tar.zst")
+                    );
+                };
+                open_dest();
+                copy_package_entries(
+                    pkg_file,
+                    tdir.path(),
+                    [&](const fs::u8path& path) -> archive*
+                    { return path_has_prefix(path, "info") ? *info : *pkg; },
+                    open_dest
+                );
+                close_archive_write(*info);
+                close_archive_write(*pkg);
+            }
+            extraction_guard g(target_abs);
+            write_conda_container(tdir.path(), target_abs, compression_threads);
         }
         else
         {
-            throw std::runtime_error("Unknown package format (" + pkg_file.string() + ")");
+            throw std::runtime_error("Unknown package format (" + target.string() + ")");
         }
-
-        create_package(extract_dir, target, compression_level, compression_threads);
         return true;
     }
 
+    bool transmute(
+        const fs::u8path& pkg_file,
+        const fs::u8path& target,
+        int compression_level,
+        int compression_threads,
+        const ExtractOptions& /* options */
+    )
+    {
+        return transmute(pkg_file, target, compression_level, compression_threads);
+    }
+
     bool validate(const fs::u8path& pkg_folder, const ValidationParams& params)
     {
         auto safety_checks = params.safety_checks;
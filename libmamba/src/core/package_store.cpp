@@ -0,0 +1,187 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "mamba/core/output.hpp"
+#include "mamba/core/package_paths.hpp"
+#include "mamba/core/package_store.hpp"
+#include "mamba/core/util.hpp"
+#include "mamba/util/cryptography.hpp"
+#include "mamba/validation/tools.hpp"
+
+namespace mamba
+{
+    namespace
+    {
+        // Files that only differ by their permissions cannot share an inode
+        auto store_entry_path(
+            const fs::u8path& store_dir,
+            const std::string& sha256,
+            const fs::file_status& status
+        ) -> fs::u8path
+        {
+            const auto perms = static_cast<unsigned>(status.permissions()) & 07777u;
+            return store_dir / sha256.substr(0, 2) / fmt::format("{}-{:o}", sha256, perms);
+        }
+
+        auto has_valid_sha256(const fs::u8path& file, const std::string& sha256) -> bool
+        {
+            std::ifstream infile = open_ifstream(file);
+            return util::Sha256Hasher().file_hex_str(infile) == sha256;
+        }
+
+        /** Atomically replace a file by a hard link to another one. */
+        auto replace_by_hard_link(const fs::u8path& target, const fs::u8path& file) -> bool
+        {
+            const auto tmp = fs::u8path(file.string() + ".mamba_store");
+            std::error_code ec;
+            fs::create_hard_link(target, tmp, ec);
+            if (ec)
+            {
+                return false;
+            }
+            fs::rename(tmp, file, ec);
+            if (ec)
+            {
+                fs::remove(tmp, ec);
+                return false;
+            }
+            return true;
+        }
+
+        auto deduplicate_file(
+            const fs::u8path& file,
+            const PathData& path_data,
+            const fs::u8path& store_dir
+        ) -> std::size_t
+        {
+            std::error_code ec;
+            const auto status = fs::symlink_status(file, ec);
+            if (ec || !fs::is_regular_file(status))
+            {
+                return 0;
+            }
+            const auto size = fs::file_size(file, ec);
+            if (ec || size == 0 || size != path_data.size_in_bytes)
+            {
+                return 0;
+            }
+
+            const auto entry = store_entry_path(store_dir, path_data.sha256, status);
+            if (fs::exists(entry, ec))
+            {
+                if (fs::file_size(entry, ec) == size && !ec && replace_by_hard_link(entry, file))
+                {
+                    return size;
+                }
+                return 0;
+            }
+
+            if (!has_valid_sha256(file, path_data.sha256))
+            {
+                LOG_DEBUG << "Not adding '" << file.string()
+                          << "' to the content store: sha256 does not match paths.json";
+                return 0;
+            }
+            fs::create_directories(entry.parent_path(), ec);
+            fs::create_hard_link(file, entry, ec);
+            if (!ec)
+            {
+                return 0;
+            }
+            // Another process may have added the same content in the meantime
+            if (fs::exists(entry, ec) && fs::file_size(entry, ec) == size && !ec)
+            {
+                return replace_by_hard_link(entry, file) ? size : 0;
+            }
+            return 0;
+        }
+    }
+
+    auto content_store_path(const fs::u8path& pkgs_dir) -> fs::u8path
+    {
+        return pkgs_dir / "store";
+    }
+
+    auto deduplicate_package_files(const fs::u8path& extracted_dir, const fs::u8path& store_dir)
+        -> std::size_t
+    {
+        std::vector<PathData> paths;
+        try
+        {
+            paths = read_paths(extracted_dir);
+        }
+        catch (const std::exception& e)
+        {
+            LOG_WARNING << "Could not read paths of '" << extracted_dir.string()
+                        << "', skipping content store: " << e.what();
+            return 0;
+        }
+
+        std::size_t saved = 0;
+        for (const auto& path_data : paths)
+        {
+            if (path_data.path_type != PathType::HARDLINK
+                || path_data.sha256.size() != validation::MAMBA_SHA256_SIZE_HEX)
+            {
+                continue;
+            }
+            saved += deduplicate_file(extracted_dir / path_data.path, path_data, store_dir);
+        }
+        LOG_DEBUG << "Deduplicated " << saved << " bytes of '" << extracted_dir.string() << "'";
+        return saved;
+    }
+
+    auto collect_content_store_garbage(const fs::u8path& store_dir, bool dry_run) -> std::size_t
+    {
+        std::error_code ec;
+        if (!fs::exists(store_dir, ec))
+        {
+            return 0;
+        }
+
+        std::size_t freed = 0;
+        std::vector<fs::u8path> buckets;
+        for (const auto& bucket : fs::directory_iterator(store_dir, ec))
+        {
+            if (!bucket.is_directory())
+            {
+                continue;
+            }
+            buckets.push_back(bucket.path());
+            for (const auto& entry : fs::directory_iterator(bucket.path(), ec))
+            {
+                // Only the store links to this content anymore
+                if (entry.is_regular_file() && entry.hard_link_count() == 1)
+                {
+                    freed += entry.file_size();
+                    if (!dry_run)
+                    {
+                        LOG_DEBUG << "Removing content store entry '" << entry.path().string()
+                                  << "'";
+                        fs::remove(entry.path(), ec);
+                    }
+                }
+            }
+        }
+        if (!dry_run)
+        {
+            for (const auto& bucket : buckets)
+            {
+                if (fs::is_empty(bucket, ec))
+                {
+                    fs::remove(bucket, ec);
+                }
+            }
+        }
+        return freed;
+    }
+}
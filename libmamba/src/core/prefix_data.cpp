@@ -4,27 +4,248 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <string_view>
 #include <unordered_map>
 #include <utility>
 
+#include <nlohmann/json.hpp>
+#include <simdjson.h>
+
 #include "mamba/core/channel_context.hpp"
 #include "mamba/core/output.hpp"
 #include "mamba/core/prefix_data.hpp"
+#include "mamba/core/thread_utils.hpp"
 #include "mamba/core/util.hpp"
 #include "mamba/specs/conda_url.hpp"
 #include "mamba/util/graph.hpp"
+#include "mamba/util/random.hpp"
 #include "mamba/util/string.hpp"
 
 namespace mamba
 {
-    auto PrefixData::create(const fs::u8path& prefix_path, ChannelContext& channel_context)
-        -> expected_t<PrefixData>
+    namespace
+    {
+        /** Keys of ``conda-meta`` records read by ``specs::PackageInfo``, others are skipped. */
+        constexpr auto package_record_keys = std::array<std::string_view, 19>{
+            "name", "version", "channel", "url", "subdir", "fn", "size", "timestamp", "build",
+            "build_string", "build_number", "license", "md5", "sha256", "signatures",
+            "track_features", "noarch", "depends", "constrains",
+        };
+
+        /**
+         * Read the package metadata of a ``conda-meta`` record.
+         *
+         * Records also contain the list of files of the package (``files`` and ``paths_data``)
+         * which can be very large.
+         * The on-demand parser skips over them without materializing them, and only the keys
+         * known to ``specs::PackageInfo`` are forwarded to its usual JSON deserialization.
+         */
+        auto read_package_record(const fs::u8path& path, simdjson::ondemand::parser& parser)
+            -> nlohmann::json
+        {
+            auto content = simdjson::padded_string::load(path.string());
+            if (content.error())
+            {
+                throw std::runtime_error("Could not read package record " + path.string());
+            }
+
+            auto doc = parser.iterate(content.value_unsafe());
+            auto j = nlohmann::json::object();
+            for (auto field : doc.get_object())
+            {
+                const std::string_view key = field.unescaped_key();
+                const auto key_it = std::find(
+                    package_record_keys.cbegin(),
+                    package_record_keys.cend(),
+                    key
+                );
+                if (key_it != package_record_keys.cend())
+                {
+                    const std::string_view raw = field.value().raw_json();
+                    j[std::string(key)] = nlohmann::json::parse(raw);
+                }
+            }
+            return j;
+        }
+
+        /** Read many ``conda-meta`` records in parallel, in the same order. */
+        auto read_package_records(
+            const std::vector<fs::u8path>& paths,
+            std::size_t threads_count
+        ) -> std::vector<nlohmann::json>
+        {
+            auto records = std::vector<nlohmann::json>(paths.size());
+            parallel_for_each(
+                threads_count,
+                paths.size(),
+                [&](std::size_t i)
+                {
+                    thread_local auto parser = simdjson::ondemand::parser();
+                    records[i] = read_package_record(paths[i], parser);
+                },
+                /* min_items_per_thread= */ 16
+            );
+            return records;
+        }
+
+        /**
+         * The prefix index caches the package metadata of all ``conda-meta`` records.
+         *
+         * It is a MessagePack file mapping each record file name to its size, modification
+         * time, and the metadata read by ``read_package_record``.
+         * It is only written by ``PrefixData::refresh_index`` and loading a prefix never
+         * modifies it.
+         */
+        constexpr std::string_view prefix_index_filename = ".mamba-prefix-index";
+        constexpr int prefix_index_version = 1;
+
+        using mtime_type = fs::file_time_type::rep;
+
+        struct RecordFile
+        {
+            fs::u8path path;
+            std::string name;
+            std::uintmax_t size;
+            mtime_type mtime;
+        };
+
+        auto list_record_files(const fs::u8path& conda_meta_dir) -> std::vector<RecordFile>
+        {
+            auto out = std::vector<RecordFile>();
+            for (auto& p : fs::directory_iterator(conda_meta_dir))
+            {
+                if (util::ends_with(p.path().string(), ".json"))
+                {
+                    out.push_back({
+                        p.path(),
+                        p.path().filename().string(),
+                        p.file_size(),
+                        p.last_write_time().time_since_epoch().count(),
+                    });
+                }
+            }
+            return out;
+        }
+
+        struct PrefixIndex
+        {
+            nlohmann::json records = nlohmann::json::object();
+            mtime_type mtime = 0;
+        };
+
+        /** Return the indexed records, or no records if the index cannot be used. */
+        auto read_prefix_index(const fs::u8path& path) -> PrefixIndex
+        {
+            if (!fs::exists(path))
+            {
+                return {};
+            }
+            try
+            {
+                const auto mtime = fs::last_write_time(path).time_since_epoch().count();
+                auto infile = open_ifstream(path, std::ios::in | std::ios::binary);
+                auto index = nlohmann::json::from_msgpack(infile);
+                const bool valid = index.is_object()
+                                   && (index.value("version", 0) == prefix_index_version)
+                                   && index.contains("records") && index["records"].is_object();
+                if (valid)
+                {
+                    return { std::move(index["records"]), mtime };
+                }
+            }
+            catch (const std::exception& e)
+            {
+                LOG_DEBUG << "Ignoring invalid prefix index " << path << ": " << e.what();
+            }
+            return {};
+        }
+
+        /** Atomically replace the index, failing silently since it is only a cache. */
+        void write_prefix_index(const fs::u8path& path, nlohmann::json records)
+        {
+            auto tmp_path = path;
+            tmp_path += "." + util::generate_random_alphanumeric_string(8) + ".tmp";
+            try
+            {
+                auto index = nlohmann::json{
+                    { "version", prefix_index_version },
+                    { "records", std::move(records) },
+                };
+                {
+                    auto outfile = open_ofstream(tmp_path);
+                    nlohmann::json::to_msgpack(index, outfile);
+                }
+                fs::rename(tmp_path, path);
+            }
+            catch (const std::exception& e)
+            {
+                LOG_DEBUG << "Could not write prefix index " << path << ": " << e.what();
+                auto ec = std::error_code();
+                fs::remove(tmp_path, ec);
+            }
+        }
+
+        /**
+         * Read the package metadata of the given record files.
+         *
+         * Records are taken from the index when their file size and modification time are
+         * unchanged, and the other ones are parsed.
+         * A record modified no earlier than the index was written could have changed within
+         * the same timestamp tick, and is parsed as well.
+         */
+        auto read_record_files(
+            const std::vector<RecordFile>& files,
+            PrefixIndex& index,
+            std::size_t threads_count
+        ) -> std::vector<nlohmann::json>
+        {
+            auto records = std::vector<nlohmann::json>(files.size());
+            auto to_parse = std::vector<std::size_t>();
+            for (std::size_t i = 0; i < files.size(); ++i)
+            {
+                const auto& file = files[i];
+                auto it = index.records.find(file.name);
+                const bool up_to_date = (it != index.records.end()) && it->is_object()
+                                        && it->contains("record") && (file.mtime < index.mtime)
+                                        && (it->value("size", std::uintmax_t(0)) == file.size)
+                                        && (it->value("mtime", mtime_type(0)) == file.mtime);
+                if (up_to_date)
+                {
+                    records[i] = std::move((*it)["record"]);
+                }
+                else
+                {
+                    to_parse.push_back(i);
+                }
+            }
+
+            auto paths = std::vector<fs::u8path>();
+            paths.reserve(to_parse.size());
+            for (const auto i : to_parse)
+            {
+                paths.push_back(files[i].path);
+            }
+            auto parsed = read_package_records(paths, threads_count);
+            for (std::size_t k = 0; k < to_parse.size(); ++k)
+            {
+                records[to_parse[k]] = std::move(parsed[k]);
+            }
+            return records;
+        }
+    }
+
+    auto PrefixData::create(
+        const fs::u8path& prefix_path,
+        ChannelContext& channel_context,
+        std::size_t threads_count
+    ) -> expected_t<PrefixData>
     {
         try
         {
-            return PrefixData(prefix_path, channel_context);
+            return PrefixData(prefix_path, channel_context, threads_count);
         }
         catch (std::exception& e)
         {
@@ -40,7 +261,11 @@ namespace mamba
         }
     }
 
-    PrefixData::PrefixData(const fs::u8path& prefix_path, ChannelContext& channel_context)
+    PrefixData::PrefixData(
+        const fs::u8path& prefix_path,
+        ChannelContext& channel_context,
+        std::size_t threads_count
+    )
         : m_history(prefix_path, channel_context)
         , m_prefix_path(prefix_path)
         , m_channel_context(channel_context)
@@ -48,16 +273,50 @@ namespace mamba
         auto conda_meta_dir = m_prefix_path / "conda-meta";
         if (lexists(conda_meta_dir))
         {
-            for (auto& p : fs::directory_iterator(conda_meta_dir))
+            const auto files = list_record_files(conda_meta_dir);
+            auto index = read_prefix_index(conda_meta_dir / prefix_index_filename);
+            for (auto& record : read_record_files(files, index, threads_count))
             {
-                if (util::ends_with(p.path().string(), ".json"))
-                {
-                    load_single_record(p.path());
-                }
+                LOG_INFO << "Loading single package record: " << record.value("fn", "");
+                add_record(record.get<specs::PackageInfo>());
             }
         }
     }
 
+    void PrefixData::refresh_index(const fs::u8path& prefix_path, std::size_t threads_count)
+    {
+        auto conda_meta_dir = prefix_path / "conda-meta";
+        if (!lexists(conda_meta_dir))
+        {
+            return;
+        }
+
+        // The index is only a cache, a record that cannot be read must not fail the caller
+        try
+        {
+            const auto files = list_record_files(conda_meta_dir);
+            const auto index_path = conda_meta_dir / prefix_index_filename;
+            auto index = read_prefix_index(index_path);
+            auto records = read_record_files(files, index, threads_count);
+
+            auto new_index = nlohmann::json::object();
+            for (std::size_t i = 0; i < files.size(); ++i)
+            {
+                new_index[files[i].name] = {
+                    { "size", files[i].size },
+                    { "mtime", files[i].mtime },
+                    { "record", std::move(records[i]) },
+                };
+            }
+            write_prefix_index(index_path, std::move(new_index));
+        }
+        catch (const std::exception& e)
+        {
+            LOG_WARNING << "Could not refresh prefix index in " << conda_meta_dir << ": "
+                        << e.what();
+        }
+    }
+
     void PrefixData::add_packages(const std::vector<specs::PackageInfo>& packages)
     {
         for (const auto& pkg : packages)
@@ -91,23 +350,27 @@ namespace mamba
             // Add all inverse dependency edges.
             // Since there must be only one package with a given name, we assume that the dependency
             // version are matched properly and that only names must be checked.
-            for (const auto& [to_id, record] : dep_graph.nodes())
-            {
-                for (const auto& dep : record->dependencies)
+            dep_graph.for_each_node_id(
+                [&](node_id to_id)
                 {
-                    // Creating a matchspec to parse the name (there may be a channel)
-                    auto ms = specs::MatchSpec::parse(dep)
-                                  .or_else([](specs::ParseError&& err) { throw std::move(err); })
-                                  .value();
-                    // Ignoring unmatched dependencies, the environment could be broken
-                    // or it could be a matchspec
-                    const auto from_iter = name_to_node_id.find(ms.name().str());
-                    if (from_iter != name_to_node_id.cend())
+                    for (const auto& dep : dep_graph.node(to_id)->dependencies)
                     {
-                        dep_graph.add_edge(from_iter->second, to_id);
+                        // Creating a matchspec to parse the name (there may be a channel)
+                        auto ms = specs::MatchSpec::parse(dep)
+                                      .or_else(
+                                          [](specs::ParseError&& err) { throw std::move(err); }
+                                      )
+                                      .value();
+                        // Ignoring unmatched dependencies, the environment could be broken
+                        // or it could be a matchspec
+                        const auto from_iter = name_to_node_id.find(ms.name().str());
+                        if (from_iter != name_to_node_id.cend())
+                        {
+                            dep_graph.add_edge(from_iter->second, to_id);
+                        }
                     }
                 }
-            }
+            );
 
             // Flip known problematic edges.
             // This is made to address cycles but there is no straightforward way to make
@@ -154,22 +417,31 @@ namespace mamba
     void PrefixData::load_single_record(const fs::u8path& path)
     {
         LOG_INFO << "Loading single package record: " << path;
-        auto infile = open_ifstream(path);
-        nlohmann::json j;
-        infile >> j;
-        auto prec = j.get<specs::PackageInfo>();
+        auto parser = simdjson::ondemand::parser();
+        add_record(read_package_record(path, parser).get<specs::PackageInfo>());
+    }
 
+    void PrefixData::add_record(specs::PackageInfo&& prec)
+    {
         // Some versions of micromamba constructor generate repodata_record.json
         // and conda-meta json files with channel names while mamba expects
         // specs::PackageInfo channels to be platform urls. This fixes the issue described
         // in https://github.com/mamba-org/mamba/issues/2665
 
-        auto channels = m_channel_context.make_channel(prec.channel);
-        // If someone wrote multichannel names in repodata_record, we don't know which one is the
-        // correct URL. This is must never happen!
-        assert(channels.size() == 1);
-        using Credentials = specs::CondaURL::Credentials;
-        prec.channel = channels.front().platform_url(prec.platform).str(Credentials::Remove);
+        // Most records share a handful of channels and platforms
+        auto url_key = std::pair{ std::move(prec.channel), prec.platform };
+        auto url_it = m_channel_urls.find(url_key);
+        if (url_it == m_channel_urls.end())
+        {
+            auto channels = m_channel_context.make_channel(url_key.first);
+            // If someone wrote multichannel names in repodata_record, we don't know which one is
+            // the correct URL. This is must never happen!
+            assert(channels.size() == 1);
+            using Credentials = specs::CondaURL::Credentials;
+            auto url = channels.front().platform_url(prec.platform).str(Credentials::Remove);
+            url_it = m_channel_urls.emplace(std::move(url_key), std::move(url)).first;
+        }
+        prec.channel = url_it->second;
         m_package_records.insert({ prec.name, std::move(prec) });
     }
 }  // namespace mamba
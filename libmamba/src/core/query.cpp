@@ -78,18 +78,27 @@ namespace mamba
         auto database_latest_package(solver::libsolv::Database& db, specs::MatchSpec spec)
             -> std::optional<specs::PackageInfo>
         {
-            auto out = std::optional<specs::PackageInfo>();
+            // Same order as PkgInfoCmp, only materializing the latest package
+            auto latest = std::optional<solver::libsolv::PackageView>();
+            auto latest_version = specs::Version();
             db.for_each_package_matching(
                 spec,
-                [&](auto pkg)
+                [&](const solver::libsolv::PackageView& pkg)
                 {
-                    if (!out || PkgInfoCmp()(&*out, &pkg))
+                    auto version = specs::Version::parse(pkg.version()).value_or(specs::Version());
+                    if (!latest || (latest->name() < pkg.name())
+                        || ((latest->name() == pkg.name()) && (latest_version < version)))
                     {
-                        out = std::move(pkg);
+                        latest = pkg;
+                        latest_version = std::move(version);
                     }
                 }
             );
-            return out;
+            if (latest)
+            {
+                return latest->to_package_info();
+            }
+            return std::nullopt;
         };
 
         class PoolWalker
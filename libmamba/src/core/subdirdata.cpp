@@ -6,6 +6,10 @@
 
 #include <regex>
 #include <stdexcept>
+#include <unordered_set>
+
+#include <nlohmann/json.hpp>
+#include <simdjson.h>
 
 #include "mamba/core/channel_context.hpp"
 #include "mamba/core/output.hpp"
@@ -952,4 +956,64 @@ namespace mamba
         fs::permissions(cache_dir.string().c_str(), new_permissions, fs::perm_options::replace);
         return cache_dir.string();
     }
+
+    auto read_repodata_records(
+        const fs::u8path& repodata_file,
+        const std::vector<std::string>& filenames
+    ) -> std::unordered_map<std::string, nlohmann::json>
+    {
+        auto out = std::unordered_map<std::string, nlohmann::json>();
+        const auto wanted = std::unordered_set<std::string_view>(
+            filenames.cbegin(),
+            filenames.cend()
+        );
+
+        auto content = simdjson::padded_string::load(repodata_file.string());
+        if (content.error())
+        {
+            LOG_WARNING << "Could not read repodata file '" << repodata_file.string() << "'";
+            return out;
+        }
+
+        try
+        {
+            auto parser = simdjson::ondemand::parser();
+            auto doc = parser.iterate(content.value_unsafe());
+            for (auto section : doc.get_object())
+            {
+                const std::string_view section_key = section.unescaped_key();
+                auto extension = std::string_view();
+                if (section_key == "packages")
+                {
+                    extension = ".tar.bz2";
+                }
+                else if (section_key == "packages.conda")
+                {
+                    extension = ".conda";
+                }
+                else
+                {
+                    continue;
+                }
+                for (auto pkg : section.value().get_object())
+                {
+                    const std::string_view filename = pkg.unescaped_key();
+                    if (util::ends_with(filename, extension) && wanted.count(filename) > 0)
+                    {
+                        auto key = std::string(filename);
+                        out[std::move(key)] = nlohmann::json::parse(
+                            std::string_view(pkg.value().raw_json())
+                        );
+                    }
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            LOG_WARNING << "Could not parse repodata file '" << repodata_file.string()
+                        << "': " << e.what();
+            out.clear();
+        }
+        return out;
+    }
 }  // namespace mamba
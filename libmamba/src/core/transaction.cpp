@@ -55,7 +55,7 @@ namespace mamba
             bool found = false;
             db.for_each_package_matching(
                 spec,
-                [&](const auto&)
+                [&](const solver::libsolv::PackageView&)
                 {
                     found = true;
                     return util::LoopControl::Break;
@@ -93,11 +93,11 @@ namespace mamba
             {
                 db.for_each_package_in_repo(
                     *repo,
-                    [&](specs::PackageInfo&& pkg)
+                    [&](const solver::libsolv::PackageView& pkg)
                     {
-                        if (pkg.name == "python")
+                        if (pkg.name() == "python")
                         {
-                            out = std::move(pkg);
+                            out = pkg.to_package_info();
                             return util::LoopControl::Break;
                         }
                         return util::LoopControl::Continue;
@@ -438,7 +438,8 @@ namespace mamba
             return false;
         }
         LOG_INFO << "Waiting for pyc compilation to finish";
-        m_transaction_context.wait_for_pyc_compilation();
+        // Failures are logged by wait_for_pyc_compilation
+        static_cast<void>(m_transaction_context.wait_for_pyc_compilation());
 
         // Get the name of the executable used directly from the command.
         const auto executable = get_self_exe_path().stem().string();
@@ -469,6 +470,8 @@ namespace mamba
         }
 
         prefix.history().add_entry(m_history_entry);
+        // Keep the next load of the prefix fast while we still hold the lock
+        PrefixData::refresh_index(prefix.path(), local_threads_count(ctx.threads_params));
         return true;
     }
 
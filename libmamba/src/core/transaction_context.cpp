@@ -3,6 +3,7 @@
 // Distributed under the terms of the BSD 3-Clause License.
 //
 // The full license is in the file LICENSE, distributed with this software.
+#include <mutex>
 #ifndef _WIN32
 #include <csignal>
 #endif
@@ -11,8 +12,10 @@
 
 #include "mamba/core/error_handling.hpp"
 #include "mamba/core/output.hpp"
+#include "mamba/core/thread_utils.hpp"
 #include "mamba/core/transaction_context.hpp"
 #include "mamba/util/environment.hpp"
+#include "mamba/util/random.hpp"
 #include "mamba/util/string.hpp"
 
 extern const char data_compile_pyc_py[];
@@ -156,7 +159,8 @@ namespace mamba
 
     TransactionContext::~TransactionContext()
     {
-        wait_for_pyc_compilation();
+        // Failures are logged by wait_for_pyc_compilation
+        static_cast<void>(wait_for_pyc_compilation());
     }
 
     void TransactionContext::throw_if_not_ready() const
@@ -170,11 +174,11 @@ namespace mamba
         }
     }
 
-    bool TransactionContext::start_pyc_compilation_process()
+    bool TransactionContext::start_pyc_compilation_processes(std::size_t n_processes)
     {
         throw_if_not_ready();
 
-        if (m_pyc_process)
+        if (m_pyc_processes.size() >= n_processes)
         {
             return true;
         }
@@ -193,10 +197,13 @@ namespace mamba
         {
             if (std::stoull(py_ver_split[0]) >= 3 && std::stoull(py_ver_split[1]) > 5)
             {
-                m_pyc_compileall = std::make_unique<TemporaryFile>();
-                std::ofstream compileall_f = open_ofstream(m_pyc_compileall->path());
-                compile_python_sources(compileall_f);
-                compileall_f.close();
+                if (m_pyc_compileall == nullptr)
+                {
+                    m_pyc_compileall = std::make_unique<TemporaryFile>();
+                    std::ofstream compileall_f = open_ofstream(m_pyc_compileall->path());
+                    compile_python_sources(compileall_f);
+                    compileall_f.close();
+                }
 
                 command = { complete_python_path.string(),
                             "-Wi",
@@ -210,15 +217,14 @@ namespace mamba
             return false;
         }
 
-        m_pyc_process = std::make_unique<reproc::process>();
-
         reproc::options options;
 #ifndef _WIN32
         options.env.behavior = reproc::env::empty;
 #endif
         std::map<std::string, std::string> envmap;
         auto& ctx = context();
-        envmap["MAMBA_EXTRACT_THREADS"] = std::to_string(ctx.threads_params.extract_threads);
+        // Parallelism comes from the number of workers, each compiling its files sequentially
+        envmap["MAMBA_EXTRACT_THREADS"] = "1";
         auto qemu_ld_prefix = util::get_env("QEMU_LD_PREFIX");
         if (qemu_ld_prefix)
         {
@@ -238,28 +244,39 @@ namespace mamba
         const std::string cwd = target_prefix.string();
         options.working_directory = cwd.c_str();
 
-        auto [wrapped_command, script_file] = prepare_wrapped_call(ctx, target_prefix, command);
-        m_pyc_script_file = std::move(script_file);
+        LOG_INFO << "Running " << (n_processes - m_pyc_processes.size())
+                 << " wrapped python compilation commands " << util::join(" ", command);
+        while (m_pyc_processes.size() < n_processes)
+        {
+            auto [wrapped_command, script_file] = prepare_wrapped_call(ctx, target_prefix, command);
+            auto process = std::make_unique<reproc::process>();
+            std::error_code ec = process->start(wrapped_command, options);
 
-        LOG_INFO << "Running wrapped python compilation command " << util::join(" ", command);
-        std::error_code ec = m_pyc_process->start(wrapped_command, options);
+            if (ec == std::errc::no_such_file_or_directory)
+            {
+                LOG_ERROR << "Program not found. Make sure it's available from the PATH. "
+                          << ec.message();
+                // Failure is already reported by returning false
+                static_cast<void>(wait_for_pyc_compilation());
+                return false;
+            }
 
-        if (ec == std::errc::no_such_file_or_directory)
-        {
-            LOG_ERROR << "Program not found. Make sure it's available from the PATH. "
-                      << ec.message();
-            m_pyc_process = nullptr;
-            return false;
+            m_pyc_processes.push_back(std::move(process));
+            m_pyc_script_files.push_back(std::move(script_file));
         }
 
         return true;
     }
 
+    namespace
+    {
+        std::mutex pyc_compilation_mutex;
+    }
+
     bool TransactionContext::try_pyc_compilation(const std::vector<fs::u8path>& py_files)
     {
         throw_if_not_ready();
 
-        static std::mutex pyc_compilation_mutex;
         std::lock_guard<std::mutex> lock(pyc_compilation_mutex);
 
         if (!has_python)
@@ -268,19 +285,42 @@ namespace mamba
             return false;
         }
 
-        if (start_pyc_compilation_process() && !m_pyc_process)
+        if (py_files.empty())
+        {
+            return true;
+        }
+
+        // Workers are started as files come, so that a few files do not start a worker per thread
+        m_pyc_files_count += py_files.size();
+        const auto n_processes = std::min(
+            local_threads_count(context().threads_params),
+            m_pyc_files_count
+        );
+        if (!start_pyc_compilation_processes(n_processes))
         {
             return false;
         }
 
         LOG_INFO << "Compiling " << py_files.size() << " files to pyc";
-        for (auto& f : py_files)
+
+        // Spread files across workers, one line per file
+        auto inputs = std::vector<std::string>(m_pyc_processes.size());
+        for (const auto& f : py_files)
         {
-            auto fs = f.string() + "\n";
+            inputs[m_pyc_next_process] += f.string();
+            inputs[m_pyc_next_process] += '\n';
+            m_pyc_next_process = (m_pyc_next_process + 1) % m_pyc_processes.size();
+        }
 
-            auto [nbytes, ec] = m_pyc_process->write(
-                reinterpret_cast<const uint8_t*>(&fs[0]),
-                fs.size()
+        for (std::size_t i = 0; i < m_pyc_processes.size(); ++i)
+        {
+            if (inputs[i].empty())
+            {
+                continue;
+            }
+            auto [nbytes, ec] = m_pyc_processes[i]->write(
+                reinterpret_cast<const uint8_t*>(inputs[i].data()),
+                inputs[i].size()
             );
             if (ec)
             {
@@ -292,38 +332,45 @@ namespace mamba
         return true;
     }
 
-    void TransactionContext::wait_for_pyc_compilation()
+    bool TransactionContext::wait_for_pyc_compilation()
     {
         throw_if_not_ready();
 
-        if (m_pyc_process)
+        // Close all inputs first so that workers finish concurrently
+        for (auto& process : m_pyc_processes)
         {
-            std::error_code ec;
-            ec = m_pyc_process->close(reproc::stream::in);
-            if (ec)
+            if (auto ec = process->close(reproc::stream::in); ec)
             {
                 LOG_WARNING << "closing stdin failed " << ec.message();
             }
+        }
 
+        bool success = true;
+        for (auto& process : m_pyc_processes)
+        {
             std::string output;
             std::string err;
             reproc::sink::string output_sink(output);
             reproc::sink::string err_sink(err);
-            ec = reproc::drain(*m_pyc_process, output_sink, err_sink);
+            std::error_code ec = reproc::drain(*process, output_sink, err_sink);
             if (ec)
             {
                 LOG_WARNING << "draining failed " << ec.message();
             }
 
             int status = 0;
-            std::tie(status, ec) = m_pyc_process->stop({
+            std::tie(status, ec) = process->stop({
                 { reproc::stop::wait, reproc::milliseconds(100000) },
                 { reproc::stop::terminate, reproc::milliseconds(5000) },
                 { reproc::stop::kill, reproc::milliseconds(2000) },
             });
             if (ec || status != 0)
             {
-                LOG_INFO << "noarch pyc compilation failed (cross-compiling?).";
+                if (success)
+                {
+                    LOG_INFO << "noarch pyc compilation failed (cross-compiling?).";
+                }
+                success = false;
                 if (ec)
                 {
                     LOG_INFO << ec.message();
@@ -331,7 +378,57 @@ namespace mamba
                 LOG_INFO << "stdout:" << output;
                 LOG_INFO << "stdout:" << err;
             }
-            m_pyc_process = nullptr;
+        }
+        m_pyc_processes.clear();
+        m_pyc_script_files.clear();
+        m_pyc_next_process = 0;
+        m_pyc_files_count = 0;
+
+        // Files that failed to compile are skipped, the others can still be cached
+        store_pyc_cache_entries();
+        m_pyc_cache_entries.clear();
+        return success;
+    }
+
+    void TransactionContext::add_pyc_cache_entry(fs::u8path compiled, fs::u8path cached)
+    {
+        std::lock_guard<std::mutex> lock(pyc_compilation_mutex);
+        m_pyc_cache_entries.emplace_back(std::move(compiled), std::move(cached));
+    }
+
+    void TransactionContext::store_pyc_cache_entries()
+    {
+        for (const auto& [compiled, cached] : m_pyc_cache_entries)
+        {
+            std::error_code ec;
+            if (!fs::is_regular_file(compiled, ec) || fs::exists(cached, ec))
+            {
+                continue;
+            }
+
+            // Write under a unique temporary name so that the cache never holds partial files,
+            // even when another process is filling the same entry
+            const auto tmp = fs::u8path(
+                cached.string() + "." + util::generate_random_alphanumeric_string(8) + ".part"
+            );
+            fs::create_directories(cached.parent_path(), ec);
+            fs::create_hard_link(compiled, tmp, ec);
+            if (ec)
+            {
+                ec.clear();
+                fs::copy_file(compiled, tmp, ec);
+            }
+            if (!ec)
+            {
+                fs::rename(tmp, cached, ec);
+            }
+            if (ec)
+            {
+                LOG_DEBUG << "Could not cache pyc file '" << cached.string()
+                          << "': " << ec.message();
+                std::error_code rm_ec;
+                fs::remove(tmp, rm_ec);
+            }
         }
     }
 }
@@ -4,6 +4,8 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <algorithm>
+
 #include <spdlog/spdlog.h>
 
 #include "mamba/util/string.hpp"
@@ -16,21 +18,82 @@ namespace mamba::download
      * CompressionStream *
      *********************/
 
+    namespace
+    {
+        // Upper bound of the preallocation, a wrong Content-Length must not
+        // trigger a huge allocation.
+        constexpr std::size_t max_reserved_output = std::size_t(1) << 30;
+    }
+
     CompressionStream::CompressionStream(writer&& func)
         : m_writer(std::move(func))
     {
     }
 
+    CompressionStream::CompressionStream(std::string& output)
+        : p_output(&output)
+        , m_output_size(output.size())
+    {
+    }
+
     size_t CompressionStream::write(char* in, size_t size)
     {
         return write_impl(in, size);
     }
 
+    void CompressionStream::reserve_output(std::size_t input_size)
+    {
+        if (has_output_buffer() && input_size > 0)
+        {
+            const std::size_t ratio = expected_ratio();
+            const std::size_t expected = std::min(input_size, max_reserved_output / ratio) * ratio;
+            p_output->reserve(m_output_size + expected);
+        }
+    }
+
+    void CompressionStream::finish_output()
+    {
+        if (has_output_buffer())
+        {
+            p_output->resize(m_output_size);
+        }
+    }
+
+    bool CompressionStream::has_output_buffer() const
+    {
+        return p_output != nullptr;
+    }
+
     size_t CompressionStream::invoke_writer(char* in, size_t size)
     {
+        if (has_output_buffer())
+        {
+            p_output->append(in, size);
+            m_output_size += size;
+            return size;
+        }
         return m_writer(in, size);
     }
 
+    std::pair<char*, size_t> CompressionStream::grow_output(std::size_t min_size)
+    {
+        // The buffer is only resized when the data does not fit anymore, and then
+        // grows geometrically, so that each byte is zero-initialized once instead
+        // of once per chunk. The trailing bytes are cut in finish_output.
+        const std::size_t required_size = m_output_size + min_size;
+        if (p_output->size() < required_size)
+        {
+            const std::size_t grown_size = std::max(2 * p_output->size(), p_output->capacity());
+            p_output->resize(std::max(required_size, grown_size));
+        }
+        return { p_output->data() + m_output_size, min_size };
+    }
+
+    void CompressionStream::commit_output(std::size_t written)
+    {
+        m_output_size += written;
+    }
+
     /*************************
      * ZstdCompressionStream *
      *************************/
@@ -43,21 +106,33 @@ namespace mamba::download
         using writer = base_type::writer;
 
         explicit ZstdCompressionStream(writer&& func);
+        explicit ZstdCompressionStream(std::string& output);
         virtual ~ZstdCompressionStream();
 
     private:
 
         size_t write_impl(char* in, size_t size) override;
+        size_t write_to_output(char* in, size_t size);
+        std::size_t expected_ratio() const override;
 
         static constexpr size_t BUFFER_SIZE = 256 * 1024;
 
         ZSTD_DCtx* p_stream;
-        char m_buffer[BUFFER_SIZE];
+        // Only allocated when decompressing through a writer
+        std::unique_ptr<char[]> p_buffer;
     };
 
     ZstdCompressionStream::ZstdCompressionStream(writer&& func)
         : base_type(std::move(func))
         , p_stream(ZSTD_createDCtx())
+        , p_buffer(std::make_unique<char[]>(BUFFER_SIZE))
+    {
+        ZSTD_initDStream(p_stream);
+    }
+
+    ZstdCompressionStream::ZstdCompressionStream(std::string& output)
+        : base_type(output)
+        , p_stream(ZSTD_createDCtx())
     {
         ZSTD_initDStream(p_stream);
     }
@@ -69,8 +144,13 @@ namespace mamba::download
 
     size_t ZstdCompressionStream::write_impl(char* in, size_t size)
     {
+        if (base_type::has_output_buffer())
+        {
+            return write_to_output(in, size);
+        }
+
         ZSTD_inBuffer input = { in, size, 0 };
-        ZSTD_outBuffer output = { m_buffer, BUFFER_SIZE, 0 };
+        ZSTD_outBuffer output = { p_buffer.get(), BUFFER_SIZE, 0 };
 
         while (input.pos < input.size)
         {
@@ -84,7 +164,7 @@ namespace mamba::download
             }
             if (output.pos > 0)
             {
-                size_t wcb_res = base_type::invoke_writer(m_buffer, output.pos);
+                size_t wcb_res = base_type::invoke_writer(p_buffer.get(), output.pos);
                 if (wcb_res != output.pos)
                 {
                     return size + 1;
@@ -95,6 +175,34 @@ namespace mamba::download
         return size;
     }
 
+    size_t ZstdCompressionStream::write_to_output(char* in, size_t size)
+    {
+        ZSTD_inBuffer input = { in, size, 0 };
+        // Decompressing until the output is not full guarantees that
+        // zstd does not hold pending data in its internal buffers.
+        bool output_full = true;
+        while (input.pos < input.size || output_full)
+        {
+            auto [data, capacity] = base_type::grow_output(ZSTD_DStreamOutSize());
+            ZSTD_outBuffer output = { data, capacity, 0 };
+            auto ret = ZSTD_decompressStream(p_stream, &output, &input);
+            base_type::commit_output(output.pos);
+            if (ZSTD_isError(ret))
+            {
+                spdlog::error("ZSTD decompression error: {}", ZSTD_getErrorName(ret));
+                return size + 1;
+            }
+            output_full = output.pos == output.size;
+        }
+        return size;
+    }
+
+    std::size_t ZstdCompressionStream::expected_ratio() const
+    {
+        // Typical compression ratio of repodata.json.zst
+        return 8;
+    }
+
     /**************************
      * Bzip2CompressionStream *
      **************************/
@@ -107,20 +215,36 @@ namespace mamba::download
         using writer = base_type::writer;
 
         explicit Bzip2CompressionStream(writer&& func);
+        explicit Bzip2CompressionStream(std::string& output);
         virtual ~Bzip2CompressionStream();
 
     private:
 
+        void init_stream();
         size_t write_impl(char* in, size_t size) override;
+        std::size_t expected_ratio() const override;
 
         static constexpr size_t BUFFER_SIZE = 256 * 1024;
 
         bz_stream m_stream;
-        char m_buffer[BUFFER_SIZE];
+        // Only allocated when decompressing through a writer
+        std::unique_ptr<char[]> p_buffer;
     };
 
     Bzip2CompressionStream::Bzip2CompressionStream(writer&& func)
         : base_type(std::move(func))
+        , p_buffer(std::make_unique<char[]>(BUFFER_SIZE))
+    {
+        init_stream();
+    }
+
+    Bzip2CompressionStream::Bzip2CompressionStream(std::string& output)
+        : base_type(output)
+    {
+        init_stream();
+    }
+
+    void Bzip2CompressionStream::init_stream()
     {
         m_stream.bzalloc = nullptr;
         m_stream.bzfree = nullptr;
@@ -145,10 +269,19 @@ namespace mamba::download
 
         while (m_stream.avail_in > 0)
         {
-            m_stream.next_out = m_buffer;
-            m_stream.avail_out = Bzip2CompressionStream::BUFFER_SIZE;
+            const bool direct = base_type::has_output_buffer();
+            auto [data, capacity] = direct
+                                        ? base_type::grow_output(BUFFER_SIZE)
+                                        : std::pair<char*, size_t>{ p_buffer.get(), BUFFER_SIZE };
+            m_stream.next_out = data;
+            m_stream.avail_out = static_cast<unsigned int>(capacity);
 
             int ret = BZ2_bzDecompress(&m_stream);
+            const size_t written = capacity - m_stream.avail_out;
+            if (direct)
+            {
+                base_type::commit_output(written);
+            }
             if (ret != BZ_OK && ret != BZ_STREAM_END)
             {
                 // This is temporary...
@@ -157,8 +290,7 @@ namespace mamba::download
                 return size + 1;
             }
 
-            size_t wcb_res = base_type::invoke_writer(m_buffer, BUFFER_SIZE - m_stream.avail_out);
-            if (wcb_res != BUFFER_SIZE - m_stream.avail_out)
+            if (!direct && base_type::invoke_writer(data, written) != written)
             {
                 return size + 1;
             }
@@ -166,6 +298,12 @@ namespace mamba::download
         return size;
     }
 
+    std::size_t Bzip2CompressionStream::expected_ratio() const
+    {
+        // Typical compression ratio of repodata.json.bz2
+        return 8;
+    }
+
     /***********************
      * NoCompressionStream *
      ***********************/
@@ -178,11 +316,13 @@ namespace mamba::download
         using writer = base_type::writer;
 
         explicit NoCompressionStream(writer&& func);
+        explicit NoCompressionStream(std::string& output);
         virtual ~NoCompressionStream() = default;
 
     private:
 
         size_t write_impl(char* in, size_t size) override;
+        std::size_t expected_ratio() const override;
     };
 
     NoCompressionStream::NoCompressionStream(writer&& func)
@@ -190,102 +330,67 @@ namespace mamba::download
     {
     }
 
+    NoCompressionStream::NoCompressionStream(std::string& output)
+        : base_type(output)
+    {
+    }
+
     size_t NoCompressionStream::write_impl(char* in, size_t size)
     {
         return base_type::invoke_writer(in, size);
     }
 
-    std::unique_ptr<CompressionStream> make_compression_stream(
-        const std::string& url,
-        bool is_repodata_zst_from_oci_reg,
-        CompressionStream::writer&& func
-    )
+    std::size_t NoCompressionStream::expected_ratio() const
     {
-        // In the case of fetching from an OCI registry,
-        // the url doesn't end with `.json.zst` extension.
-        // Compressed repodata is rather handled internally
-        // in OCIMirror implementation, and is reflected
-        // by `is_repodata_zst_from_oci_reg`
-        if (util::ends_with(url, ".json.zst") || is_repodata_zst_from_oci_reg)
-        {
-            return std::make_unique<ZstdCompressionStream>(std::move(func));
-        }
-        else if (util::ends_with(url, "json.bz2"))
-        {
-            return std::make_unique<Bzip2CompressionStream>(std::move(func));
-        }
-        else
-        {
-            return std::make_unique<NoCompressionStream>(std::move(func));
-        }
+        return 1;
     }
 
-    // TODO: remove XXXStreams and rename XXXCompressionStream into XXXStream
-
-    /*************
-     * Old stuff *
-     *************/
-
-    size_t ZstdStream::write(char* in, size_t size)
+    namespace
     {
-        ZSTD_inBuffer input = { in, size, 0 };
-        ZSTD_outBuffer output = { buffer, BUFFER_SIZE, 0 };
-
-        while (input.pos < input.size)
+        template <class Sink>
+        std::unique_ptr<CompressionStream>
+        make_compression_stream_impl(
+            const std::string& url,
+            bool is_repodata_zst_from_oci_reg,
+            Sink&& sink
+        )
         {
-            auto ret = ZSTD_decompressStream(stream, &output, &input);
-            if (ZSTD_isError(ret))
+            // In the case of fetching from an OCI registry,
+            // the url doesn't end with `.json.zst` extension.
+            // Compressed repodata is rather handled internally
+            // in OCIMirror implementation, and is reflected
+            // by `is_repodata_zst_from_oci_reg`
+            if (util::ends_with(url, ".json.zst") || is_repodata_zst_from_oci_reg)
             {
-                // This is temporary...
-                // TODO Remove dependency on spdlog after deciding on what to do with logging
-                spdlog::error("ZSTD decompression error: {}", ZSTD_getErrorName(ret));
-                return size + 1;
+                return std::make_unique<ZstdCompressionStream>(std::forward<Sink>(sink));
             }
-            if (output.pos > 0)
+            else if (util::ends_with(url, "json.bz2"))
             {
-                size_t wcb_res = m_write_callback(buffer, 1, output.pos, m_write_callback_data);
-                if (wcb_res != output.pos)
-                {
-                    return size + 1;
-                }
-                output.pos = 0;
+                return std::make_unique<Bzip2CompressionStream>(std::forward<Sink>(sink));
+            }
+            else
+            {
+                return std::make_unique<NoCompressionStream>(std::forward<Sink>(sink));
             }
         }
-        return size;
     }
 
-    size_t Bzip2Stream::write(char* in, size_t size)
+    std::unique_ptr<CompressionStream> make_compression_stream(
+        const std::string& url,
+        bool is_repodata_zst_from_oci_reg,
+        CompressionStream::writer&& func
+    )
     {
-        bz_stream* stream = static_cast<bz_stream*>(m_write_callback_data);
-        stream->next_in = in;
-        stream->avail_in = static_cast<unsigned int>(size);
-
-        while (stream->avail_in > 0)
-        {
-            stream->next_out = buffer;
-            stream->avail_out = Bzip2Stream::BUFFER_SIZE;
-
-            int ret = BZ2_bzDecompress(stream);
-            if (ret != BZ_OK && ret != BZ_STREAM_END)
-            {
-                // This is temporary...
-                // TODO Remove dependency on spdlog after deciding on what to do with logging
-                spdlog::error("Bzip2 decompression error: {}", ret);
-                return size + 1;
-            }
+        return make_compression_stream_impl(url, is_repodata_zst_from_oci_reg, std::move(func));
+    }
 
-            size_t wcb_res = m_write_callback(
-                buffer,
-                1,
-                BUFFER_SIZE - stream->avail_out,
-                m_write_callback_data
-            );
-            if (wcb_res != BUFFER_SIZE - stream->avail_out)
-            {
-                return size + 1;
-            }
-        }
-        return size;
+    std::unique_ptr<CompressionStream> make_compression_stream(
+        const std::string& url,
+        bool is_repodata_zst_from_oci_reg,
+        std::string& output
+    )
+    {
+        return make_compression_stream_impl(url, is_repodata_zst_from_oci_reg, output);
     }
 
 }  // namespace mamba
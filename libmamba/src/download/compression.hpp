@@ -7,6 +7,10 @@
 #ifndef MAMBA_DL_COMPRESSION_HPP
 #define MAMBA_DL_COMPRESSION_HPP
 
+#include <memory>
+#include <string>
+#include <utility>
+
 #include <bzlib.h>
 #include <zstd.h>
 
@@ -30,17 +34,36 @@ namespace mamba::download
 
         size_t write(char* in, size_t size);
 
+        // Hint of the size of the incoming (compressed) data, used to
+        // preallocate the output buffer. No-op when writing to a writer.
+        void reserve_output(std::size_t input_size);
+
+        // Shrinks the output buffer to the data written so far. Must be
+        // called once all the data has been written. No-op when writing
+        // to a writer.
+        void finish_output();
+
     protected:
 
         CompressionStream(writer&& func);
+        CompressionStream(std::string& output);
 
+        bool has_output_buffer() const;
         size_t invoke_writer(char* in, size_t size);
 
+        // Direct output: exposes min_size bytes after the data written so
+        // far, then moves the write position by the size actually written.
+        std::pair<char*, size_t> grow_output(std::size_t min_size);
+        void commit_output(std::size_t written);
+
     private:
 
         virtual size_t write_impl(char* in, size_t size) = 0;
+        virtual std::size_t expected_ratio() const = 0;
 
         writer m_writer;
+        std::string* p_output = nullptr;
+        std::size_t m_output_size = 0;
     };
 
     std::unique_ptr<CompressionStream> make_compression_stream(
@@ -49,79 +72,13 @@ namespace mamba::download
         CompressionStream::writer&& func
     );
 
-    // TODO: remove the following when switching to new CompressionStream
-
-    struct ZstdStream
-    {
-        static constexpr size_t BUFFER_SIZE = 256000;
-
-        ZstdStream(curl_write_callback lwrite_callback, void* write_callback_data)
-            : stream(ZSTD_createDCtx())
-            , m_write_callback(lwrite_callback)
-            , m_write_callback_data(write_callback_data)
-        {
-            ZSTD_initDStream(stream);
-        }
-
-        ~ZstdStream()
-        {
-            ZSTD_freeDCtx(stream);
-        }
-
-        size_t write(char* in, size_t size);
-
-        static size_t write_callback(char* ptr, size_t size, size_t nmemb, void* self)
-        {
-            return static_cast<ZstdStream*>(self)->write(ptr, size * nmemb);
-        }
-
-        ZSTD_DCtx* stream;
-        char buffer[BUFFER_SIZE];
-
-        // original curl callback
-        curl_write_callback m_write_callback;
-        void* m_write_callback_data;
-    };
-
-    struct Bzip2Stream
-    {
-        static constexpr size_t BUFFER_SIZE = 256000;
-
-        Bzip2Stream(curl_write_callback lwrite_callback, void* write_callback_data)
-            : m_write_callback(lwrite_callback)
-            , m_write_callback_data(write_callback_data)
-        {
-            m_stream.bzalloc = nullptr;
-            m_stream.bzfree = nullptr;
-            m_stream.opaque = nullptr;
-
-            error = BZ2_bzDecompressInit(&m_stream, 0, false);
-            if (error != BZ_OK)
-            {
-                throw std::runtime_error("BZ2_bzDecompressInit failed");
-            }
-        }
-
-        size_t write(char* in, size_t size);
-
-        static size_t write_callback(char* ptr, size_t size, size_t nmemb, void* self)
-        {
-            return static_cast<Bzip2Stream*>(self)->write(ptr, size * nmemb);
-        }
-
-        ~Bzip2Stream()
-        {
-            BZ2_bzDecompressEnd(&m_stream);
-        }
-
-        int error;
-        bz_stream m_stream;
-        char buffer[BUFFER_SIZE];
-
-        // original curl callback
-        curl_write_callback m_write_callback;
-        void* m_write_callback_data;
-    };
+    // Decompresses directly at the end of output, avoiding any intermediate
+    // buffer. output must outlive the returned stream.
+    std::unique_ptr<CompressionStream> make_compression_stream(
+        const std::string& url,
+        bool is_repodata_zst_from_oci_reg,
+        std::string& output
+    );
 
     inline size_t get_zstd_buff_out_size()
     {
@@ -8,7 +8,8 @@
 
 #include <spdlog/spdlog.h>
 
-#include "mamba/core/util.hpp"      // for hide_secrets
+#include "mamba/core/util.hpp"  // for hide_secrets
+#include "mamba/core/util_scope.hpp"
 #include "mamba/fs/filesystem.hpp"  // for fs::exists
 #include "mamba/util/environment.hpp"
 
@@ -120,6 +121,7 @@ namespace mamba::download
         }
 
         bool check_resource_exists(
+            const CURLConnectionPool& pool,
             const std::string& url,
             const bool set_low_speed_opt,
             const double connect_timeout_secs,
@@ -128,7 +130,9 @@ namespace mamba::download
             const std::string& ssl_verify
         )
         {
-            auto handle = curl_easy_init();
+            CURLHandle pooled_handle = pool.acquire_handle();
+            on_scope_exit guard([&]() { pool.release_handle(std::move(pooled_handle)); });
+            CURL* handle = unwrap(pooled_handle);
 
             configure_curl_handle(
                 handle,
@@ -247,9 +251,11 @@ namespace mamba::download
     CURLHandle::CURLHandle(CURLHandle&& rhs)
         : m_handle(std::move(rhs.m_handle))
         , p_headers(std::move(rhs.p_headers))
+        , p_share(rhs.p_share)
     {
         rhs.m_handle = nullptr;
         rhs.p_headers = nullptr;
+        rhs.p_share = nullptr;
         std::swap(m_errorbuffer, rhs.m_errorbuffer);
         set_opt(CURLOPT_ERRORBUFFER, m_errorbuffer.data());
     }
@@ -259,6 +265,7 @@ namespace mamba::download
         using std::swap;
         swap(m_handle, rhs.m_handle);
         swap(p_headers, rhs.p_headers);
+        swap(p_share, rhs.p_share);
         swap(m_errorbuffer, rhs.m_errorbuffer);
         set_opt(CURLOPT_ERRORBUFFER, m_errorbuffer.data());
         rhs.set_opt(CURLOPT_ERRORBUFFER, rhs.m_errorbuffer.data());
@@ -410,7 +417,21 @@ namespace mamba::download
 
     void CURLHandle::reset_handle()
     {
+        // curl_easy_reset keeps the live connections and the caches, but resets
+        // all the options, including the ones set upon construction.
         curl_easy_reset(m_handle);
+        m_errorbuffer[0] = '\0';
+        set_opt(CURLOPT_ERRORBUFFER, m_errorbuffer.data());
+        if (p_share != nullptr)
+        {
+            set_opt(CURLOPT_SHARE, unwrap(*p_share));
+        }
+    }
+
+    void CURLHandle::set_share_handle(const CURLShareHandle* share)
+    {
+        p_share = share;
+        set_opt(CURLOPT_SHARE, p_share != nullptr ? unwrap(*p_share) : nullptr);
     }
 
     CURLHandle& CURLHandle::add_header(const std::string& header)
@@ -475,6 +496,11 @@ namespace mamba::download
         return curl_easy_perform(m_handle);
     }
 
+    CURLcode CURLHandle::unpause()
+    {
+        return curl_easy_pause(m_handle, CURLPAUSE_CONT);
+    }
+
     CURLId CURLHandle::get_id() const
     {
         return CURLId(m_handle);
@@ -576,6 +602,16 @@ namespace mamba::download
         return *this;
     }
 
+    void CURLMultiHandle::set_max_parallel_downloads(std::size_t max_parallel_downloads)
+    {
+        m_max_parallel_downloads = max_parallel_downloads;
+        curl_multi_setopt(
+            p_handle,
+            CURLMOPT_MAX_TOTAL_CONNECTIONS,
+            static_cast<int>(max_parallel_downloads)
+        );
+    }
+
     void CURLMultiHandle::add_handle(const CURLHandle& h)
     {
         CURL* unw = unwrap(h);
@@ -660,4 +696,110 @@ namespace mamba::download
         }
         return static_cast<std::size_t>(numfds);
     }
+
+    /*******************
+     * CURLShareHandle *
+     *******************/
+
+    CURLShareHandle::CURLShareHandle()
+        : p_handle(curl_share_init())
+    {
+        if (p_handle == nullptr)
+        {
+            throw curl_error("Could not initialize CURL share handle");
+        }
+        curl_share_setopt(p_handle, CURLSHOPT_LOCKFUNC, &CURLShareHandle::lock_callback);
+        curl_share_setopt(p_handle, CURLSHOPT_UNLOCKFUNC, &CURLShareHandle::unlock_callback);
+        curl_share_setopt(p_handle, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(p_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(p_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        // The connection cache is not shared here: libcurl does not support sharing
+        // it between concurrent threads. Connections are reused through the multi
+        // handles kept alive by CURLConnectionPool instead.
+    }
+
+    CURLShareHandle::~CURLShareHandle()
+    {
+        curl_share_cleanup(p_handle);
+        p_handle = nullptr;
+    }
+
+    void
+    CURLShareHandle::lock_callback(CURL*, curl_lock_data data, curl_lock_access, void* self)
+    {
+        static_cast<CURLShareHandle*>(self)->m_mutexes[static_cast<std::size_t>(data)].lock();
+    }
+
+    void CURLShareHandle::unlock_callback(CURL*, curl_lock_data data, void* self)
+    {
+        static_cast<CURLShareHandle*>(self)->m_mutexes[static_cast<std::size_t>(data)].unlock();
+    }
+
+    CURLSH* unwrap(const CURLShareHandle& h)
+    {
+        return h.p_handle;
+    }
+
+    /**********************
+     * CURLConnectionPool *
+     **********************/
+
+    CURLHandle CURLConnectionPool::acquire_handle() const
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_idle_handles.empty())
+            {
+                CURLHandle handle = std::move(m_idle_handles.back());
+                m_idle_handles.pop_back();
+                return handle;
+            }
+        }
+        CURLHandle handle;
+        handle.set_share_handle(&m_share);
+        return handle;
+    }
+
+    void CURLConnectionPool::release_handle(CURLHandle&& handle) const
+    {
+        if (unwrap(handle) == nullptr)
+        {
+            return;
+        }
+        handle.reset_handle();
+        handle.reset_headers();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_idle_handles.size() < max_idle_handles)
+        {
+            m_idle_handles.push_back(std::move(handle));
+        }
+    }
+
+    CURLMultiHandle CURLConnectionPool::acquire_multi_handle(std::size_t max_parallel_downloads) const
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_idle_multi_handles.empty())
+            {
+                CURLMultiHandle handle = std::move(m_idle_multi_handles.back());
+                m_idle_multi_handles.pop_back();
+                handle.set_max_parallel_downloads(max_parallel_downloads);
+                return handle;
+            }
+        }
+        return CURLMultiHandle(max_parallel_downloads);
+    }
+
+    void CURLConnectionPool::release_multi_handle(CURLMultiHandle&& handle) const
+    {
+        if (handle.p_handle == nullptr)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_idle_multi_handles.size() < max_idle_multi_handles)
+        {
+            m_idle_multi_handles.push_back(std::move(handle));
+        }
+    }
 }  // namespace mamba
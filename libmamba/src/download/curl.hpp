@@ -7,11 +7,14 @@
 #ifndef MAMBA_DL_CURL_HPP
 #define MAMBA_DL_CURL_HPP
 
+#include <array>
 #include <map>
+#include <mutex>
 #include <optional>
 #include <stdexcept>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 // TODO to be removed later and forward declare specific curl structs
 extern "C"
@@ -24,6 +27,8 @@ extern "C"
 
 namespace mamba::download
 {
+    class CURLConnectionPool;
+
     namespace curl
     {
         void configure_curl_handle(
@@ -37,6 +42,7 @@ namespace mamba::download
         );
 
         bool check_resource_exists(
+            const CURLConnectionPool& pool,
             const std::string& url,
             const bool set_low_speed_opt,
             const double connect_timeout_secs,
@@ -87,6 +93,8 @@ namespace mamba::download
         friend class CURLHandle;
         friend class CURLMultiHandle;
     };
+
+    class CURLShareHandle;
 }
 
 template <>
@@ -131,6 +139,10 @@ namespace mamba::download
 
         void reset_handle();
 
+        // The share handle must outlive this handle; it is re-attached
+        // when the handle is reset.
+        void set_share_handle(const CURLShareHandle* share);
+
         CURLHandle& add_header(const std::string& header);
         CURLHandle& add_headers(const std::vector<std::string>& headers);
         CURLHandle& reset_headers();
@@ -146,6 +158,7 @@ namespace mamba::download
         std::string get_curl_effective_url() const;
 
         CURLcode perform();
+        CURLcode unpause();
 
         CURLId get_id() const;
 
@@ -158,6 +171,7 @@ namespace mamba::download
 
         CURL* m_handle;
         curl_slist* p_headers = nullptr;
+        const CURLShareHandle* p_share = nullptr;
         std::array<char, CURL_ERROR_SIZE> m_errorbuffer;
 
         friend CURL* unwrap(const CURLHandle&);
@@ -188,6 +202,8 @@ namespace mamba::download
         CURLMultiHandle(CURLMultiHandle&&);
         CURLMultiHandle& operator=(CURLMultiHandle&&);
 
+        void set_max_parallel_downloads(std::size_t max_parallel_downloads);
+
         void add_handle(const CURLHandle&);
         void remove_handle(const CURLHandle&);
 
@@ -201,6 +217,85 @@ namespace mamba::download
 
         CURLM* p_handle;
         std::size_t m_max_parallel_downloads = 5;
+
+        friend class CURLConnectionPool;
+    };
+
+    /**
+     * Wraps a curl share handle so that the DNS cache and the TLS session
+     * cache are shared among all the easy handles attached to it.
+     *
+     * Access to the shared data is serialized through the lock callbacks,
+     * so that easy handles attached to the same share handle can be used
+     * from different threads.
+     */
+    class CURLShareHandle
+    {
+    public:
+
+        CURLShareHandle();
+        ~CURLShareHandle();
+
+        CURLShareHandle(const CURLShareHandle&) = delete;
+        CURLShareHandle& operator=(const CURLShareHandle&) = delete;
+        CURLShareHandle(CURLShareHandle&&) = delete;
+        CURLShareHandle& operator=(CURLShareHandle&&) = delete;
+
+    private:
+
+        static void lock_callback(CURL*, curl_lock_data data, curl_lock_access, void* self);
+        static void unlock_callback(CURL*, curl_lock_data data, void* self);
+
+        CURLSH* p_handle;
+        std::array<std::mutex, CURL_LOCK_DATA_LAST> m_mutexes;
+
+        friend CURLSH* unwrap(const CURLShareHandle&);
+    };
+
+    /**
+     * Pool of curl handles.
+     *
+     * Easy handles and multi handles are kept alive between calls to
+     * ``download::download`` instead of being recreated for every transfer.
+     * Multi handles hold the connection cache, so reusing them preserves
+     * live connections to the same hosts across calls; all handles are
+     * attached to a single share handle holding the DNS and TLS session
+     * caches.
+     * The pool is owned by a ``Context``, so that handles, caches and
+     * connections are never shared with other contexts.
+     * Handles are never used concurrently: a handle acquired from the pool
+     * is owned by the caller until it is released.
+     */
+    class CURLConnectionPool
+    {
+    public:
+
+        CURLConnectionPool() = default;
+        ~CURLConnectionPool() = default;
+
+        CURLConnectionPool(const CURLConnectionPool&) = delete;
+        CURLConnectionPool& operator=(const CURLConnectionPool&) = delete;
+        CURLConnectionPool(CURLConnectionPool&&) = delete;
+        CURLConnectionPool& operator=(CURLConnectionPool&&) = delete;
+
+        CURLHandle acquire_handle() const;
+        void release_handle(CURLHandle&& handle) const;
+
+        CURLMultiHandle acquire_multi_handle(std::size_t max_parallel_downloads) const;
+        void release_multi_handle(CURLMultiHandle&& handle) const;
+
+    private:
+
+        // Upper bounds on the number of idle handles kept alive
+        static constexpr std::size_t max_idle_handles = 64;
+        static constexpr std::size_t max_idle_multi_handles = 4;
+
+        // Acquiring and releasing handles does not change the observable state of the
+        // pool, so these can be updated through a const pool.
+        CURLShareHandle m_share;
+        mutable std::mutex m_mutex;
+        mutable std::vector<CURLHandle> m_idle_handles;
+        mutable std::vector<CURLMultiHandle> m_idle_multi_handles;
     };
 
     template <class T>
@@ -4,6 +4,8 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <charconv>
+
 #include "mamba/core/invoke.hpp"
 #include "mamba/core/thread_utils.hpp"
 #include "mamba/core/util.hpp"
@@ -119,6 +121,199 @@ namespace mamba::download
 
             return { set_low_speed_opt, set_ssl_no_revoke };
         }
+
+        // Key used to account for the transfers of a same host.
+        // Local files have an empty key and are never limited.
+        std::string get_host_key(const std::string& url)
+        {
+            if (util::is_file_uri(url))
+            {
+                return {};
+            }
+            const auto url_handler = util::URL::parse(url);
+            if (!url_handler)
+            {
+                return {};
+            }
+            std::string host = url_handler->host();
+            const auto& port = url_handler->port();
+            if (port.size())
+            {
+                host += ":" + port;
+            }
+            return host;
+        }
+
+        // Maximum time waiting for the network when some transfers are paused,
+        // so that they are resumed soon after tokens are available again.
+        constexpr std::size_t throttled_wait_ms = 50;
+    }
+
+    /******************************
+     * TokenBucket implementation *
+     ******************************/
+
+    TokenBucket::TokenBucket(std::size_t rate_Bps, time_point now)
+        : m_rate(static_cast<double>(rate_Bps))
+        , m_tokens(m_rate)
+        , m_last_refill(now)
+    {
+    }
+
+    bool TokenBucket::is_limited() const
+    {
+        return m_rate > 0.;
+    }
+
+    bool TokenBucket::has_tokens(time_point now)
+    {
+        if (!is_limited())
+        {
+            return true;
+        }
+        refill(now);
+        return m_tokens > 0.;
+    }
+
+    void TokenBucket::consume(std::size_t size)
+    {
+        if (is_limited())
+        {
+            m_tokens -= static_cast<double>(size);
+        }
+    }
+
+    void TokenBucket::refill(time_point now)
+    {
+        const std::chrono::duration<double> elapsed = now - m_last_refill;
+        if (elapsed.count() > 0.)
+        {
+            m_tokens = std::min(m_rate, m_tokens + elapsed.count() * m_rate);
+            m_last_refill = now;
+        }
+    }
+
+    /*********************************
+     * DownloadBudget implementation *
+     *********************************/
+
+    DownloadBudget::DownloadBudget(DownloadBudgetOptions options)
+        : m_options(std::move(options))
+        , m_bucket(m_options.max_download_speed)
+    {
+    }
+
+    bool DownloadBudget::can_start_transfer(const std::string& host)
+    {
+        if (host.empty())
+        {
+            return true;
+        }
+        HostBudget& budget = get_host_budget(host);
+        if (m_options.max_host_connections != 0
+            && budget.running_transfers >= m_options.max_host_connections)
+        {
+            return false;
+        }
+        // Do not open new connections while the bandwidth budget is exhausted
+        return !is_throttling() || has_tokens(budget);
+    }
+
+    void DownloadBudget::start_transfer(const std::string& host)
+    {
+        if (!host.empty())
+        {
+            ++get_host_budget(host).running_transfers;
+        }
+    }
+
+    void DownloadBudget::finish_transfer(const std::string& host, const CURLHandle& handle)
+    {
+        if (!host.empty())
+        {
+            HostBudget& budget = get_host_budget(host);
+            if (budget.running_transfers > 0)
+            {
+                --budget.running_transfers;
+            }
+        }
+        m_paused_transfers.erase(
+            std::remove_if(
+                m_paused_transfers.begin(),
+                m_paused_transfers.end(),
+                [&handle](const auto& paused) { return *paused.second == handle; }
+            ),
+            m_paused_transfers.end()
+        );
+    }
+
+    bool DownloadBudget::try_receive(const std::string& host, CURLHandle& handle, std::size_t size)
+    {
+        if (host.empty() || !is_throttling())
+        {
+            return true;
+        }
+        HostBudget& budget = get_host_budget(host);
+        if (!has_tokens(budget))
+        {
+            m_paused_transfers.emplace_back(host, &handle);
+            return false;
+        }
+        m_bucket.consume(size);
+        budget.bucket.consume(size);
+        return true;
+    }
+
+    void DownloadBudget::resume_transfers()
+    {
+        if (m_paused_transfers.empty())
+        {
+            return;
+        }
+        // Resuming a transfer may synchronously invoke the write callback,
+        // which can pause it again.
+        auto paused_transfers = std::exchange(m_paused_transfers, {});
+        for (auto& [host, handle] : paused_transfers)
+        {
+            if (has_tokens(get_host_budget(host)))
+            {
+                handle->unpause();
+            }
+            else
+            {
+                m_paused_transfers.emplace_back(std::move(host), handle);
+            }
+        }
+    }
+
+    bool DownloadBudget::has_paused_transfers() const
+    {
+        return !m_paused_transfers.empty();
+    }
+
+    bool DownloadBudget::is_throttling() const
+    {
+        return m_options.max_download_speed != 0 || m_options.max_host_download_speed != 0;
+    }
+
+    auto DownloadBudget::get_host_budget(const std::string& host) -> HostBudget&
+    {
+        auto iter = m_hosts.find(host);
+        if (iter == m_hosts.end())
+        {
+            auto budget = HostBudget{ 0, TokenBucket(m_options.max_host_download_speed) };
+            iter = m_hosts.emplace(host, std::move(budget)).first;
+        }
+        return iter->second;
+    }
+
+    bool DownloadBudget::has_tokens(HostBudget& budget)
+    {
+        const auto now = TokenBucket::clock::now();
+        // Both buckets are refilled, hence no short-circuit
+        const bool global_tokens = m_bucket.has_tokens(now);
+        const bool host_tokens = budget.bucket.has_tokens(now);
+        return global_tokens && host_tokens;
     }
 
     /**********************************
@@ -130,11 +325,19 @@ namespace mamba::download
         const MirrorRequest& request,
         CURLMultiHandle& downloader,
         const Context& context,
+        DownloadBudget& budget,
         on_success_callback success,
         on_failure_callback error
     )
-        : p_impl(std::make_unique<
-                 Impl>(handle, request, downloader, context, std::move(success), std::move(error)))
+        : p_impl(std::make_unique<Impl>(
+              handle,
+              request,
+              downloader,
+              context,
+              budget,
+              std::move(success),
+              std::move(error)
+          ))
     {
     }
 
@@ -149,21 +352,38 @@ namespace mamba::download
         const MirrorRequest& request,
         CURLMultiHandle& downloader,
         const Context& context,
+        DownloadBudget& budget,
         on_success_callback success,
         on_failure_callback error
     )
         : p_handle(&handle)
         , p_request(&request)
+        , p_budget(&budget)
+        , m_host(get_host_key(request.url))
         , m_success_callback(std::move(success))
         , m_failure_callback(std::move(error))
         , m_retry_wait_seconds(static_cast<std::size_t>(context.remote_fetch_params.retry_timeout))
     {
-        p_stream = make_compression_stream(
-            p_request->url,
-            p_request->is_repodata_zst,
-            [this](char* in, std::size_t size) { return this->write_data(in, size); }
-        );
+        if (p_request->filename.has_value())
+        {
+            p_stream = make_compression_stream(
+                p_request->url,
+                p_request->is_repodata_zst,
+                [this](char* in, std::size_t size) { return this->write_data(in, size); }
+            );
+        }
+        else
+        {
+            // In-memory results are decompressed directly into the response
+            // buffer, which is then moved into the Buffer result.
+            p_stream = make_compression_stream(
+                p_request->url,
+                p_request->is_repodata_zst,
+                m_response
+            );
+        }
         configure_handle(context);
+        p_budget->start_transfer(m_host);
         downloader.add_handle(*p_handle);
     }
 
@@ -208,6 +428,7 @@ namespace mamba::download
     void DownloadAttempt::Impl::clean_attempt(CURLMultiHandle& downloader, bool erase_downloaded)
     {
         downloader.remove_handle(*p_handle);
+        p_budget->finish_transfer(m_host, *p_handle);
         p_handle->reset_handle();
 
         if (m_file.is_open())
@@ -452,6 +673,15 @@ namespace mamba::download
             {
                 s->m_last_modified = value;
             }
+            else if (lkey == "content-length")
+            {
+                std::size_t length = 0;
+                const auto res = std::from_chars(value.data(), value.data() + value.size(), length);
+                if (res.ec == std::errc())
+                {
+                    s->p_stream->reserve_output(length);
+                }
+            }
         }
 
         return buffer_size;
@@ -460,7 +690,14 @@ namespace mamba::download
     size_t
     DownloadAttempt::Impl::curl_write_callback(char* buffer, size_t size, size_t nbitems, void* self)
     {
-        return reinterpret_cast<DownloadAttempt::Impl*>(self)->p_stream->write(buffer, size * nbitems);
+        auto* s = reinterpret_cast<DownloadAttempt::Impl*>(self);
+        const size_t buffer_size = size * nbitems;
+        // When paused, curl keeps the data and delivers it again once resumed
+        if (!s->p_budget->try_receive(s->m_host, *s->p_handle, buffer_size))
+        {
+            return CURL_WRITEFUNC_PAUSE;
+        }
+        return s->p_stream->write(buffer, buffer_size);
     }
 
     int DownloadAttempt::Impl::curl_progress_callback(
@@ -558,6 +795,7 @@ namespace mamba::download
         }
         else
         {
+            p_stream->finish_output();
             content = Buffer{ std::move(m_response) };
         }
 
@@ -612,37 +850,47 @@ namespace mamba::download
         }
     }
 
-    void MirrorAttempt::prepare_request(const Request& initial_request)
+    const MirrorRequest& MirrorAttempt::prepare_request(const Request& initial_request)
     {
-        if (m_state != State::LAST_REQUEST_FAILED)
+        // The request may be prepared before the attempt, so that the Downloader
+        // can check the budget of its host.
+        if (!m_request_prepared)
         {
-            m_request = m_request_generators[m_step](initial_request, p_last_content);
-            ++m_step;
-        }
-        else
-        {
-            m_next_retry = std::nullopt;
-            ++m_retries;
-            LOG_DEBUG << "Last request failed! Tried " << m_retries << " over "
-                      << p_mirror->max_retries() << " times";
+            if (m_state != State::LAST_REQUEST_FAILED)
+            {
+                m_request = m_request_generators[m_step](initial_request, p_last_content);
+                ++m_step;
+            }
+            else
+            {
+                m_next_retry = std::nullopt;
+                ++m_retries;
+                LOG_DEBUG << "Last request failed! Tried " << m_retries << " over "
+                          << p_mirror->max_retries() << " times";
+            }
+            m_request_prepared = true;
         }
+        return m_request.value();
     }
 
     auto MirrorAttempt::prepare_attempt(
         CURLHandle& handle,
         CURLMultiHandle& downloader,
         const Context& context,
+        DownloadBudget& budget,
         on_success_callback success,
         on_failure_callback error
     ) -> completion_function
     {
         LOG_DEBUG << "Preparing download...";
         m_state = State::PREPARING_DOWNLOAD;
+        m_request_prepared = false;
         m_attempt = DownloadAttempt(
             handle,
             m_request.value(),
             downloader,
             context,
+            budget,
             std::move(success),
             std::move(error)
         );
@@ -737,9 +985,10 @@ namespace mamba::download
     DownloadTracker::DownloadTracker(
         const Request& request,
         const mirror_set_view& mirrors,
-        DownloadTrackerOptions options
+        DownloadTrackerOptions options,
+        const CURLConnectionPool& pool
     )
-        : m_handle()
+        : m_handle(pool.acquire_handle())
         , p_initial_request(&request)
         , m_mirror_set(mirrors)
         , m_options(std::move(options))
@@ -758,8 +1007,16 @@ namespace mamba::download
         }
     }
 
-    auto DownloadTracker::prepare_new_attempt(CURLMultiHandle& handle, const Context& context)
-        -> completion_map_entry
+    const MirrorRequest& DownloadTracker::prepare_request()
+    {
+        return m_mirror_attempt.prepare_request(*p_initial_request);
+    }
+
+    auto DownloadTracker::prepare_new_attempt(
+        CURLMultiHandle& handle,
+        const Context& context,
+        DownloadBudget& budget
+    ) -> completion_map_entry
     {
         m_state = State::PREPARING;
 
@@ -768,6 +1025,7 @@ namespace mamba::download
             m_handle,
             handle,
             context,
+            budget,
             [this](Success res)
             {
                 expected_t<void> finalize_res = invoke_on_success(res);
@@ -809,6 +1067,13 @@ namespace mamba::download
         return m_attempt_results.back();
     }
 
+    void DownloadTracker::release_handle(CURLMultiHandle& downloader, const CURLConnectionPool& pool)
+    {
+        // Removing a handle that is not attached to the multi handle is harmless.
+        downloader.remove_handle(m_handle);
+        pool.release_handle(std::move(m_handle));
+    }
+
     expected_t<void> DownloadTracker::invoke_on_success(const Success& res) const
     {
         if (!m_mirror_attempt.has_finished())
@@ -996,7 +1261,12 @@ namespace mamba::download
         , p_mirrors(&mirrors)
         , m_options(std::move(options))
         , p_context(&context)
-        , m_curl_handle(context.threads_params.download_threads)
+        , m_curl_handle(context.curl_connection_pool().acquire_multi_handle(
+              context.threads_params.download_threads
+          ))
+        , m_budget({ context.remote_fetch_params.max_host_connections,
+                     context.remote_fetch_params.max_download_speed,
+                     context.remote_fetch_params.max_host_download_speed })
         , m_trackers()
     {
         if (m_options.sort)
@@ -1016,8 +1286,14 @@ namespace mamba::download
             m_requests.begin(),
             m_requests.end(),
             std::back_inserter(m_trackers),
-            [tracker_options, this](const Request& req) {
-                return DownloadTracker(req, p_mirrors->get_mirrors(req.mirror_name), tracker_options);
+            [tracker_options, this](const Request& req)
+            {
+                return DownloadTracker(
+                    req,
+                    p_mirrors->get_mirrors(req.mirror_name),
+                    tracker_options,
+                    p_context->curl_connection_pool()
+                );
             }
         );
         m_waiting_count = m_trackers.size();
@@ -1029,6 +1305,18 @@ namespace mamba::download
         m_waiting_count -= static_cast<size_t>(failed_count);
     }
 
+    Downloader::~Downloader()
+    {
+        // Give the handles back to the pool so that the next downloads reuse the
+        // live connections, the DNS cache and the TLS sessions.
+        auto& pool = p_context->curl_connection_pool();
+        for (auto& tracker : m_trackers)
+        {
+            tracker.release_handle(m_curl_handle, pool);
+        }
+        pool.release_multi_handle(std::move(m_curl_handle));
+    }
+
     MultiResult Downloader::download()
     {
         while (!download_done())
@@ -1046,6 +1334,9 @@ namespace mamba::download
 
     void Downloader::prepare_next_downloads()
     {
+        m_budget.resume_transfers();
+        m_transfers_deferred = false;
+
         size_t running_attempts = m_completion_map.size();
         const size_t max_parallel_downloads = p_context->threads_params.download_threads;
         auto start_filter = mamba::util::filter(
@@ -1057,8 +1348,13 @@ namespace mamba::download
         // Here we loop over all requests contained in filtered m_trackers
         for (auto& tracker : start_filter)
         {
+            if (!m_budget.can_start_transfer(get_host_key(tracker.prepare_request().url)))
+            {
+                m_transfers_deferred = true;
+                continue;
+            }
             auto [iter, success] = m_completion_map.insert(
-                tracker.prepare_new_attempt(m_curl_handle, *p_context)
+                tracker.prepare_new_attempt(m_curl_handle, *p_context, m_budget)
             );
             if (success)
             {
@@ -1072,9 +1368,10 @@ namespace mamba::download
     {
         std::size_t still_running = m_curl_handle.perform();
 
-        if (still_running == m_waiting_count)
+        const bool throttled = m_budget.has_paused_transfers() || m_transfers_deferred;
+        if (still_running == m_waiting_count || throttled)
         {
-            m_curl_handle.wait(m_curl_handle.get_timeout());
+            m_curl_handle.wait(m_curl_handle.get_timeout(throttled ? throttled_wait_ms : 1000u));
         }
 
         while (auto resp = m_curl_handle.pop_message())
@@ -1209,6 +1506,7 @@ namespace mamba::download
         const auto [set_low_speed_opt, set_ssl_no_revoke] = get_env_remote_params(context);
 
         return curl::check_resource_exists(
+            context.curl_connection_pool(),
             util::file_uri_unc2_to_unc4(url),
             set_low_speed_opt,
             context.remote_fetch_params.connect_timeout_secs,
@@ -1217,4 +1515,9 @@ namespace mamba::download
             context.remote_fetch_params.ssl_verify
         );
     }
+
+    std::shared_ptr<CURLConnectionPool> make_curl_connection_pool()
+    {
+        return std::make_shared<CURLConnectionPool>();
+    }
 }
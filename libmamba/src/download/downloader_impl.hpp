@@ -8,8 +8,12 @@
 #define MAMBA_DL_DOWNLOADER_IMPL_HPP
 
 #include <chrono>
+#include <fstream>
 #include <optional>
+#include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "mamba/download/downloader.hpp"
 #include "mamba/download/mirror_map.hpp"
@@ -20,6 +24,85 @@
 
 namespace mamba::download
 {
+    /*
+     * TokenBucket
+     *
+     * Rate limiter refilled at a constant rate (in bytes per second),
+     * holding at most one second worth of tokens. Consuming may bring
+     * the number of tokens below zero, so that a whole chunk of data can
+     * be accepted as soon as some tokens are available.
+     */
+    class TokenBucket
+    {
+    public:
+
+        using clock = std::chrono::steady_clock;
+        using time_point = clock::time_point;
+
+        explicit TokenBucket(std::size_t rate_Bps = 0, time_point now = clock::now());
+
+        bool is_limited() const;
+        bool has_tokens(time_point now = clock::now());
+        void consume(std::size_t size);
+
+    private:
+
+        void refill(time_point now);
+
+        double m_rate = 0.;
+        double m_tokens = 0.;
+        time_point m_last_refill;
+    };
+
+    struct DownloadBudgetOptions
+    {
+        std::size_t max_host_connections = 0;
+        std::size_t max_download_speed = 0;
+        std::size_t max_host_download_speed = 0;
+    };
+
+    /*
+     * DownloadBudget
+     *
+     * Enforces the per host connection caps and the global and per host
+     * bandwidth limits of a Downloader. Transfers exceeding the bandwidth
+     * limits are paused from the write callback and resumed by the
+     * Downloader once tokens are available again.
+     * Transfers to local files (empty host) are never limited.
+     */
+    class DownloadBudget
+    {
+    public:
+
+        explicit DownloadBudget(DownloadBudgetOptions options = {});
+
+        bool can_start_transfer(const std::string& host);
+        void start_transfer(const std::string& host);
+        void finish_transfer(const std::string& host, const CURLHandle& handle);
+
+        // Returns false if the transfer must be paused
+        bool try_receive(const std::string& host, CURLHandle& handle, std::size_t size);
+        void resume_transfers();
+        bool has_paused_transfers() const;
+
+    private:
+
+        struct HostBudget
+        {
+            std::size_t running_transfers = 0;
+            TokenBucket bucket;
+        };
+
+        bool is_throttling() const;
+        HostBudget& get_host_budget(const std::string& host);
+        bool has_tokens(HostBudget& budget);
+
+        DownloadBudgetOptions m_options;
+        TokenBucket m_bucket;
+        std::unordered_map<std::string, HostBudget> m_hosts;
+        std::vector<std::pair<std::string, CURLHandle*>> m_paused_transfers;
+    };
+
     /*
      * DownloadAttempt
      */
@@ -38,6 +121,7 @@ namespace mamba::download
             const MirrorRequest& request,
             CURLMultiHandle& downloader,
             const Context& context,
+            DownloadBudget& budget,
             on_success_callback success,
             on_failure_callback error
         );
@@ -56,6 +140,7 @@ namespace mamba::download
                 const MirrorRequest& request,
                 CURLMultiHandle& downloader,
                 const Context& context,
+                DownloadBudget& budget,
                 on_success_callback success,
                 on_failure_callback error
             );
@@ -89,6 +174,8 @@ namespace mamba::download
 
             CURLHandle* p_handle = nullptr;
             const MirrorRequest* p_request = nullptr;
+            DownloadBudget* p_budget = nullptr;
+            std::string m_host;
             on_success_callback m_success_callback;
             on_failure_callback m_failure_callback;
             std::size_t m_retry_wait_seconds = std::size_t(0);
@@ -124,11 +211,12 @@ namespace mamba::download
         expected_t<void> invoke_on_success(const Success& res) const;
         void invoke_on_failure(const Error& res) const;
 
-        void prepare_request(const Request& initial_request);
+        const MirrorRequest& prepare_request(const Request& initial_request);
         auto prepare_attempt(
             CURLHandle& handle,
             CURLMultiHandle& downloader,
             const Context& context,
+            DownloadBudget& budget,
             on_success_callback success,
             on_failure_callback error
         ) -> completion_function;
@@ -166,6 +254,7 @@ namespace mamba::download
         size_t m_step = 0;
 
         std::optional<MirrorRequest> m_request;
+        bool m_request_prepared = false;
         DownloadAttempt m_attempt;
         const Content* p_last_content = nullptr;
 
@@ -190,11 +279,16 @@ namespace mamba::download
         DownloadTracker(
             const Request& request,
             const mirror_set_view& mirror_set,
-            DownloadTrackerOptions options
+            DownloadTrackerOptions options,
+            const CURLConnectionPool& pool
         );
 
-        auto
-        prepare_new_attempt(CURLMultiHandle& handle, const Context& context) -> completion_map_entry;
+        const MirrorRequest& prepare_request();
+        auto prepare_new_attempt(
+            CURLMultiHandle& handle,
+            const Context& context,
+            DownloadBudget& budget
+        ) -> completion_map_entry;
 
         bool has_failed() const;
         bool can_start_transfer() const;
@@ -202,6 +296,8 @@ namespace mamba::download
 
         const Result& get_result() const;
 
+        void release_handle(CURLMultiHandle& downloader, const CURLConnectionPool& pool);
+
     private:
 
         enum class State
@@ -264,6 +360,13 @@ namespace mamba::download
             const Context& context
         );
 
+        ~Downloader();
+
+        Downloader(const Downloader&) = delete;
+        Downloader& operator=(const Downloader&) = delete;
+        Downloader(Downloader&&) = delete;
+        Downloader& operator=(Downloader&&) = delete;
+
         MultiResult download();
 
     private:
@@ -279,8 +382,10 @@ namespace mamba::download
         Options m_options;
         const Context* p_context;
         CURLMultiHandle m_curl_handle;
+        DownloadBudget m_budget;
         std::vector<DownloadTracker> m_trackers;
         size_t m_waiting_count;
+        bool m_transfers_deferred = false;
 
         using completion_function = DownloadTracker::completion_function;
         std::unordered_map<CURLId, completion_function> m_completion_map;
@@ -156,6 +156,7 @@ namespace mamba::solver::libsolv
                 mamba_error_code::repodata_not_loaded
             );
         }
+        m_data->matcher.clear_version_index();
         auto repo = pool().add_repo(url).second;
         repo.set_url(std::string(url));
 
@@ -205,6 +206,7 @@ namespace mamba::solver::libsolv
         PipAsPythonDependency add
     ) -> expected_t<RepoInfo>
     {
+        m_data->matcher.clear_version_index();
         auto repo = pool().add_repo(expected.url).second;
 
         return read_solv(pool(), repo, path, expected, static_cast<bool>(add))
@@ -226,6 +228,7 @@ namespace mamba::solver::libsolv
 
     auto Database::add_repo_from_packages_impl_pre(std::string_view name) -> RepoInfo
     {
+        m_data->matcher.clear_version_index();
         if (name.empty())
         {
             return RepoInfo(
@@ -266,6 +269,7 @@ namespace mamba::solver::libsolv
 
     void Database::remove_repo(RepoInfo repo)
     {
+        m_data->matcher.clear_version_index();
         pool().remove_repo(repo.id(), /* reuse_ids= */ true);
     }
 
@@ -312,6 +316,34 @@ namespace mamba::solver::libsolv
         return { make_package_info(pool(), solv.value()) };
     }
 
+    auto Database::package_id_to_package_view(PackageId id) const -> PackageView
+    {
+        return { pool(), static_cast<PackageView::PackageId>(id) };
+    }
+
+    auto Database::package_table() const -> PackageTable
+    {
+        auto out = PackageTable();
+        out.reserve(package_count());
+        pool().for_each_solvable_id(
+            [&](solv::SolvableId id)
+            { out.push_back(package_id_to_package_view(static_cast<PackageId>(id))); }
+        );
+        return out;
+    }
+
+    auto Database::package_table_in_repo(RepoInfo repo) const -> PackageTable
+    {
+        const auto ids = packages_in_repo(repo);
+        auto out = PackageTable();
+        out.reserve(ids.size());
+        for (const auto id : ids)
+        {
+            out.push_back(package_id_to_package_view(id));
+        }
+        return out;
+    }
+
     auto Database::packages_in_repo(RepoInfo repo) const -> std::vector<PackageId>
     {
         // TODO maybe we could use a span here depending on libsolv layout
@@ -4,6 +4,8 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <algorithm>
+
 #include <fmt/format.h>
 
 #include "solver/libsolv/matcher.hpp"
@@ -73,7 +75,30 @@ namespace mamba::solver::libsolv
             }
         };
 
-        if (ms.name().is_exact())
+        if (ms.name().is_exact() && !ms.version().is_explicitly_free())
+        {
+            // Only the packages in the ranges of versions given by the VersionSpec need to be
+            // fully matched, which saves most of the work for names with many packages.
+            auto name_id = pool.add_string(ms.name().str());
+            const auto& index = get_version_index(pool, name_id);
+            m_positions_buffer.clear();
+            ms.version().for_each_contained(
+                index.sorted.cbegin(),
+                index.sorted.cend(),
+                [](const auto& entry) -> const specs::Version& { return entry.first.get(); },
+                [&](const auto& entry) { m_positions_buffer.push_back(entry.second); }
+            );
+            // Keep the pool order, as when iterating over all packages
+            std::sort(m_positions_buffer.begin(), m_positions_buffer.end());
+            for (const auto pos : m_positions_buffer)
+            {
+                if (auto s = pool.get_solvable(index.candidates[pos]))
+                {
+                    add_pkg_if_matching(s.value());
+                }
+            }
+        }
+        else if (ms.name().is_exact())
         {
             // Name does not have glob so we can use it as index into packages with exact name.
             auto name_id = pool.add_string(ms.name().str());
@@ -97,9 +122,10 @@ namespace mamba::solver::libsolv
         const MatchFlags& flags
     ) -> solv::OffsetId
     {
-        return specs::MatchSpec::parse(dep)
-            .transform([&](const specs::MatchSpec& ms)
-                       { return get_matching_packages(pool, ms, flags); })
+        // Dependencies are recurring among packages so we make use of the parse cache.
+        return specs::MatchSpec::parse_cached(dep)
+            .transform([&](const std::shared_ptr<const specs::MatchSpec>& ms)
+                       { return get_matching_packages(pool, *ms, flags); })
             .or_else(
                 [&](const auto& error) -> specs::expected_parse_t<solv::OffsetId>
                 {
@@ -137,6 +163,42 @@ namespace mamba::solver::libsolv
         }
     }
 
+    void Matcher::clear_version_index()
+    {
+        m_version_index.clear();
+    }
+
+    auto Matcher::get_version_index(solv::ObjPoolView pool, solv::StringId name_id)
+        -> const VersionIndex&
+    {
+        auto [it, inserted] = m_version_index.try_emplace(name_id);
+        auto& index = it->second;
+        if (!inserted)
+        {
+            return index;
+        }
+
+        pool.for_each_whatprovides(
+            name_id,
+            [&](solv::ObjSolvableViewConst s)
+            {
+                const auto pos = index.candidates.size();
+                index.candidates.push_back(s.id());
+                // Packages with invalid versions never match so they are left out of the index
+                if (auto ver = make_cached_version(m_version_cache, std::string(s.version())))
+                {
+                    index.sorted.emplace_back(ver.value(), pos);
+                }
+            }
+        );
+        std::stable_sort(
+            index.sorted.begin(),
+            index.sorted.end(),
+            [](const auto& a, const auto& b) { return a.first.get() < b.first.get(); }
+        );
+        return index;
+    }
+
     auto Matcher::get_pkg_attributes(solv::ObjPoolView pool, solv::ObjSolvableViewConst solv)
         -> expected_t<Pkg>
     {
@@ -11,6 +11,8 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "mamba/core/error_handling.hpp"
 #include "mamba/specs/channel.hpp"
@@ -57,6 +59,13 @@ namespace mamba::solver::libsolv
             const MatchFlags& flags = {}
         ) -> solv::OffsetId;
 
+        /**
+         * Forget the packages indexed by name.
+         *
+         * Must be called whenever packages are added to or removed from the pool.
+         */
+        void clear_version_index();
+
     private:
 
         using channel_list = specs::ChannelResolveParams::channel_list;
@@ -75,6 +84,25 @@ namespace mamba::solver::libsolv
             specs::MatchSpec::string_set track_features;
         };
 
+        /**
+         * The packages providing a name, sorted by version.
+         *
+         * The index is built on first use and kept until @ref clear_version_index is called.
+         */
+        struct VersionIndex
+        {
+            using version_ref = std::reference_wrapper<const specs::Version>;
+            using sorted_entry = std::pair<version_ref, std::size_t>;
+
+            /** The candidates in the pool order. */
+            std::vector<solv::SolvableId> candidates;
+            /** The parsed versions and candidate positions, sorted by version. */
+            std::vector<sorted_entry> sorted;
+        };
+
+        auto get_version_index(solv::ObjPoolView pool, solv::StringId name_id)
+            -> const VersionIndex&;
+
         auto get_pkg_attributes(  //
             solv::ObjPoolView pool,
             solv::ObjSolvableViewConst solv
@@ -105,6 +133,8 @@ namespace mamba::solver::libsolv
         // by libsolv.
         std::unordered_map<std::string, specs::Version> m_version_cache = {};
         std::unordered_map<std::string, channel_list> m_channel_cache = {};
+        std::unordered_map<solv::StringId, VersionIndex> m_version_index = {};
+        std::vector<std::size_t> m_positions_buffer = {};
     };
 }
 #endif
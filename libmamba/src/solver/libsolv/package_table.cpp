@@ -0,0 +1,145 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#include <cassert>
+
+#include "mamba/solver/libsolv/package_table.hpp"
+#include "mamba/solver/libsolv/package_view.hpp"
+
+namespace mamba::solver::libsolv
+{
+    /*********************************
+     *  StringColumn Implementation  *
+     *********************************/
+
+    auto StringColumn::size() const -> std::size_t
+    {
+        return m_offsets.size() - 1;
+    }
+
+    auto StringColumn::operator[](std::size_t pos) const -> std::string_view
+    {
+        assert(pos < size());
+        const auto start = static_cast<std::size_t>(m_offsets[pos]);
+        const auto end = static_cast<std::size_t>(m_offsets[pos + 1]);
+        return std::string_view(m_data).substr(start, end - start);
+    }
+
+    auto StringColumn::data() const -> const std::string&
+    {
+        return m_data;
+    }
+
+    auto StringColumn::offsets() const -> const std::vector<offset_type>&
+    {
+        return m_offsets;
+    }
+
+    void StringColumn::reserve(std::size_t size)
+    {
+        m_offsets.reserve(size + 1);
+    }
+
+    void StringColumn::push_back(std::string_view str)
+    {
+        m_data += str;
+        m_offsets.push_back(static_cast<offset_type>(m_data.size()));
+    }
+
+    /*************************************
+     *  StringListColumn Implementation  *
+     *************************************/
+
+    auto StringListColumn::size() const -> std::size_t
+    {
+        return m_offsets.size() - 1;
+    }
+
+    auto StringListColumn::operator[](std::size_t pos) const -> std::vector<std::string_view>
+    {
+        assert(pos < size());
+        const auto start = static_cast<std::size_t>(m_offsets[pos]);
+        const auto end = static_cast<std::size_t>(m_offsets[pos + 1]);
+        auto out = std::vector<std::string_view>();
+        out.reserve(end - start);
+        for (auto i = start; i < end; ++i)
+        {
+            out.push_back(m_values[i]);
+        }
+        return out;
+    }
+
+    auto StringListColumn::values() const -> const StringColumn&
+    {
+        return m_values;
+    }
+
+    auto StringListColumn::offsets() const -> const std::vector<offset_type>&
+    {
+        return m_offsets;
+    }
+
+    void StringListColumn::reserve(std::size_t size)
+    {
+        m_offsets.reserve(size + 1);
+    }
+
+    void StringListColumn::push_back(const std::vector<std::string>& strings)
+    {
+        for (const auto& str : strings)
+        {
+            m_values.push_back(str);
+        }
+        m_offsets.push_back(static_cast<offset_type>(m_values.size()));
+    }
+
+    /*********************************
+     *  PackageTable Implementation  *
+     *********************************/
+
+    auto PackageTable::package_count() const -> std::size_t
+    {
+        return name.size();
+    }
+
+    void PackageTable::reserve(std::size_t count)
+    {
+        name.reserve(count);
+        version.reserve(count);
+        build_string.reserve(count);
+        build_number.reserve(count);
+        channel.reserve(count);
+        package_url.reserve(count);
+        platform.reserve(count);
+        filename.reserve(count);
+        license.reserve(count);
+        md5.reserve(count);
+        sha256.reserve(count);
+        size.reserve(count);
+        timestamp.reserve(count);
+        dependencies.reserve(count);
+        constrains.reserve(count);
+    }
+
+    void PackageTable::push_back(const PackageView& pkg)
+    {
+        name.push_back(pkg.name());
+        version.push_back(pkg.version());
+        build_string.push_back(pkg.build_string());
+        build_number.push_back(pkg.build_number());
+        channel.push_back(pkg.channel());
+        package_url.push_back(pkg.package_url());
+        platform.push_back(pkg.platform());
+        filename.push_back(pkg.filename());
+        license.push_back(pkg.license());
+        md5.push_back(pkg.md5());
+        sha256.push_back(pkg.sha256());
+        size.push_back(pkg.size());
+        timestamp.push_back(pkg.timestamp());
+        dependencies.push_back(pkg.dependencies());
+        constrains.push_back(pkg.constrains());
+    }
+}
@@ -0,0 +1,152 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <type_traits>
+
+#include "mamba/solver/libsolv/package_view.hpp"
+#include "solv-cpp/pool.hpp"
+#include "solv-cpp/solvable.hpp"
+
+#include "solver/libsolv/helpers.hpp"
+
+namespace mamba::solver::libsolv
+{
+    namespace
+    {
+        auto get_solvable(const solv::ObjPool& pool, PackageView::PackageId id)
+            -> solv::ObjSolvableViewConst
+        {
+            static_assert(std::is_same_v<PackageView::PackageId, solv::SolvableId>);
+            const auto solv = pool.get_solvable(id);
+            assert(solv.has_value());  // Safe because the ID is coming from libsolv
+            return solv.value();
+        }
+
+        auto dependencies_to_strings(const solv::ObjPool& pool, const solv::ObjQueue& deps)
+            -> std::vector<std::string>
+        {
+            auto out = std::vector<std::string>();
+            out.reserve(deps.size());
+            std::transform(
+                deps.cbegin(),
+                deps.cend(),
+                std::back_inserter(out),
+                [&pool](solv::DependencyId id) { return pool.dependency_to_string(id); }
+            );
+            return out;
+        }
+    }
+
+    PackageView::PackageView(const solv::ObjPool& pool, PackageId id)
+        : m_pool(&pool)
+        , m_id(id)
+    {
+    }
+
+    auto PackageView::id() const -> PackageId
+    {
+        return m_id;
+    }
+
+    auto PackageView::name() const -> std::string_view
+    {
+        return get_solvable(*m_pool, m_id).name();
+    }
+
+    auto PackageView::version() const -> std::string_view
+    {
+        return get_solvable(*m_pool, m_id).version();
+    }
+
+    auto PackageView::build_string() const -> std::string_view
+    {
+        return get_solvable(*m_pool, m_id).build_string();
+    }
+
+    auto PackageView::build_number() const -> std::size_t
+    {
+        return get_solvable(*m_pool, m_id).build_number();
+    }
+
+    auto PackageView::noarch() const -> specs::NoArchType
+    {
+        return specs::noarch_parse(get_solvable(*m_pool, m_id).noarch())
+            .value_or(specs::NoArchType::No);
+    }
+
+    auto PackageView::channel() const -> std::string_view
+    {
+        return get_solvable(*m_pool, m_id).channel();
+    }
+
+    auto PackageView::package_url() const -> std::string_view
+    {
+        return get_solvable(*m_pool, m_id).url();
+    }
+
+    auto PackageView::platform() const -> std::string_view
+    {
+        return get_solvable(*m_pool, m_id).platform();
+    }
+
+    auto PackageView::filename() const -> std::string_view
+    {
+        return get_solvable(*m_pool, m_id).file_name();
+    }
+
+    auto PackageView::license() const -> std::string_view
+    {
+        return get_solvable(*m_pool, m_id).license();
+    }
+
+    auto PackageView::md5() const -> std::string_view
+    {
+        return get_solvable(*m_pool, m_id).md5();
+    }
+
+    auto PackageView::sha256() const -> std::string_view
+    {
+        return get_solvable(*m_pool, m_id).sha256();
+    }
+
+    auto PackageView::size() const -> std::size_t
+    {
+        return get_solvable(*m_pool, m_id).size();
+    }
+
+    auto PackageView::timestamp() const -> std::size_t
+    {
+        return get_solvable(*m_pool, m_id).timestamp();
+    }
+
+    auto PackageView::dependencies() const -> std::vector<std::string>
+    {
+        return dependencies_to_strings(*m_pool, get_solvable(*m_pool, m_id).dependencies());
+    }
+
+    auto PackageView::constrains() const -> std::vector<std::string>
+    {
+        return dependencies_to_strings(*m_pool, get_solvable(*m_pool, m_id).constraints());
+    }
+
+    auto PackageView::to_package_info() const -> specs::PackageInfo
+    {
+        return make_package_info(*m_pool, get_solvable(*m_pool, m_id));
+    }
+
+    auto operator==(PackageView lhs, PackageView rhs) -> bool
+    {
+        return (lhs.m_pool == rhs.m_pool) && (lhs.m_id == rhs.m_id);
+    }
+
+    auto operator!=(PackageView lhs, PackageView rhs) -> bool
+    {
+        return !(lhs == rhs);
+    }
+}
@@ -368,32 +368,167 @@ namespace mamba::solver
         }
 
         /**
-         * The criteria for deciding whether to merge two nodes together.
+         * The data used by the default merge criteria, computed once per node.
          */
-        auto default_merge_criteria(
-            const ProblemsGraph& pbs,
-            ProblemsGraph::node_id n1,
-            ProblemsGraph::node_id n2
+        struct MergeSignature
+        {
+            std::string_view name;
+            bool is_leaf = false;
+            // Predecessors for leaves, and leaves reachable for other nodes.
+            std::vector<ProblemsGraph::node_id> neighbors;
+
+            auto key() const
+            {
+                return std::tie(name, is_leaf, neighbors);
+            }
+        };
+
+        auto compute_merge_signature(const ProblemsGraph::graph_t& g, ProblemsGraph::node_id n)
+            -> MergeSignature
+        {
+            using node_id = ProblemsGraph::node_id;
+            auto out = MergeSignature{ node_name(g.node(n)), g.successors(n).size() == 0, {} };
+            if (out.is_leaf)
+            {
+                const auto& preds = g.predecessors(n);
+                out.neighbors.assign(preds.begin(), preds.end());
+            }
+            else
+            {
+                g.for_each_leaf_id_from(n, [&out](node_id m) { out.neighbors.push_back(m); });
+                auto leaves = util::flat_set<node_id>(std::move(out.neighbors));
+                out.neighbors.assign(leaves.begin(), leaves.end());
+            }
+            return out;
+        }
+
+        /**
+         * Whether a leaf and a non leaf node would be merged by the default criteria.
+         *
+         * This requires the non leaf to only reach the leaf while having the same predecessors,
+         * which can only happen with cycles in the graph.
+         */
+        auto has_mixed_leaf_merge(
+            const ProblemsGraph::graph_t& g,
+            const std::vector<ProblemsGraph::node_id>& node_indices,
+            const std::map<ProblemsGraph::node_id, MergeSignature>& signatures
         ) -> bool
+        {
+            return std::any_of(
+                node_indices.cbegin(),
+                node_indices.cend(),
+                [&](ProblemsGraph::node_id n)
+                {
+                    const auto& sig = signatures.at(n);
+                    if (sig.is_leaf || (sig.neighbors.size() != 1))
+                    {
+                        return false;
+                    }
+                    const auto leaf = sig.neighbors.front();
+                    const auto leaf_sig = signatures.find(leaf);
+                    return (leaf_sig != signatures.cend()) && (leaf_sig->second.name == sig.name)
+                           && (g.predecessors(leaf) == g.predecessors(n));
+                }
+            );
+        }
+
+        /**
+         * Merge node indices for a given type of node using the default merge criteria.
+         *
+         * Rather than comparing all pairs of nodes, nodes are first partitioned by their name
+         * and neighbors signature, outside of which the criteria never holds.
+         * Within a partition, nodes are grouped the same way as in
+         * @ref merge_node_indices_for_one_node_type, so that the output is identical.
+         */
+        auto merge_node_indices_for_one_node_type_default(
+            const ProblemsGraph& pbs,
+            const std::vector<ProblemsGraph::node_id>& node_indices
+        ) -> std::vector<old_node_id_list>
         {
             using node_id = ProblemsGraph::node_id;
             const auto& g = pbs.graph();
-            auto is_leaf = [&g](node_id n) -> bool { return g.successors(n).size() == 0; };
-            auto leaves_from = [&g](node_id n) -> util::flat_set<node_id>
+
+            auto signatures = std::map<node_id, MergeSignature>();
+            for (const auto id : node_indices)
+            {
+                signatures.emplace(id, compute_merge_signature(g, id));
+            }
+
+            // The criteria for deciding whether to merge two nodes together.
+            auto criteria = [&](node_id n1, node_id n2) -> bool
             {
-                auto leaves = std::vector<node_id>();
-                g.for_each_leaf_id_from(n, [&leaves](node_id m) { leaves.push_back(m); });
-                return util::flat_set(std::move(leaves));
+                const auto& s1 = signatures.at(n1);
+                const auto& s2 = signatures.at(n2);
+                // Merging conflicts would be counter-productive in explaining problems
+                if ((s1.name != s2.name) || pbs.conflicts().in_conflict(n1, n2))
+                {
+                    return false;
+                }
+                // We don't compare leaves_from for leaves because it resolve to themselves,
+                // preventing any merging, and we only compare the parents for leaves, meaning
+                // parents can "inject" themselves into a bigger problem.
+                if (s1.is_leaf == s2.is_leaf)
+                {
+                    return s1.neighbors == s2.neighbors;
+                }
+                const auto& leaf = s1.is_leaf ? n1 : n2;
+                const auto& other = s1.is_leaf ? s2 : s1;
+                return (other.neighbors == std::vector<node_id>{ leaf })
+                       && (g.predecessors(n1) == g.predecessors(n2));
             };
-            return (node_name(g.node(n1)) == node_name(g.node(n2)))
-                   // Merging conflicts would be counter-productive in explaining problems
-                   && !(pbs.conflicts().in_conflict(n1, n2))
-                   // We don't want to use leaves_from for leaves because it resolve to themselves,
-                   // preventing any merging.
-                   && ((is_leaf(n1) && is_leaf(n2)) || (leaves_from(n1) == leaves_from(n2)))
-                   // We only check the parents for leaves meaning parents can "inject"
-                   // themselves into a bigger problem
-                   && ((!is_leaf(n1) && !is_leaf(n2)) || (g.predecessors(n1) == g.predecessors(n2)));
+            if (has_mixed_leaf_merge(g, node_indices, signatures))
+            {
+                return merge_node_indices_for_one_node_type(node_indices, criteria);
+            }
+
+            // Partition nodes by signature, keeping the order of node_indices within partitions
+            auto sorted = node_indices;
+            std::stable_sort(
+                sorted.begin(),
+                sorted.end(),
+                [&](node_id a, node_id b)
+                { return signatures.at(a).key() < signatures.at(b).key(); }
+            );
+            auto partitions = std::vector<old_node_id_list>();
+            for (std::size_t i = 0; i < sorted.size(); ++i)
+            {
+                const bool same_as_previous = (i > 0)
+                                              && (signatures.at(sorted[i - 1]).key()
+                                                  == signatures.at(sorted[i]).key());
+                if (!same_as_previous)
+                {
+                    partitions.emplace_back();
+                }
+                partitions.back().push_back(sorted[i]);
+            }
+
+            std::vector<old_node_id_list> groups{};
+            for (const auto& members : partitions)
+            {
+                auto grouped = merge_node_indices_for_one_node_type(
+                    members,
+                    [&pbs](node_id n1, node_id n2) { return !pbs.conflicts().in_conflict(n1, n2); }
+                );
+                groups.insert(
+                    groups.end(),
+                    std::make_move_iterator(grouped.begin()),
+                    std::make_move_iterator(grouped.end())
+                );
+            }
+
+            // Order groups by their first node, as when comparing all pairs of nodes
+            auto seed_position = std::map<node_id, std::size_t>();
+            for (std::size_t i = 0; i < node_indices.size(); ++i)
+            {
+                seed_position[node_indices[i]] = i;
+            }
+            std::sort(
+                groups.begin(),
+                groups.end(),
+                [&](const auto& a, const auto& b)
+                { return seed_position.at(a.front()) < seed_position.at(b.front()); }
+            );
+            return groups;
         }
 
         using node_id_mapping = std::map<ProblemsGraph::node_id, CompressedProblemsGraph::node_id>;
@@ -436,15 +571,15 @@ namespace mamba::solver
         /**
          * Merge nodes together.
          *
-         * Merge by applying the @p merge_criteria to nodes that hold the same type in the variant.
-         *
-         * @param merge_criteria A binary function that decides whether two nodes should be merged
-         * together. The function is assumed to be symmetric and transitive.
+         * @param old_ids_groups For each node type, a partition of the node indices to merge
+         * together, as computed by @ref merge_node_indices.
          * @return A tuple of the graph with newly created nodes (without edges), the new root node,
          * and a mapping between old node ids and new node ids.
          */
-        template <typename CompFunc>
-        auto merge_nodes(const ProblemsGraph& pbs, CompFunc&& merge_criteria)
+        auto merge_nodes(
+            const ProblemsGraph& pbs,
+            const node_type_list<std::vector<old_node_id_list>>& old_ids_groups
+        )
             -> std::tuple<CompressedProblemsGraph::graph_t, CompressedProblemsGraph::node_id, node_id_mapping>
         {
             const auto& old_graph = pbs.graph();
@@ -453,11 +588,6 @@ namespace mamba::solver
 
             auto old_to_new = node_id_mapping{};
 
-            auto old_ids_groups = merge_node_indices(
-                node_id_by_type(pbs.graph()),
-                std::forward<CompFunc>(merge_criteria)
-            );
-
             {
                 using Node = ProblemsGraph::RootNode;
                 [[maybe_unused]] static constexpr auto type_idx = variant_type_index<ProblemsGraph::node_t, Node>(
@@ -559,19 +689,26 @@ namespace mamba::solver
         graph_t graph = {};
         node_id root_node = {};
         node_id_mapping old_to_new = {};
+        const auto nodes_by_type = node_id_by_type(pbs.graph());
+        auto old_ids_groups = node_type_list<std::vector<old_node_id_list>>();
         if (merge_criteria)
         {
             auto merge_func =
                 [&pbs, &merge_criteria](ProblemsGraph::node_id n1, ProblemsGraph::node_id n2)
             { return merge_criteria(pbs, n1, n2); };
-            std::tie(graph, root_node, old_to_new) = merge_nodes(pbs, merge_func);
+            old_ids_groups = merge_node_indices(nodes_by_type, merge_func);
         }
         else
         {
-            auto merge_func = [&pbs](ProblemsGraph::node_id n1, ProblemsGraph::node_id n2)
-            { return default_merge_criteria(pbs, n1, n2); };
-            std::tie(graph, root_node, old_to_new) = merge_nodes(pbs, merge_func);
+            old_ids_groups.reserve(nodes_by_type.size());
+            for (const auto& node_indices : nodes_by_type)
+            {
+                old_ids_groups.push_back(
+                    merge_node_indices_for_one_node_type_default(pbs, node_indices)
+                );
+            }
         }
+        std::tie(graph, root_node, old_to_new) = merge_nodes(pbs, old_ids_groups);
         merge_edges(pbs.graph(), graph, old_to_new);
         auto conflicts = merge_conflicts(pbs.conflicts(), old_to_new);
         return { std::move(graph), std::move(conflicts), root_node };
@@ -4,9 +4,13 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <unordered_map>
 
 #include <fmt/format.h>
 #include <fmt/ranges.h>
@@ -498,6 +502,25 @@ namespace mamba::specs
             auto [version_str, build_string_str] = split_version_and_build(version_and_build);
             return std::tuple(pkg_name, version_str, build_string_str);
         }
+
+        inline constexpr auto simple_spec_tokens = std::array{
+            '.', '_', '-', '+', '*', '!', '=', '<', '>', '~', ',', '|', ' ',
+        };
+
+        /**
+         * Whether the spec only has a name, version and build string, as in ``pkg >=3,<4 bld*``.
+         *
+         * Such specs have no channel, namespace, nor attribute sections and can be split
+         * directly.
+         */
+        auto is_simple_spec(std::string_view str) -> bool
+        {
+            return std::all_of(
+                str.cbegin(),
+                str.cend(),
+                [](char c) { return util::is_alphanum(c) || contains(simple_spec_tokens, c); }
+            );
+        }
     }
 
     auto MatchSpec::parse(std::string_view str) -> expected_parse_t<MatchSpec>
@@ -551,6 +574,9 @@ namespace mamba::specs
         //   - ``https://channel[plat]``
         //   - ``namespace``
         //   - ``spec >=3 [attr="val", ...]``
+        // The common ``pkg >=3,<4 bld*`` forms have no such sections and skip this step.
+        const bool simple = is_simple_spec(str);
+        if (!simple)
         {
             auto maybe_chan_ns_spec = split_channel_namespace_spec(str);
             if (!maybe_chan_ns_spec)
@@ -580,6 +606,11 @@ namespace mamba::specs
         auto name_str = std::string_view();
         auto ver_str = std::string_view();
         auto bld_str = std::string_view();
+        if (simple)
+        {
+            std::tie(name_str, ver_str, bld_str) = split_name_version_and_build(str);
+        }
+        else
         {
             auto maybe_pkg_ver_bld = rparse_and_set_matchspec_attributes(out, str);
             if (!maybe_pkg_ver_bld)
@@ -624,6 +655,74 @@ namespace mamba::specs
         return out;
     }
 
+    namespace
+    {
+        /**
+         * Thread-safe map of spec strings to their parsed MatchSpec.
+         *
+         * The cache is simply cleared when it is full, since the recurring specs quickly make
+         * their way back into it.
+         */
+        class MatchSpecCache
+        {
+        public:
+
+            static constexpr std::size_t max_size = std::size_t(1) << 16;
+
+            auto find(std::string_view str) const -> std::shared_ptr<const MatchSpec>
+            {
+                auto lock = std::shared_lock(m_mutex);
+                if (const auto it = m_specs.find(str); it != m_specs.cend())
+                {
+                    return { it->second, &it->second->spec };
+                }
+                return nullptr;
+            }
+
+            auto insert(std::string_view str, MatchSpec&& spec) -> std::shared_ptr<const MatchSpec>
+            {
+                // The key views the string owned by the entry, which is stable in memory
+                auto entry = std::make_shared<Entry>(Entry{ std::string(str), std::move(spec) });
+                auto lock = std::unique_lock(m_mutex);
+                if (m_specs.size() >= max_size)
+                {
+                    m_specs.clear();
+                }
+                const auto [it, inserted] = m_specs.emplace(entry->str, std::move(entry));
+                return { it->second, &it->second->spec };
+            }
+
+        private:
+
+            struct Entry
+            {
+                std::string str;
+                MatchSpec spec;
+            };
+
+            mutable std::shared_mutex m_mutex = {};
+            std::unordered_map<std::string_view, std::shared_ptr<const Entry>> m_specs = {};
+        };
+
+        auto match_spec_cache() -> MatchSpecCache&
+        {
+            static auto cache = MatchSpecCache();
+            return cache;
+        }
+    }
+
+    auto MatchSpec::parse_cached(std::string_view str)
+        -> expected_parse_t<std::shared_ptr<const MatchSpec>>
+    {
+        auto& cache = match_spec_cache();
+        if (auto ms = cache.find(str))
+        {
+            return { std::move(ms) };
+        }
+        return MatchSpec::parse(str).transform([&](MatchSpec&& ms)
+                                               { return cache.insert(str, std::move(ms)); });
+    }
+
     auto MatchSpec::channel_is_file() const -> bool
     {
         if (const auto& chan = channel(); chan.has_value())
@@ -0,0 +1,667 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#include <cassert>
+#include <limits>
+#include <utility>
+
+#include "specs/regex_program.hpp"
+
+namespace mamba::specs
+{
+    namespace
+    {
+        using byte_set = RegexProgram::byte_set;
+
+        /** The syntax tree of a pattern, as the program cannot be emitted in a single pass. */
+        struct RegexNode
+        {
+            enum class Kind
+            {
+                empty,
+                bytes,
+                concat,
+                alternate,
+                star,
+                plus,
+                optional,
+                assert_begin,
+                assert_end,
+            };
+
+            Kind kind = Kind::empty;
+            byte_set bytes = {};
+            std::vector<RegexNode> children = {};
+        };
+
+        auto make_byte_set(char c) -> byte_set
+        {
+            auto out = byte_set();
+            out.set(static_cast<unsigned char>(c));
+            return out;
+        }
+
+        auto make_byte_range(unsigned char first, unsigned char last) -> byte_set
+        {
+            auto out = byte_set();
+            for (unsigned int c = first; c <= last; ++c)
+            {
+                out.set(c);
+            }
+            return out;
+        }
+
+        /** The bytes matched by ``.``, which excludes line terminators in ECMAScript. */
+        auto any_set() -> byte_set
+        {
+            auto out = byte_set().set();
+            out.reset('\n');
+            out.reset('\r');
+            return out;
+        }
+
+        auto digit_set() -> byte_set
+        {
+            return make_byte_range('0', '9');
+        }
+
+        auto word_set() -> byte_set
+        {
+            return make_byte_range('a', 'z') | make_byte_range('A', 'Z') | digit_set()
+                   | make_byte_set('_');
+        }
+
+        auto space_set() -> byte_set
+        {
+            return make_byte_range('\t', '\r') | make_byte_set(' ');
+        }
+
+        auto is_syntax_char(char c) -> bool
+        {
+            static constexpr auto syntax = std::string_view(R"(^$\.*+?()[]{}|/-)");
+            return syntax.find(c) != std::string_view::npos;
+        }
+
+        /**
+         * Recursive descent parser of the supported subset of ECMAScript patterns.
+         *
+         * Every function returns an empty optional when meeting an unsupported construct.
+         */
+        class RegexParser
+        {
+        public:
+
+            explicit RegexParser(std::string_view pattern)
+                : m_pattern(pattern)
+            {
+            }
+
+            auto parse() -> std::optional<RegexNode>
+            {
+                auto out = parse_alternate();
+                if (!out.has_value() || !at_end())
+                {
+                    return std::nullopt;
+                }
+                return out;
+            }
+
+        private:
+
+            std::string_view m_pattern;
+            std::size_t m_pos = 0;
+
+            [[nodiscard]] auto at_end() const -> bool
+            {
+                return m_pos >= m_pattern.size();
+            }
+
+            [[nodiscard]] auto peek() const -> char
+            {
+                return m_pattern[m_pos];
+            }
+
+            auto parse_alternate() -> std::optional<RegexNode>
+            {
+                auto out = RegexNode{ RegexNode::Kind::alternate };
+                while (true)
+                {
+                    auto branch = parse_concat();
+                    if (!branch.has_value())
+                    {
+                        return std::nullopt;
+                    }
+                    out.children.push_back(std::move(branch).value());
+                    if (at_end() || (peek() != '|'))
+                    {
+                        break;
+                    }
+                    ++m_pos;
+                }
+                if (out.children.size() == 1)
+                {
+                    return { std::move(out.children.front()) };
+                }
+                return out;
+            }
+
+            auto parse_concat() -> std::optional<RegexNode>
+            {
+                auto out = RegexNode{ RegexNode::Kind::concat };
+                while (!at_end() && (peek() != '|') && (peek() != ')'))
+                {
+                    auto node = parse_repeat();
+                    if (!node.has_value())
+                    {
+                        return std::nullopt;
+                    }
+                    out.children.push_back(std::move(node).value());
+                }
+                return out;
+            }
+
+            auto parse_repeat() -> std::optional<RegexNode>
+            {
+                auto atom = parse_atom();
+                if (!atom.has_value())
+                {
+                    return std::nullopt;
+                }
+                while (!at_end())
+                {
+                    auto kind = RegexNode::Kind::empty;
+                    switch (peek())
+                    {
+                        case '*':
+                            kind = RegexNode::Kind::star;
+                            break;
+                        case '+':
+                            kind = RegexNode::Kind::plus;
+                            break;
+                        case '?':
+                            kind = RegexNode::Kind::optional;
+                            break;
+                        case '{':
+                            return std::nullopt;
+                        default:
+                            return atom;
+                    }
+                    const bool is_assertion = (atom->kind == RegexNode::Kind::assert_begin)
+                                              || (atom->kind == RegexNode::Kind::assert_end);
+                    if (is_assertion)
+                    {
+                        return std::nullopt;
+                    }
+                    ++m_pos;
+                    // Lazy quantifiers only change which match is found, not whether one is
+                    if (!at_end() && (peek() == '?'))
+                    {
+                        ++m_pos;
+                    }
+                    auto repeated = RegexNode{ kind };
+                    repeated.children.push_back(std::move(atom).value());
+                    atom = std::move(repeated);
+                }
+                return atom;
+            }
+
+            auto parse_atom() -> std::optional<RegexNode>
+            {
+                const char c = peek();
+                if (static_cast<unsigned char>(c) >= 0x80)
+                {
+                    return std::nullopt;
+                }
+                switch (c)
+                {
+                    case '^':
+                        ++m_pos;
+                        return { RegexNode{ RegexNode::Kind::assert_begin } };
+                    case '$':
+                        ++m_pos;
+                        return { RegexNode{ RegexNode::Kind::assert_end } };
+                    case '.':
+                        ++m_pos;
+                        return { RegexNode{ RegexNode::Kind::bytes, any_set() } };
+                    case '[':
+                        return parse_bracket();
+                    case '(':
+                        return parse_group();
+                    case '\\':
+                    {
+                        auto bytes = parse_escape();
+                        if (!bytes.has_value())
+                        {
+                            return std::nullopt;
+                        }
+                        return { RegexNode{ RegexNode::Kind::bytes, bytes.value() } };
+                    }
+                    case '*':
+                    case '+':
+                    case '?':
+                    case '{':
+                    case '}':
+                    case ']':
+                        return std::nullopt;
+                    default:
+                        ++m_pos;
+                        return { RegexNode{ RegexNode::Kind::bytes, make_byte_set(c) } };
+                }
+            }
+
+            auto parse_group() -> std::optional<RegexNode>
+            {
+                assert(peek() == '(');
+                ++m_pos;
+                if (!at_end() && (peek() == '?'))
+                {
+                    // Only non capturing groups, captures do not matter for a full match
+                    if ((m_pos + 1 >= m_pattern.size()) || (m_pattern[m_pos + 1] != ':'))
+                    {
+                        return std::nullopt;
+                    }
+                    m_pos += 2;
+                }
+                auto out = parse_alternate();
+                if (!out.has_value() || at_end() || (peek() != ')'))
+                {
+                    return std::nullopt;
+                }
+                ++m_pos;
+                return out;
+            }
+
+            auto parse_bracket() -> std::optional<RegexNode>
+            {
+                assert(peek() == '[');
+                ++m_pos;
+                bool negated = false;
+                if (!at_end() && (peek() == '^'))
+                {
+                    negated = true;
+                    ++m_pos;
+                }
+                // Leading closing brackets and empty brackets have implementation specific
+                // meanings.
+                if (at_end() || (peek() == ']'))
+                {
+                    return std::nullopt;
+                }
+
+                auto bytes = byte_set();
+                while (!at_end() && (peek() != ']'))
+                {
+                    auto first = parse_bracket_elem();
+                    if (!first.has_value())
+                    {
+                        return std::nullopt;
+                    }
+                    const bool is_range = (m_pos + 1 < m_pattern.size()) && (peek() == '-')
+                                          && (m_pattern[m_pos + 1] != ']');
+                    if (!is_range)
+                    {
+                        bytes |= first.value();
+                        continue;
+                    }
+                    ++m_pos;
+                    auto last = parse_bracket_elem();
+                    if (!last.has_value() || (first->count() != 1) || (last->count() != 1))
+                    {
+                        return std::nullopt;
+                    }
+                    const auto lo = find_single(first.value());
+                    const auto hi = find_single(last.value());
+                    if (lo > hi)
+                    {
+                        return std::nullopt;
+                    }
+                    bytes |= make_byte_range(lo, hi);
+                }
+                if (at_end())
+                {
+                    return std::nullopt;
+                }
+                ++m_pos;
+                if (negated)
+                {
+                    bytes.flip();
+                }
+                return { RegexNode{ RegexNode::Kind::bytes, bytes } };
+            }
+
+            auto parse_bracket_elem() -> std::optional<byte_set>
+            {
+                const char c = peek();
+                if (static_cast<unsigned char>(c) >= 0x80)
+                {
+                    return std::nullopt;
+                }
+                if (c == '\\')
+                {
+                    return parse_escape();
+                }
+                // Collating elements and character classes such as ``[:alpha:]``
+                if ((c == '[') && (m_pos + 1 < m_pattern.size()))
+                {
+                    const char next = m_pattern[m_pos + 1];
+                    if ((next == ':') || (next == '.') || (next == '='))
+                    {
+                        return std::nullopt;
+                    }
+                }
+                ++m_pos;
+                return make_byte_set(c);
+            }
+
+            auto parse_escape() -> std::optional<byte_set>
+            {
+                assert(peek() == '\\');
+                ++m_pos;
+                if (at_end())
+                {
+                    return std::nullopt;
+                }
+                const char c = peek();
+                ++m_pos;
+                switch (c)
+                {
+                    case 'd':
+                        return digit_set();
+                    case 'D':
+                        return ~digit_set();
+                    case 'w':
+                        return word_set();
+                    case 'W':
+                        return ~word_set();
+                    case 's':
+                        return space_set();
+                    case 'S':
+                        return ~space_set();
+                    case 'n':
+                        return make_byte_set('\n');
+                    case 't':
+                        return make_byte_set('\t');
+                    case 'r':
+                        return make_byte_set('\r');
+                    case 'f':
+                        return make_byte_set('\f');
+                    case 'v':
+                        return make_byte_set('\v');
+                    default:
+                        // Identity escapes of syntax characters, others (back references,
+                        // word boundaries, hexadecimal codes...) are not supported.
+                        if (is_syntax_char(c))
+                        {
+                            return make_byte_set(c);
+                        }
+                        return std::nullopt;
+                }
+            }
+
+            static auto find_single(const byte_set& bytes) -> unsigned char
+            {
+                for (std::size_t c = 0; c < bytes.size(); ++c)
+                {
+                    if (bytes.test(c))
+                    {
+                        return static_cast<unsigned char>(c);
+                    }
+                }
+                assert(false);
+                return 0;
+            }
+        };
+    }
+
+    /**
+     * Emit the program instructions from the syntax tree.
+     *
+     * This is the classic Thompson construction where ``split`` instructions list their
+     * preferred branch first.
+     */
+    class RegexCompiler
+    {
+    public:
+
+        using Instruction = RegexProgram::Instruction;
+        using OpCode = RegexProgram::OpCode;
+
+        static auto compile(const RegexNode& root) -> RegexProgram
+        {
+            auto compiler = RegexCompiler();
+            compiler.emit(root);
+            compiler.push({ OpCode::match });
+            return std::move(compiler.m_program);
+        }
+
+    private:
+
+        RegexProgram m_program = {};
+
+        auto pc() const -> std::uint32_t
+        {
+            return static_cast<std::uint32_t>(m_program.m_instructions.size());
+        }
+
+        auto push(Instruction inst) -> std::uint32_t
+        {
+            const auto out = pc();
+            m_program.m_instructions.push_back(inst);
+            return out;
+        }
+
+        auto instruction(std::uint32_t pc) -> Instruction&
+        {
+            return m_program.m_instructions[pc];
+        }
+
+        void emit(const RegexNode& node)
+        {
+            using Kind = RegexNode::Kind;
+
+            switch (node.kind)
+            {
+                case Kind::empty:
+                    return;
+                case Kind::bytes:
+                {
+                    const auto set = static_cast<std::uint32_t>(m_program.m_sets.size());
+                    m_program.m_sets.push_back(node.bytes);
+                    push({ OpCode::consume, set });
+                    return;
+                }
+                case Kind::concat:
+                {
+                    for (const auto& child : node.children)
+                    {
+                        emit(child);
+                    }
+                    return;
+                }
+                case Kind::alternate:
+                {
+                    // split L1, L2; L1: e1; jump end; L2: split ...; Ln: en; end:
+                    auto jumps = std::vector<std::uint32_t>();
+                    for (std::size_t i = 0; i + 1 < node.children.size(); ++i)
+                    {
+                        const auto split = push({ OpCode::split });
+                        instruction(split).x = pc();
+                        emit(node.children[i]);
+                        jumps.push_back(push({ OpCode::jump }));
+                        instruction(split).y = pc();
+                    }
+                    emit(node.children.back());
+                    for (const auto j : jumps)
+                    {
+                        instruction(j).x = pc();
+                    }
+                    return;
+                }
+                case Kind::star:
+                {
+                    // L1: split L2, end; L2: e; jump L1; end:
+                    const auto split = push({ OpCode::split });
+                    instruction(split).x = pc();
+                    emit(node.children.front());
+                    push({ OpCode::jump, split });
+                    instruction(split).y = pc();
+                    return;
+                }
+                case Kind::plus:
+                {
+                    // L1: e; split L1, end; end:
+                    const auto start = pc();
+                    emit(node.children.front());
+                    const auto split = push({ OpCode::split, start });
+                    instruction(split).y = pc();
+                    return;
+                }
+                case Kind::optional:
+                {
+                    // split L1, end; L1: e; end:
+                    const auto split = push({ OpCode::split });
+                    instruction(split).x = pc();
+                    emit(node.children.front());
+                    instruction(split).y = pc();
+                    return;
+                }
+                case Kind::assert_begin:
+                    push({ OpCode::assert_begin });
+                    return;
+                case Kind::assert_end:
+                    push({ OpCode::assert_end });
+                    return;
+            }
+        }
+    };
+
+    namespace
+    {
+        /** The scratch space of ``RegexProgram::full_match``. */
+        struct MatchBuffers
+        {
+            std::vector<std::uint32_t> current;
+            std::vector<std::uint32_t> next;
+            std::vector<std::size_t> marks;
+            std::vector<std::uint32_t> stack;
+        };
+    }
+
+    /*********************************
+     *  RegexProgram Implementation  *
+     *********************************/
+
+    auto RegexProgram::compile(std::string_view pattern) -> std::optional<RegexProgram>
+    {
+        // Keep the state lists and the recursion of the compiler small
+        static constexpr std::size_t max_pattern_size = 1024;
+        if (pattern.size() > max_pattern_size)
+        {
+            return std::nullopt;
+        }
+        auto tree = RegexParser(pattern).parse();
+        if (!tree.has_value())
+        {
+            return std::nullopt;
+        }
+        return RegexCompiler::compile(tree.value());
+    }
+
+    auto RegexProgram::full_match(std::string_view str) const -> bool
+    {
+        const auto n_inst = m_instructions.size();
+
+        // Programs are shared between threads, so the buffers are reused per thread and only
+        // grow with the largest program matched.
+        thread_local auto buffers = MatchBuffers();
+        // Current and next list of threads, each waiting on a ``consume`` or ``match``.
+        // A thread is added at most once per position thanks to the generation marks.
+        auto& current = buffers.current;
+        auto& next = buffers.next;
+        auto& marks = buffers.marks;
+        auto& stack = buffers.stack;
+        current.clear();
+        next.clear();
+        stack.clear();
+        marks.assign(n_inst, std::numeric_limits<std::size_t>::max());
+        current.reserve(n_inst);
+        next.reserve(n_inst);
+
+        // Follow all epsilon transitions from ``start`` at the given position.
+        const auto add_thread =
+            [&](std::vector<std::uint32_t>& list, std::uint32_t start, std::size_t pos)
+        {
+            stack.push_back(start);
+            while (!stack.empty())
+            {
+                const auto pc = stack.back();
+                stack.pop_back();
+                if (marks[pc] == pos)
+                {
+                    continue;
+                }
+                marks[pc] = pos;
+
+                const auto& inst = m_instructions[pc];
+                switch (inst.op)
+                {
+                    case OpCode::consume:
+                    case OpCode::match:
+                        list.push_back(pc);
+                        break;
+                    case OpCode::jump:
+                        stack.push_back(inst.x);
+                        break;
+                    case OpCode::split:
+                        stack.push_back(inst.y);
+                        stack.push_back(inst.x);
+                        break;
+                    case OpCode::assert_begin:
+                        if (pos == 0)
+                        {
+                            stack.push_back(pc + 1);
+                        }
+                        break;
+                    case OpCode::assert_end:
+                        if (pos == str.size())
+                        {
+                            stack.push_back(pc + 1);
+                        }
+                        break;
+                }
+            }
+        };
+
+        add_thread(current, 0, 0);
+        for (std::size_t pos = 0; pos < str.size(); ++pos)
+        {
+            if (current.empty())
+            {
+                return false;
+            }
+            const auto byte = static_cast<unsigned char>(str[pos]);
+            for (const auto pc : current)
+            {
+                const auto& inst = m_instructions[pc];
+                if ((inst.op == OpCode::consume) && m_sets[inst.x].test(byte))
+                {
+                    add_thread(next, pc + 1, pos + 1);
+                }
+            }
+            std::swap(current, next);
+            next.clear();
+        }
+
+        for (const auto pc : current)
+        {
+            if (m_instructions[pc].op == OpCode::match)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#ifndef MAMBA_SPECS_REGEX_PROGRAM_HPP
+#define MAMBA_SPECS_REGEX_PROGRAM_HPP
+
+#include <bitset>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace mamba::specs
+{
+    /**
+     * A compiled regular expression matched in linear time.
+     *
+     * The pattern is compiled into a Thompson NFA whose states are all simulated at once, so
+     * that matching a string takes a time proportional to its length times the size of the
+     * pattern.
+     * The state lists are kept per thread, so that matching does not allocate once they have
+     * grown to the size of the program.
+     *
+     * Only the subset of ECMAScript regular expressions found in build strings is supported:
+     * literals, ``.``, bracket expressions, ``\d``, ``\w``, ``\s`` and their negations, groups,
+     * alternations, the ``*``, ``+``, and ``?`` quantifiers (greedy or lazy), and the ``^`` and
+     * ``$`` anchors.
+     * Other constructs, such as back references, lookaheads, or counted repetitions, are
+     * rejected upon compilation and must be matched with ``std::regex`` instead.
+     */
+    class RegexProgram
+    {
+    public:
+
+        using byte_set = std::bitset<256>;
+
+        /**
+         * Compile a pattern.
+         *
+         * The pattern is expected to be a valid ECMAScript regular expression.
+         * Return nothing if it uses an unsupported construct.
+         */
+        [[nodiscard]] static auto compile(std::string_view pattern) -> std::optional<RegexProgram>;
+
+        /** Whether the whole string matches, as with ``std::regex_match``. */
+        [[nodiscard]] auto full_match(std::string_view str) const -> bool;
+
+    private:
+
+        enum class OpCode : std::uint8_t
+        {
+            consume,
+            split,
+            jump,
+            assert_begin,
+            assert_end,
+            match,
+        };
+
+        struct Instruction
+        {
+            OpCode op;
+            // Index of the byte set for ``consume``, or jump targets for ``split`` and ``jump``.
+            std::uint32_t x = 0;
+            std::uint32_t y = 0;
+        };
+
+        std::vector<Instruction> m_instructions = {};
+        std::vector<byte_set> m_sets = {};
+
+        friend class RegexCompiler;
+    };
+}
+#endif
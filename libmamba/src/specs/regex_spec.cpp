@@ -12,6 +12,8 @@
 #include "mamba/specs/regex_spec.hpp"
 #include "mamba/util/string.hpp"
 
+#include "specs/regex_program.hpp"
+
 namespace mamba::specs
 {
     namespace
@@ -58,10 +60,18 @@ namespace mamba::specs
         {
             m_raw_pattern.push_back(pattern_end);
         }
+        if (auto program = RegexProgram::compile(m_raw_pattern))
+        {
+            m_program = std::make_shared<const RegexProgram>(std::move(program).value());
+        }
     }
 
     auto RegexSpec::contains(std::string_view str) const -> bool
     {
+        if (m_program != nullptr)
+        {
+            return m_program->full_match(str);
+        }
         return std::regex_match(str.cbegin(), str.cend(), m_pattern);
     }
 
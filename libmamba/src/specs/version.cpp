@@ -203,13 +203,217 @@ namespace mamba::specs
      *  Implementation of Version  *
      *******************************/
 
-    Version::Version(std::size_t epoch, CommonVersion version, CommonVersion local) noexcept
+    namespace
+    {
+        /*
+         * Byte comparable sort key.
+         *
+         * The key is built so that comparing two keys with ``memcmp`` gives the same
+         * result as comparing the versions.
+         * Every atom is encoded in a prefix free manner, with its leading byte giving
+         * its position relative to the empty atom ``{0, ""}``.
+         * Trailing empty atoms (resp. parts) are dropped since they compare equal to the
+         * implicit padding.
+         * Empty atoms (resp. parts) in the middle cannot be dropped, they are encoded with
+         * a marker sorting just before (resp. after) the end marker, depending on whether
+         * the next non empty element is smaller (resp. larger) than the padding.
+         */
+        namespace sort_key
+        {
+            // Leading bytes of atoms with a zero numeral
+            inline constexpr char star = '\x10';
+            inline constexpr char dev = '\x11';
+            inline constexpr char underscore = '\x12';
+            inline constexpr char regular = '\x13';
+            inline constexpr char empty = '\x14';
+            inline constexpr char post = '\x15';
+            // Markers, sorting between the atoms smaller and larger than the empty atom
+            inline constexpr char empty_before_less = '\x20';
+            inline constexpr char empty_part_before_less = '\x21';
+            inline constexpr char end = '\x22';
+            inline constexpr char empty_part_before_greater = '\x23';
+            inline constexpr char empty_before_greater = '\x24';
+            inline constexpr char zero_post = '\x30';
+            // Leading byte of numerals, plus the number of bytes of the numeral
+            inline constexpr char numeral = '\x40';
+
+            void append_numeral(std::string& key, std::size_t num)
+            {
+                std::size_t n_bytes = 0;
+                for (auto n = num; n > 0; n >>= 8)
+                {
+                    ++n_bytes;
+                }
+                key.push_back(static_cast<char>(numeral + static_cast<char>(n_bytes)));
+                for (std::size_t i = n_bytes; i > 0; --i)
+                {
+                    key.push_back(static_cast<char>((num >> (8 * (i - 1))) & 0xFF));
+                }
+            }
+
+            auto literal_code(const std::string& lit) -> char
+            {
+                if (lit == "*")
+                {
+                    return star;
+                }
+                if (lit == "dev")
+                {
+                    return dev;
+                }
+                if (lit == "_")
+                {
+                    return underscore;
+                }
+                if (lit.empty())
+                {
+                    return empty;
+                }
+                if (lit == "post")
+                {
+                    return post;
+                }
+                return regular;
+            }
+
+            void append_atom(std::string& key, const VersionPartAtom& atom)
+            {
+                const char code = literal_code(atom.literal());
+                if (atom.numeral() == 0)
+                {
+                    key.push_back(code == post ? zero_post : code);
+                }
+                else
+                {
+                    append_numeral(key, atom.numeral());
+                    key.push_back(code);
+                }
+                if (code == regular)
+                {
+                    // Literals never contain null characters
+                    key.append(atom.literal());
+                    key.push_back('\0');
+                }
+            }
+
+            auto is_empty(const VersionPartAtom& atom) -> bool
+            {
+                return (atom.numeral() == 0) && atom.literal().empty();
+            }
+
+            auto is_empty(const VersionPart& part) -> bool
+            {
+                return std::all_of(
+                    part.cbegin(),
+                    part.cend(),
+                    [](const auto& a) { return is_empty(a); }
+                );
+            }
+
+            auto less_than_empty(const VersionPartAtom& atom) -> bool
+            {
+                return compare_three_way(atom, VersionPartAtom{}) == strong_ordering::less;
+            }
+
+            auto less_than_empty(const VersionPart& part) -> bool
+            {
+                const auto it = std::find_if_not(
+                    part.cbegin(),
+                    part.cend(),
+                    [](const auto& a) { return is_empty(a); }
+                );
+                return (it != part.cend()) && less_than_empty(*it);
+            }
+
+            void append_part(std::string& key, const VersionPart& part)
+            {
+                const auto last = std::find_if_not(
+                                      part.crbegin(),
+                                      part.crend(),
+                                      [](const auto& a) { return is_empty(a); }
+                )
+                                      .base();
+                for (auto it = part.cbegin(); it != last; ++it)
+                {
+                    if (is_empty(*it))
+                    {
+                        const auto next = std::find_if_not(
+                            it,
+                            last,
+                            [](const auto& a) { return is_empty(a); }
+                        );
+                        key.push_back(
+                            less_than_empty(*next) ? empty_before_less : empty_before_greater
+                        );
+                    }
+                    else
+                    {
+                        append_atom(key, *it);
+                    }
+                }
+                key.push_back(end);
+            }
+
+            void append_common_version(std::string& key, const CommonVersion& version)
+            {
+                const auto last = std::find_if_not(
+                                      version.crbegin(),
+                                      version.crend(),
+                                      [](const auto& p) { return is_empty(p); }
+                )
+                                      .base();
+                for (auto it = version.cbegin(); it != last; ++it)
+                {
+                    if (is_empty(*it))
+                    {
+                        const auto next = std::find_if_not(
+                            it,
+                            last,
+                            [](const auto& p) { return is_empty(p); }
+                        );
+                        key.push_back(
+                            less_than_empty(*next) ? empty_part_before_less
+                                                   : empty_part_before_greater
+                        );
+                    }
+                    else
+                    {
+                        append_part(key, *it);
+                    }
+                }
+                key.push_back(end);
+            }
+
+            auto make(std::size_t epoch, const CommonVersion& version, const CommonVersion& local)
+                -> std::string
+            {
+                auto key = std::string();
+                append_numeral(key, epoch);
+                append_common_version(key, version);
+                append_common_version(key, local);
+                return key;
+            }
+        }
+    }
+
+    Version::Version() noexcept
+        : m_sort_key{ sort_key::make(0, m_version, m_local) }
+    {
+    }
+
+    Version::Version(std::size_t epoch, CommonVersion version, CommonVersion local)
         : m_version{ std::move(version) }
         , m_local{ std::move(local) }
+        , m_sort_key{ sort_key::make(epoch, m_version, m_local) }
         , m_epoch{ epoch }
     {
     }
 
+    auto Version::sort_key() const noexcept -> const std::string&
+    {
+        return m_sort_key;
+    }
+
     auto Version::epoch() const noexcept -> std::size_t
     {
         return m_epoch;
@@ -351,26 +555,12 @@ namespace mamba::specs
                        [](const auto& x, const auto& y) { return compare_three_way(x, y); }
             ).first;
         }
-
-        template <>
-        auto compare_three_way(const Version& a, const Version& b) -> strong_ordering
-        {
-            if (auto c = compare_three_way(a.epoch(), b.epoch()); c != strong_ordering::equal)
-            {
-                return c;
-            }
-            if (auto c = compare_three_way(a.version(), b.version()); c != strong_ordering::equal)
-            {
-                return c;
-            }
-            return compare_three_way(a.local(), b.local());
-        }
     }
 
-    // TODO(C++20) use operator<=> to simplify code and improve operator<=
+    // TODO(C++20) use operator<=> to simplify code
     auto Version::operator==(const Version& other) const -> bool
     {
-        return compare_three_way(*this, other) == strong_ordering::equal;
+        return m_sort_key == other.m_sort_key;
     }
 
     auto Version::operator!=(const Version& other) const -> bool
@@ -380,22 +570,22 @@ namespace mamba::specs
 
     auto Version::operator<(const Version& other) const -> bool
     {
-        return compare_three_way(*this, other) == strong_ordering::less;
+        return m_sort_key < other.m_sort_key;
     }
 
     auto Version::operator<=(const Version& other) const -> bool
     {
-        return compare_three_way(*this, other) != strong_ordering::greater;
+        return m_sort_key <= other.m_sort_key;
     }
 
     auto Version::operator>(const Version& other) const -> bool
     {
-        return compare_three_way(*this, other) == strong_ordering::greater;
+        return m_sort_key > other.m_sort_key;
     }
 
     auto Version::operator>=(const Version& other) const -> bool
     {
-        return compare_three_way(*this, other) != strong_ordering::less;
+        return m_sort_key >= other.m_sort_key;
     }
 
     namespace
@@ -509,6 +699,47 @@ namespace mamba::specs
                && compatible_with_impl(local(), older.local(), level);
     }
 
+    auto Version::starts_with_key_prefix() const -> std::string
+    {
+        auto key = std::string();
+        sort_key::append_numeral(key, epoch());
+        if (version().empty() || version().front().empty())
+        {
+            return key;
+        }
+        const auto& atom = version().front().front();
+        if (atom.literal().empty())
+        {
+            // Any literal may follow the numeral, and a zero numeral can have many encodings
+            if (atom.numeral() > 0)
+            {
+                sort_key::append_numeral(key, atom.numeral());
+            }
+        }
+        else
+        {
+            sort_key::append_atom(key, atom);
+        }
+        return key;
+    }
+
+    auto Version::compatible_with_key_prefix(std::size_t level) const -> std::string
+    {
+        auto key = std::string();
+        sort_key::append_numeral(key, epoch());
+        const auto n_parts = std::min(level, version().size());
+        for (std::size_t i = 0; i < n_parts; ++i)
+        {
+            // Empty parts are encoded differently depending on the following parts
+            if (sort_key::is_empty(version()[i]))
+            {
+                break;
+            }
+            sort_key::append_part(key, version()[i]);
+        }
+        return key;
+    }
+
     namespace
     {
         // TODO(C++20) This is a std::string_view constructor
@@ -0,0 +1,283 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "mamba/specs/version_interval_set.hpp"
+
+namespace mamba::specs
+{
+    namespace
+    {
+        using Interval = VersionIntervalSet::Interval;
+        using key_type = VersionIntervalSet::key_type;
+
+        /** The smallest key strictly greater than the given one. */
+        auto key_successor(const key_type& key) -> key_type
+        {
+            auto out = key;
+            out.push_back('\0');
+            return out;
+        }
+
+        /** The smallest key greater than all keys starting with the given prefix. */
+        auto prefix_successor(std::string_view prefix) -> std::optional<key_type>
+        {
+            auto out = key_type(prefix);
+            while (!out.empty() && (static_cast<unsigned char>(out.back()) == 0xFF))
+            {
+                out.pop_back();
+            }
+            if (out.empty())
+            {
+                return std::nullopt;
+            }
+            out.back() = static_cast<char>(static_cast<unsigned char>(out.back()) + 1);
+            return out;
+        }
+
+        /** Compare upper bounds, where the empty optional is the largest. */
+        auto upper_less(const std::optional<key_type>& a, const std::optional<key_type>& b) -> bool
+        {
+            return a.has_value() && (!b.has_value() || (*a < *b));
+        }
+
+        /** Whether a lower bound is not past an upper bound, i.e. the intervals touch. */
+        auto lower_reaches(const key_type& lower, const std::optional<key_type>& upper) -> bool
+        {
+            return !upper.has_value() || (lower <= *upper);
+        }
+
+        auto is_empty_interval(const Interval& inter) -> bool
+        {
+            return inter.upper.has_value() && (*inter.upper <= inter.lower);
+        }
+
+        /** Sort and merge overlapping or adjacent intervals. */
+        auto normalize(std::vector<Interval> intervals) -> std::vector<Interval>
+        {
+            intervals.erase(
+                std::remove_if(intervals.begin(), intervals.end(), is_empty_interval),
+                intervals.end()
+            );
+            std::sort(
+                intervals.begin(),
+                intervals.end(),
+                [](const auto& a, const auto& b) { return a.lower < b.lower; }
+            );
+
+            auto out = std::vector<Interval>();
+            out.reserve(intervals.size());
+            for (auto& inter : intervals)
+            {
+                if (!out.empty() && lower_reaches(inter.lower, out.back().upper))
+                {
+                    if (upper_less(out.back().upper, inter.upper))
+                    {
+                        out.back().upper = std::move(inter.upper);
+                    }
+                }
+                else
+                {
+                    out.push_back(std::move(inter));
+                }
+            }
+            return out;
+        }
+    }
+
+    /***************************************
+     *  VersionIntervalSet Implementation  *
+     ***************************************/
+
+    auto VersionIntervalSet::Interval::contains(std::string_view key) const -> bool
+    {
+        return (std::string_view(lower) <= key)
+               && (!upper.has_value() || (key < std::string_view(*upper)));
+    }
+
+    auto VersionIntervalSet::make_empty() -> VersionIntervalSet
+    {
+        return VersionIntervalSet(std::vector<Interval>{});
+    }
+
+    auto VersionIntervalSet::make_free() -> VersionIntervalSet
+    {
+        return {};
+    }
+
+    auto VersionIntervalSet::make_equal_to(const Version& ver) -> VersionIntervalSet
+    {
+        return VersionIntervalSet({ Interval{ ver.sort_key(), key_successor(ver.sort_key()) } });
+    }
+
+    auto VersionIntervalSet::make_not_equal_to(const Version& ver) -> VersionIntervalSet
+    {
+        return VersionIntervalSet({
+            Interval{ {}, ver.sort_key() },
+            Interval{ key_successor(ver.sort_key()), std::nullopt },
+        });
+    }
+
+    auto VersionIntervalSet::make_greater(const Version& ver) -> VersionIntervalSet
+    {
+        return VersionIntervalSet({ Interval{ key_successor(ver.sort_key()), std::nullopt } });
+    }
+
+    auto VersionIntervalSet::make_greater_equal(const Version& ver) -> VersionIntervalSet
+    {
+        return VersionIntervalSet({ Interval{ ver.sort_key(), std::nullopt } });
+    }
+
+    auto VersionIntervalSet::make_less(const Version& ver) -> VersionIntervalSet
+    {
+        return VersionIntervalSet({ Interval{ {}, ver.sort_key() } });
+    }
+
+    auto VersionIntervalSet::make_less_equal(const Version& ver) -> VersionIntervalSet
+    {
+        return VersionIntervalSet({ Interval{ {}, key_successor(ver.sort_key()) } });
+    }
+
+    auto VersionIntervalSet::make_key_prefix(std::string_view prefix) -> VersionIntervalSet
+    {
+        return VersionIntervalSet({ Interval{ key_type(prefix), prefix_successor(prefix) } });
+    }
+
+    VersionIntervalSet::VersionIntervalSet()
+        : m_intervals{ Interval{} }
+    {
+    }
+
+    VersionIntervalSet::VersionIntervalSet(std::vector<Interval> intervals, bool exact)
+        : m_intervals(normalize(std::move(intervals)))
+        , m_exact(exact)
+    {
+    }
+
+    auto VersionIntervalSet::intervals() const -> const std::vector<Interval>&
+    {
+        return m_intervals;
+    }
+
+    auto VersionIntervalSet::is_exact() const -> bool
+    {
+        return m_exact;
+    }
+
+    void VersionIntervalSet::set_exact(bool exact)
+    {
+        m_exact = exact;
+    }
+
+    auto VersionIntervalSet::is_empty() const -> bool
+    {
+        return m_intervals.empty();
+    }
+
+    auto VersionIntervalSet::is_free() const -> bool
+    {
+        return (m_intervals.size() == 1) && m_intervals.front().lower.empty()
+               && !m_intervals.front().upper.has_value();
+    }
+
+    auto VersionIntervalSet::contains(const Version& point) const -> bool
+    {
+        return contains_key(point.sort_key());
+    }
+
+    auto VersionIntervalSet::contains_key(std::string_view key) const -> bool
+    {
+        // First interval starting after the key, the previous one is the only candidate
+        const auto it = std::upper_bound(
+            m_intervals.cbegin(),
+            m_intervals.cend(),
+            key,
+            [](std::string_view k, const Interval& inter) { return k < inter.lower; }
+        );
+        return (it != m_intervals.cbegin()) && std::prev(it)->contains(key);
+    }
+
+    auto VersionIntervalSet::intersection(const VersionIntervalSet& other) const
+        -> VersionIntervalSet
+    {
+        auto out = std::vector<Interval>();
+        auto a = m_intervals.cbegin();
+        auto b = other.m_intervals.cbegin();
+        while ((a != m_intervals.cend()) && (b != other.m_intervals.cend()))
+        {
+            auto inter = Interval{
+                std::max(a->lower, b->lower),
+                upper_less(a->upper, b->upper) ? a->upper : b->upper,
+            };
+            if (!is_empty_interval(inter))
+            {
+                out.push_back(std::move(inter));
+            }
+            // Advance the interval ending first
+            if (upper_less(a->upper, b->upper))
+            {
+                ++a;
+            }
+            else
+            {
+                ++b;
+            }
+        }
+        return VersionIntervalSet(std::move(out), is_exact() && other.is_exact());
+    }
+
+    auto VersionIntervalSet::union_with(const VersionIntervalSet& other) const
+        -> VersionIntervalSet
+    {
+        auto all = m_intervals;
+        all.insert(all.end(), other.m_intervals.cbegin(), other.m_intervals.cend());
+        return VersionIntervalSet(std::move(all), is_exact() && other.is_exact());
+    }
+
+    auto VersionIntervalSet::complement() const -> VersionIntervalSet
+    {
+        if (!is_exact())
+        {
+            return VersionIntervalSet({ Interval{} }, false);
+        }
+
+        auto out = std::vector<Interval>();
+        auto lower = key_type();
+        for (const auto& inter : m_intervals)
+        {
+            out.push_back({ std::move(lower), inter.lower });
+            if (!inter.upper.has_value())
+            {
+                return VersionIntervalSet(std::move(out));
+            }
+            lower = *inter.upper;
+        }
+        out.push_back({ std::move(lower), std::nullopt });
+        return VersionIntervalSet(std::move(out));
+    }
+
+    auto VersionIntervalSet::operator==(const VersionIntervalSet& other) const -> bool
+    {
+        const auto interval_equal = [](const Interval& a, const Interval& b)
+        { return (a.lower == b.lower) && (a.upper == b.upper); };
+        return (m_exact == other.m_exact)
+               && std::equal(
+                   m_intervals.cbegin(),
+                   m_intervals.cend(),
+                   other.m_intervals.cbegin(),
+                   other.m_intervals.cend(),
+                   interval_equal
+               );
+    }
+
+    auto VersionIntervalSet::operator!=(const VersionIntervalSet& other) const -> bool
+    {
+        return !(*this == other);
+    }
+}
@@ -6,7 +6,11 @@
 
 #include <algorithm>
 #include <array>
+#include <cassert>
+#include <memory>
+#include <optional>
 #include <type_traits>
+#include <vector>
 
 #include <fmt/format.h>
 
@@ -102,6 +106,69 @@ namespace mamba::specs
         return std::visit([&](const auto& op) { return op(point, m_version); }, m_operator);
     }
 
+    auto VersionPredicate::to_interval_set() const -> VersionIntervalSet
+    {
+        return std::visit(
+            [&](const auto& op) -> VersionIntervalSet
+            {
+                using Op = std::decay_t<decltype(op)>;
+                if constexpr (std::is_same_v<Op, free_interval>)
+                {
+                    return VersionIntervalSet::make_free();
+                }
+                if constexpr (std::is_same_v<Op, std::equal_to<Version>>)
+                {
+                    return VersionIntervalSet::make_equal_to(m_version);
+                }
+                if constexpr (std::is_same_v<Op, std::not_equal_to<Version>>)
+                {
+                    return VersionIntervalSet::make_not_equal_to(m_version);
+                }
+                if constexpr (std::is_same_v<Op, std::greater<Version>>)
+                {
+                    return VersionIntervalSet::make_greater(m_version);
+                }
+                if constexpr (std::is_same_v<Op, std::greater_equal<Version>>)
+                {
+                    return VersionIntervalSet::make_greater_equal(m_version);
+                }
+                if constexpr (std::is_same_v<Op, std::less<Version>>)
+                {
+                    return VersionIntervalSet::make_less(m_version);
+                }
+                if constexpr (std::is_same_v<Op, std::less_equal<Version>>)
+                {
+                    return VersionIntervalSet::make_less_equal(m_version);
+                }
+                if constexpr (std::is_same_v<Op, starts_with>)
+                {
+                    const auto prefix = m_version.starts_with_key_prefix();
+                    auto out = VersionIntervalSet::make_key_prefix(prefix);
+                    out.set_exact(false);
+                    return out;
+                }
+                if constexpr (std::is_same_v<Op, not_starts_with>)
+                {
+                    auto out = VersionIntervalSet::make_free();
+                    out.set_exact(false);
+                    return out;
+                }
+                if constexpr (std::is_same_v<Op, compatible_with>)
+                {
+                    // Compatible versions are never smaller
+                    auto out = VersionIntervalSet::make_greater_equal(m_version).intersection(
+                        VersionIntervalSet::make_key_prefix(
+                            m_version.compatible_with_key_prefix(op.level)
+                        )
+                    );
+                    out.set_exact(false);
+                    return out;
+                }
+            },
+            m_operator
+        );
+    }
+
     auto VersionPredicate::make_free() -> VersionPredicate
     {
         return VersionPredicate({}, free_interval{});
@@ -299,6 +366,56 @@ namespace mamba::specs
         return m_tree.evaluate([&point](const auto& node) { return node.contains(point); });
     }
 
+    auto VersionSpec::to_interval_set() const -> VersionIntervalSet
+    {
+        // An empty expression is free, as in ``contains``.
+        if (m_tree.empty())
+        {
+            return VersionIntervalSet::make_free();
+        }
+
+        auto stack = std::vector<VersionIntervalSet>();
+        m_tree.postfix_for_each(
+            [&](const auto& token)
+            {
+                using Token = std::decay_t<decltype(token)>;
+                if constexpr (std::is_same_v<Token, util::BoolOperator>)
+                {
+                    assert(stack.size() >= 2);
+                    auto right = std::move(stack.back());
+                    stack.pop_back();
+                    auto& left = stack.back();
+                    if (token == util::BoolOperator::logical_and)
+                    {
+                        left = left.intersection(right);
+                    }
+                    else
+                    {
+                        left = left.union_with(right);
+                    }
+                }
+                else
+                {
+                    stack.push_back(token.to_interval_set());
+                }
+            }
+        );
+        assert(stack.size() == 1);
+        return std::move(stack.back());
+    }
+
+    auto VersionSpec::cached_interval_set() const -> std::shared_ptr<const VersionIntervalSet>
+    {
+        // Specs shared between threads may both compile the set, keeping either is fine
+        auto set = std::atomic_load(&m_interval_set);
+        if (set == nullptr)
+        {
+            set = std::make_shared<const VersionIntervalSet>(to_interval_set());
+            std::atomic_store(&m_interval_set, set);
+        }
+        return set;
+    }
+
     auto VersionSpec::is_explicitly_free() const -> bool
     {
         const auto free_pred = VersionPredicate::make_free();
@@ -452,6 +569,65 @@ namespace mamba::specs
                 ParseError(fmt::format(R"(Found invalid version predicate in "{}")", str))
             );
         }
+
+        /**
+         * Parse the common forms ``>=1.2`` and ``>=1.2,<2.0`` without the infix parser.
+         *
+         * Expressions with ``|`` or parentheses, or with empty predicates, are left to the
+         * general parser, in which case nothing is returned.
+         * The tree built is the same as the one from the infix parser, namely a right
+         * associative chain of conjunctions.
+         */
+        auto parse_conjunction(std::string_view str) -> std::optional<expected_parse_t<VersionSpec>>
+        {
+            static constexpr auto complex_tokens = std::array{
+                VersionSpec::or_token,
+                VersionSpec::left_parenthesis_token,
+                VersionSpec::right_parenthesis_token,
+            };
+            const auto complex_it = std::find_first_of(
+                str.cbegin(),
+                str.cend(),
+                complex_tokens.cbegin(),
+                complex_tokens.cend()
+            );
+            if (complex_it != str.cend())
+            {
+                return std::nullopt;
+            }
+
+            auto parser = util::PostfixParser<VersionPredicate, util::BoolOperator>();
+            std::size_t n_predicates = 0;
+            auto rest = std::optional<std::string_view>(str);
+            while (rest.has_value())
+            {
+                auto [op_ver, tail] = util::split_once(rest.value(), VersionSpec::and_token);
+                op_ver = util::strip(op_ver);
+                if (op_ver.empty())
+                {
+                    return std::nullopt;
+                }
+                auto pred = parse_op_and_version(op_ver);
+                if (!pred.has_value())
+                {
+                    return { tl::make_unexpected(std::move(pred).error()) };
+                }
+                [[maybe_unused]] const bool pushed = parser.push_variable(std::move(pred).value());
+                assert(pushed);
+                ++n_predicates;
+                rest = tail;
+            }
+            for (std::size_t i = 1; i < n_predicates; ++i)
+            {
+                [[maybe_unused]] const bool pushed = parser.push_operator(
+                    util::BoolOperator::logical_and
+                );
+                assert(pushed);
+            }
+            [[maybe_unused]] const bool correct = parser.finalize();
+            assert(correct);
+            return { VersionSpec{ std::move(parser).tree() } };
+        }
     }
 
     auto VersionSpec::parse(std::string_view str) -> expected_parse_t<VersionSpec>
@@ -477,6 +653,11 @@ namespace mamba::specs
             return {};
         }
 
+        if (auto spec = parse_conjunction(str))
+        {
+            return std::move(spec).value();
+        }
+
         while (!str.empty())
         {
             if (str.front() == VersionSpec::and_token)
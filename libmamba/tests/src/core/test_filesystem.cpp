@@ -4,10 +4,14 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <fstream>
+#include <string>
+#include <system_error>
 #include <vector>
 
 #include <doctest/doctest.h>
 
+#include "mamba/core/fsutil.hpp"
 #include "mamba/core/util.hpp"
 #include "mamba/core/util_scope.hpp"
 #include "mamba/fs/filesystem.hpp"
@@ -287,6 +291,71 @@ namespace mamba
             fs::remove_all(tmp_dir);
             CHECK_FALSE(fs::exists(tmp_dir));
         }
+
+        TEST_CASE("copy_file")
+        {
+            const auto tmp_dir = fs::temp_directory_path() / "mamba-fs-copy-delete-me";
+            mamba::on_scope_exit _([&] { fs::remove_all(tmp_dir); });
+            fs::create_directories(tmp_dir);
+
+            // Spans several chunks of whichever copy method the file systems allow
+            std::string content(3 * 1024 * 1024 + 7, '\0');
+            for (std::size_t i = 0; i < content.size(); ++i)
+            {
+                content[i] = static_cast<char>((i * 31) % 251);
+            }
+            const auto from = tmp_dir / "from";
+            {
+                std::ofstream out{ from.std_path(), std::ios::binary };
+                out << content;
+            }
+            const auto perms = fs::perms::owner_read | fs::perms::owner_exec;
+            fs::permissions(from, perms, fs::perm_options::replace);
+
+            const auto to = tmp_dir / "to";
+            std::error_code ec;
+            mamba_fs::copy_file(from, to, ec);
+            REQUIRE_FALSE(ec);
+            std::ifstream in{ to.std_path(), std::ios::binary };
+            const auto copied = std::string(
+                std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>()
+            );
+            CHECK(copied == content);
+#ifndef _WIN32
+            CHECK_EQ(fs::status(to).permissions(), perms);
+#endif
+
+            // The destination is never overwritten
+            mamba_fs::copy_file(from, to, ec);
+            CHECK(ec);
+
+#ifdef __linux__
+            // procfs reports an empty size and cannot be copied by the kernel, so the data
+            // goes through the user space buffer
+            const auto proc_file = fs::u8path("/proc/version");
+            if (fs::exists(proc_file))
+            {
+                const auto proc_to = tmp_dir / "version";
+                mamba_fs::copy_file(proc_file, proc_to, ec);
+                REQUIRE_FALSE(ec);
+                std::ifstream expected_in{ proc_file.std_path(), std::ios::binary };
+                std::ifstream copied_in{ proc_to.std_path(), std::ios::binary };
+                const auto expected = std::string(
+                    std::istreambuf_iterator<char>(expected_in),
+                    std::istreambuf_iterator<char>()
+                );
+                CHECK_FALSE(expected.empty());
+                CHECK_EQ(
+                    std::string(
+                        std::istreambuf_iterator<char>(copied_in),
+                        std::istreambuf_iterator<char>()
+                    ),
+                    expected
+                );
+            }
+#endif
+        }
     }
 
 }
@@ -0,0 +1,119 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#include <string>
+
+#include <doctest/doctest.h>
+#include <nlohmann/json.hpp>
+
+#include "mamba/core/link.hpp"
+#include "mamba/core/transaction_context.hpp"
+#include "mamba/core/util.hpp"
+#include "mamba/fs/filesystem.hpp"
+#include "mamba/specs/package_info.hpp"
+#include "mamba/util/string.hpp"
+
+#include "mambatests.hpp"
+
+using namespace mamba;
+
+namespace
+{
+    auto make_binary_content(const std::string& placeholder) -> std::string
+    {
+        auto content = std::string(64 * 1024, '\0');
+        for (std::size_t i = 0; i < content.size(); ++i)
+        {
+            content[i] = static_cast<char>(1 + (i * 31) % 250);
+        }
+        // C strings holding the prefix, as found in compiled libraries
+        const auto first = util::concat(placeholder, "/lib/python3.12", std::string(1, '\0'));
+        const auto second = util::concat(placeholder, std::string(1, '\0'));
+        content.replace(1000, first.size(), first);
+        content.replace(40000, second.size(), second);
+        return content;
+    }
+}
+
+TEST_SUITE("core::link")
+{
+#ifndef _WIN32
+    TEST_CASE("Binary prefix replacement of the same size")
+    {
+        auto tmp_dir = TemporaryDirectory();
+        const auto cache = tmp_dir.path() / "pkgs";
+        const auto prefix = tmp_dir.path() / "prefix";
+
+        auto pkg = specs::PackageInfo("foo", "1.0", "h0_0", 0);
+        const auto pkg_dir = cache / pkg.str();
+        fs::create_directories(pkg_dir / "info");
+        fs::create_directories(pkg_dir / "lib");
+        fs::create_directories(prefix);
+
+        const auto placeholder = util::concat("/opt/placeholder", std::string(200, '_'));
+        REQUIRE_GT(placeholder.size(), prefix.string().size());
+        const auto content = make_binary_content(placeholder);
+        const auto src = pkg_dir / "lib" / "libfoo.so";
+        {
+            auto out = open_ofstream(src, std::ios::out | std::ios::binary);
+            out << content;
+        }
+        // Files in the package cache are not writable
+        const auto perms = fs::perms::owner_read | fs::perms::owner_exec | fs::perms::group_read
+                           | fs::perms::group_exec | fs::perms::others_read
+                           | fs::perms::others_exec;
+        fs::permissions(src, perms, fs::perm_options::replace);
+
+        {
+            const auto paths = nlohmann::json{
+                { "paths_version", 1 },
+                { "paths",
+                  { { { "_path", "lib/libfoo.so" },
+                      { "path_type", "hardlink" },
+                      { "file_mode", "binary" },
+                      { "prefix_placeholder", placeholder },
+                      { "size_in_bytes", content.size() } } } },
+            };
+            auto out = open_ofstream(pkg_dir / "info" / "paths.json");
+            out << paths.dump();
+        }
+        {
+            auto out = open_ofstream(pkg_dir / "info" / "repodata_record.json");
+            out << nlohmann::json::object().dump();
+        }
+
+        auto transaction_context = TransactionContext(
+            mambatests::context(),
+            prefix,
+            prefix,
+            { "", "" },
+            {}
+        );
+        auto link = LinkPackage(pkg, cache, &transaction_context);
+        REQUIRE(link.execute());
+
+        const auto dst = prefix / "lib" / "libfoo.so";
+        REQUIRE(fs::exists(dst));
+        const auto linked = read_contents(dst, std::ios::in | std::ios::binary);
+
+        // The placeholder is replaced in place and padded to keep the offsets of the file
+        const auto padding = std::string(placeholder.size() - prefix.string().size(), '\0');
+        auto expected = content;
+        const auto first = util::concat(prefix.string(), "/lib/python3.12", padding);
+        const auto second = util::concat(prefix.string(), padding);
+        expected.replace(1000, first.size(), first);
+        expected.replace(40000, second.size(), second);
+        CHECK_EQ(linked.size(), content.size());
+        CHECK(linked == expected);
+        CHECK_EQ(fs::status(dst).permissions(), perms);
+
+        // The file in the cache is left untouched
+        CHECK(read_contents(src, std::ios::in | std::ios::binary) == content);
+        CHECK_EQ(fs::status(src).permissions(), perms);
+        CHECK(fs::exists(prefix / "conda-meta" / (pkg.str() + ".json")));
+    }
+#endif
+}
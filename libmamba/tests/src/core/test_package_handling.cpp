@@ -0,0 +1,322 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#include <array>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <fmt/format.h>
+
+#include "mamba/core/package_handling.hpp"
+#include "mamba/core/util.hpp"
+
+#include "core/bounded_queue.hpp"
+
+namespace mamba
+{
+    namespace
+    {
+        // Poorly compressible content spanning several read and write blocks
+        std::string make_large_content()
+        {
+            std::mt19937 gen(42);
+            std::string content(3 * 1024 * 1024, '\0');
+            for (auto& c : content)
+            {
+                c = static_cast<char>(gen() & 0xff);
+            }
+            return content;
+        }
+
+        constexpr std::size_t small_files_count = 300;
+
+        void make_package_dir(const fs::u8path& dir, const std::string& large_content)
+        {
+            fs::create_directories(dir / "info");
+            fs::create_directories(dir / "lib");
+            fs::create_directories(dir / "share");
+            open_ofstream(dir / "info" / "index.json") << R"({"name": "test"})";
+            for (std::size_t i = 0; i < small_files_count; ++i)
+            {
+                open_ofstream(dir / "lib" / ("file_" + std::to_string(i) + ".txt")) << i;
+            }
+            open_ofstream(dir / "lib" / "empty.txt");
+            open_ofstream(dir / "share" / "large.bin") << large_content;
+#ifndef _WIN32
+            fs::create_symlink("file_0.txt", dir / "lib" / "link.txt");
+#endif
+        }
+
+        /** Write an uncompressed tar archive of regular files, in the given order. */
+        void write_tar(
+            const fs::u8path& path,
+            const std::vector<std::pair<std::string, std::string>>& files
+        )
+        {
+            auto out = open_ofstream(path);
+            for (const auto& [name, content] : files)
+            {
+                std::array<char, 512> header = {};
+                const auto set = [&](std::size_t offset, const std::string& value)
+                { std::copy(value.begin(), value.end(), header.begin() + offset); };
+                set(0, name);
+                set(100, "0000644");
+                set(108, "0000000");
+                set(116, "0000000");
+                set(124, fmt::format("{:011o}", content.size()));
+                set(136, "00000000000");
+                set(148, "        ");
+                header[156] = '0';
+                set(257, "ustar");
+                set(263, "00");
+                unsigned int checksum = 0;
+                for (const char c : header)
+                {
+                    checksum += static_cast<unsigned char>(c);
+                }
+                set(148, fmt::format("{:06o}", checksum));
+                header[154] = '\0';
+
+                out.write(header.data(), header.size());
+                out << content << std::string((512 - content.size() % 512) % 512, '\0');
+            }
+            out << std::string(2 * 512, '\0');
+        }
+    }
+
+    TEST_SUITE("package_handling")
+    {
+        TEST_CASE("bounded_queue")
+        {
+            bounded_queue<int> queue(2);
+            CHECK(queue.push(1));
+            CHECK(queue.push(2));
+            CHECK_EQ(queue.pop(), 1);
+            queue.close();
+            CHECK_EQ(queue.pop(), 2);
+            CHECK_FALSE(queue.pop().has_value());
+
+            bounded_queue<int> cancelled(1);
+            cancelled.cancel();
+            CHECK_FALSE(cancelled.push(1));
+            CHECK(cancelled.is_cancelled());
+        }
+
+        TEST_CASE("extract_round_trip")
+        {
+            const std::string large_content = make_large_content();
+            TemporaryDirectory tmp;
+            const auto src = tmp.path() / "src";
+            make_package_dir(src, large_content);
+
+            auto options = ExtractOptions{ false, extract_subproc_mode::mamba_package };
+            std::string mode = "sequential";
+            SUBCASE("sequential writes")
+            {
+                options.write_mode = extract_write_mode::sequential;
+            }
+            SUBCASE("batched writes")
+            {
+                options.write_mode = extract_write_mode::batched;
+                options.write_threads = 4;
+                mode = "batched";
+            }
+
+            for (std::string ext : { ".tar.bz2", ".conda" })
+            {
+                CAPTURE(ext);
+                const auto pkg = tmp.path() / ("test-1.0-0" + ext);
+                create_package(src, pkg, 1, 1);
+                REQUIRE(fs::exists(pkg));
+
+                const auto dest = tmp.path() / ("extracted-" + mode + ext);
+                extract(pkg, dest, options);
+
+                CHECK_EQ(read_contents(dest / "info" / "index.json"), R"({"name": "test"})");
+                for (std::size_t i = 0; i < small_files_count; ++i)
+                {
+                    const auto name = "file_" + std::to_string(i) + ".txt";
+                    CHECK_EQ(read_contents(dest / "lib" / name), std::to_string(i));
+                }
+                CHECK(fs::exists(dest / "lib" / "empty.txt"));
+                CHECK_EQ(read_contents(dest / "lib" / "empty.txt"), "");
+                CHECK(read_contents(dest / "share" / "large.bin") == large_content);
+#ifndef _WIN32
+                CHECK(fs::is_symlink(dest / "lib" / "link.txt"));
+                CHECK_EQ(read_contents(dest / "lib" / "link.txt"), "0");
+                const auto perms = fs::status(dest / "lib" / "file_0.txt").permissions();
+                CHECK((perms & fs::perms::owner_read) != fs::perms::none);
+#endif
+            }
+        }
+
+        TEST_CASE("extract_malicious_archive")
+        {
+            TemporaryDirectory tmp;
+            auto options = ExtractOptions{ false, extract_subproc_mode::mamba_package };
+            std::string mode = "sequential";
+            SUBCASE("sequential writes")
+            {
+                options.write_mode = extract_write_mode::sequential;
+            }
+            SUBCASE("batched writes")
+            {
+                options.write_mode = extract_write_mode::batched;
+                mode = "batched";
+            }
+
+            const auto outside = tmp.path() / "outside";
+            fs::create_directories(outside);
+
+            // An entry escaping the destination through ".."
+            const auto dotdot = tmp.path() / "dotdot-1.0-0.tar.bz2";
+            write_tar(dotdot, { { "info/index.json", "{}" }, { "../outside/evil.txt", "evil" } });
+            CHECK_THROWS_AS(
+                extract_archive(dotdot, tmp.path() / ("dotdot-" + mode), options),
+                std::runtime_error
+            );
+            CHECK_FALSE(fs::exists(outside / "evil.txt"));
+
+#ifndef _WIN32
+            // An entry escaping the destination through an existing symlink
+            const auto dest = tmp.path() / ("symlink-" + mode);
+            fs::create_directories(dest);
+            fs::create_directory_symlink(outside, dest / "lib");
+            const auto symlink = tmp.path() / "symlink-1.0-0.tar.bz2";
+            write_tar(symlink, { { "info/index.json", "{}" }, { "lib/evil.txt", "evil" } });
+            extract_archive(symlink, dest, options);
+            CHECK_FALSE(fs::exists(outside / "evil.txt"));
+            CHECK_FALSE(fs::is_symlink(dest / "lib"));
+            CHECK_EQ(read_contents(dest / "lib" / "evil.txt"), "evil");
+#endif
+        }
+
+        TEST_CASE("transmute_round_trip")
+        {
+            const std::string large_content = make_large_content();
+            TemporaryDirectory tmp;
+            const auto src = tmp.path() / "src";
+            make_package_dir(src, large_content);
+            const auto options = ExtractOptions{ false, extract_subproc_mode::mamba_package };
+
+            fs::create_directories(tmp.path() / "created");
+            fs::create_directories(tmp.path() / "from_conda");
+            fs::create_directories(tmp.path() / "from_tar");
+            create_package(src, tmp.path() / "created" / "test-1.0-0.tar.bz2", 1, 1);
+            create_package(src, tmp.path() / "created" / "test-1.0-0.conda", 1, 1);
+
+            transmute(
+                tmp.path() / "created" / "test-1.0-0.conda",
+                tmp.path() / "from_conda" / "test-1.0-0.tar.bz2",
+                1,
+                1
+            );
+            transmute(
+                tmp.path() / "created" / "test-1.0-0.tar.bz2",
+                tmp.path() / "from_tar" / "test-1.0-0.conda",
+                1,
+                1
+            );
+            transmute(
+                tmp.path() / "from_tar" / "test-1.0-0.conda",
+                tmp.path() / "from_tar" / "test-1.0-0.tar.bz2",
+                1,
+                1
+            );
+
+            // Transmuting gives the same package as creating it from a directory
+            const auto from_conda = read_contents(tmp.path() / "from_conda" / "test-1.0-0.tar.bz2");
+            CHECK(read_contents(tmp.path() / "from_tar" / "test-1.0-0.tar.bz2") == from_conda);
+            CHECK(read_contents(tmp.path() / "created" / "test-1.0-0.tar.bz2") == from_conda);
+
+            const auto dest = tmp.path() / "extracted";
+            extract(tmp.path() / "from_tar" / "test-1.0-0.tar.bz2", dest, options);
+            CHECK_EQ(read_contents(dest / "info" / "index.json"), R"({"name": "test"})");
+            CHECK_EQ(read_contents(dest / "lib" / "file_42.txt"), "42");
+            CHECK(read_contents(dest / "share" / "large.bin") == large_content);
+        }
+
+        TEST_CASE("transmute_unsorted")
+        {
+            TemporaryDirectory tmp;
+            const auto options = ExtractOptions{ false, extract_subproc_mode::mamba_package };
+            // Not in the order of create_archive, so entries cannot be streamed
+            const auto unsorted = tmp.path() / "unsorted-1.0-0.tar.bz2";
+            write_tar(
+                unsorted,
+                {
+                    { "lib/b.txt", "b" },
+                    { "info/index.json", R"({"name": "unsorted"})" },
+                    { "lib/a.txt", "a" },
+                }
+            );
+
+            fs::create_directories(tmp.path() / "sorted");
+            for (std::string ext : { ".tar.bz2", ".conda" })
+            {
+                CAPTURE(ext);
+                const auto pkg = tmp.path() / "sorted" / ("unsorted-1.0-0" + ext);
+                transmute(unsorted, pkg, 1, 1);
+
+                const auto dest = tmp.path() / ("extracted" + ext);
+                extract(pkg, dest, options);
+                CHECK_EQ(read_contents(dest / "info" / "index.json"), R"({"name": "unsorted"})");
+                CHECK_EQ(read_contents(dest / "lib" / "a.txt"), "a");
+                CHECK_EQ(read_contents(dest / "lib" / "b.txt"), "b");
+            }
+
+            // The transmuted package is sorted, and copied as is
+            const auto sorted = tmp.path() / "sorted" / "unsorted-1.0-0.tar.bz2";
+            const auto copy = tmp.path() / "copy" / "unsorted-1.0-0.tar.bz2";
+            fs::create_directories(tmp.path() / "copy");
+            transmute(sorted, copy, 1, 1);
+            CHECK(read_contents(copy) == read_contents(sorted));
+        }
+
+        TEST_CASE("transmute_dot_prefix")
+        {
+            TemporaryDirectory tmp;
+            const auto options = ExtractOptions{ false, extract_subproc_mode::mamba_package };
+            // Sorted once the ``./`` prefix added by some tools is ignored
+            const auto prefixed = tmp.path() / "prefixed-1.0-0.tar.bz2";
+            write_tar(
+                prefixed,
+                {
+                    { "./info/index.json", R"({"name": "prefixed"})" },
+                    { "lib/a.txt", "a" },
+                    { "./lib/b.txt", "b" },
+                }
+            );
+
+            fs::create_directories(tmp.path() / "out");
+            const auto pkg = tmp.path() / "out" / "prefixed-1.0-0.conda";
+            transmute(prefixed, pkg, 1, 1);
+
+            // Prefixed metadata goes to the info part
+            const auto dest = tmp.path() / "info_only";
+            extract_conda(pkg, dest, options, { "info" });
+            CHECK_EQ(read_contents(dest / "info" / "index.json"), R"({"name": "prefixed"})");
+            CHECK_FALSE(fs::exists(dest / "lib"));
+
+            const auto all = tmp.path() / "all";
+            extract(pkg, all, options);
+            CHECK_EQ(read_contents(all / "lib" / "a.txt"), "a");
+            CHECK_EQ(read_contents(all / "lib" / "b.txt"), "b");
+        }
+
+        TEST_CASE("extract_corrupted_archive")
+        {
+            TemporaryDirectory tmp;
+            const auto pkg = tmp.path() / "corrupted-1.0-0.tar.bz2";
+            open_ofstream(pkg) << "BZh9 this is not a valid archive";
+            const auto options = ExtractOptions{ false, extract_subproc_mode::mamba_package };
+            CHECK_THROWS_AS(extract_archive(pkg, tmp.path() / "dest", options), std::runtime_error);
+        }
+    }
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <nlohmann/json.hpp>
+
+#include "mamba/core/package_store.hpp"
+#include "mamba/core/util.hpp"
+#include "mamba/util/cryptography.hpp"
+
+namespace mamba
+{
+    namespace
+    {
+        struct test_file
+        {
+            std::string path;
+            std::string content;
+            std::string sha256 = {};
+        };
+
+        void make_package_dir(const fs::u8path& dir, const std::vector<test_file>& files)
+        {
+            auto paths = nlohmann::json::array();
+            for (const auto& file : files)
+            {
+                fs::create_directories((dir / file.path).parent_path());
+                open_ofstream(dir / file.path) << file.content;
+                paths.push_back({
+                    { "_path", file.path },
+                    { "path_type", "hardlink" },
+                    { "sha256",
+                      file.sha256.empty() ? util::Sha256Hasher().str_hex_str(file.content)
+                                          : file.sha256 },
+                    { "size_in_bytes", file.content.size() },
+                });
+            }
+            const auto paths_json = nlohmann::json{ { "paths", paths }, { "paths_version", 1 } };
+            fs::create_directories(dir / "info");
+            open_ofstream(dir / "info" / "paths.json") << paths_json.dump();
+        }
+    }
+
+    TEST_SUITE("package_store")
+    {
+        TEST_CASE("deduplicate_package_files")
+        {
+            TemporaryDirectory tmp;
+            const auto store = content_store_path(tmp.path());
+            const auto pkg_a = tmp.path() / "a-1.0-py310_0";
+            const auto pkg_b = tmp.path() / "a-1.0-py311_0";
+            make_package_dir(pkg_a, { { "LICENSE", "BSD" }, { "lib/a.py", "python 3.10" } });
+            make_package_dir(pkg_b, { { "LICENSE", "BSD" }, { "lib/a.py", "python 3.11" } });
+
+            CHECK_EQ(deduplicate_package_files(pkg_a, store), 0);
+            CHECK_EQ(fs::hard_link_count(pkg_a / "LICENSE"), 2);
+
+            CHECK_EQ(deduplicate_package_files(pkg_b, store), 3);
+            CHECK_EQ(fs::hard_link_count(pkg_a / "LICENSE"), 3);
+            CHECK_EQ(fs::hard_link_count(pkg_b / "lib" / "a.py"), 2);
+            CHECK_EQ(read_contents(pkg_b / "LICENSE"), "BSD");
+            CHECK_EQ(read_contents(pkg_b / "lib" / "a.py"), "python 3.11");
+
+            SUBCASE("Garbage collection")
+            {
+                CHECK_EQ(collect_content_store_garbage(store), 0);
+
+                fs::remove_all(pkg_a);
+                CHECK_EQ(collect_content_store_garbage(store, /* dry_run= */ true), 11);
+                CHECK_EQ(collect_content_store_garbage(store), 11);
+                CHECK_EQ(collect_content_store_garbage(store), 0);
+                CHECK_EQ(fs::hard_link_count(pkg_b / "LICENSE"), 2);
+
+                fs::remove_all(pkg_b);
+                CHECK_EQ(collect_content_store_garbage(store), 14);
+                CHECK(fs::is_empty(store));
+            }
+        }
+
+        TEST_CASE("deduplicate_package_files_wrong_sha256")
+        {
+            TemporaryDirectory tmp;
+            const auto store = content_store_path(tmp.path());
+            const auto pkg_a = tmp.path() / "a-1.0-0";
+            const auto pkg_b = tmp.path() / "b-1.0-0";
+            const auto sha256 = util::Sha256Hasher().str_hex_str("genuine");
+            make_package_dir(pkg_a, { { "file", "forged!", sha256 } });
+            make_package_dir(pkg_b, { { "file", "genuine" } });
+
+            // A file not matching its sha256 is never shared with other packages
+            CHECK_EQ(deduplicate_package_files(pkg_a, store), 0);
+            CHECK_EQ(deduplicate_package_files(pkg_b, store), 0);
+            CHECK_EQ(fs::hard_link_count(pkg_a / "file"), 1);
+            CHECK_EQ(read_contents(pkg_b / "file"), "genuine");
+        }
+    }
+}
@@ -0,0 +1,183 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#include <chrono>
+#include <string>
+
+#include <doctest/doctest.h>
+#include <fmt/format.h>
+
+#include "mamba/core/channel_context.hpp"
+#include "mamba/core/prefix_data.hpp"
+#include "mamba/core/util.hpp"
+#include "mamba/fs/filesystem.hpp"
+
+#include "mambatests.hpp"
+
+using namespace mamba;
+
+namespace
+{
+    void write_record(const fs::u8path& conda_meta, std::size_t i)
+    {
+        // Records contain the file list of the package, which is skipped when loading
+        auto out = open_ofstream(conda_meta / fmt::format("pkg{}-1.{}-h0_{}.json", i, i, i));
+        out << fmt::format(
+            R"({{"build": "h0_{0}", "build_number": {0}, "channel": "conda-forge", )"
+            R"("constrains": [], "depends": ["python >=3.8", "libzlib"], )"
+            R"("files": ["lib/a.so", "lib/b.so"], "fn": "pkg{0}-1.{0}-h0_{0}.conda", )"
+            R"("license": "MIT", "md5": "abc", "name": "pkg{0}", "noarch": "python", )"
+            R"("paths_data": {{"paths": [{{"_path": "lib/a.so", "path_type": "hardlink"}}], )"
+            R"("paths_version": 1}}, "size": 1234, "subdir": "noarch", )"
+            R"("timestamp": 1700000000, "track_features": "", "version": "1.{0}"}})",
+            i
+        );
+    }
+}
+
+TEST_SUITE("core::prefix_data")
+{
+    TEST_CASE("Load conda-meta records")
+    {
+        const auto tmp_dir = TemporaryDirectory();
+        const auto conda_meta = tmp_dir.path() / "conda-meta";
+        fs::create_directories(conda_meta);
+        // Enough records to be read by multiple threads
+        static constexpr std::size_t n_records = 100;
+        for (std::size_t i = 0; i < n_records; ++i)
+        {
+            write_record(conda_meta, i);
+        }
+        open_ofstream(conda_meta / "history") << "";
+
+        auto channel_context = ChannelContext::make_conda_compatible(mambatests::context());
+        auto prefix_data = PrefixData::create(tmp_dir.path(), channel_context).value();
+
+        REQUIRE_EQ(prefix_data.records().size(), n_records);
+        const auto& pkg = prefix_data.records().at("pkg42");
+        CHECK_EQ(pkg.version, "1.42");
+        CHECK_EQ(pkg.build_string, "h0_42");
+        CHECK_EQ(pkg.build_number, 42);
+        CHECK_EQ(pkg.filename, "pkg42-1.42-h0_42.conda");
+        CHECK_EQ(pkg.platform, "noarch");
+        CHECK_EQ(pkg.size, 1234);
+        CHECK_EQ(pkg.md5, "abc");
+        CHECK_EQ(pkg.noarch, specs::NoArchType::Python);
+        CHECK_EQ(pkg.dependencies, std::vector<std::string>{ "python >=3.8", "libzlib" });
+        CHECK(pkg.track_features.empty());
+        CHECK_EQ(pkg.channel, "https://conda.anaconda.org/conda-forge/noarch");
+    }
+
+    TEST_CASE("Invalid conda-meta record")
+    {
+        const auto tmp_dir = TemporaryDirectory();
+        const auto conda_meta = tmp_dir.path() / "conda-meta";
+        fs::create_directories(conda_meta);
+        write_record(conda_meta, 0);
+        open_ofstream(conda_meta / "broken-1.0-0.json") << R"({"name": "broken", )";
+
+        auto channel_context = ChannelContext::make_conda_compatible(mambatests::context());
+        CHECK_FALSE(PrefixData::create(tmp_dir.path(), channel_context).has_value());
+    }
+
+    TEST_CASE("Prefix index")
+    {
+        const auto tmp_dir = TemporaryDirectory();
+        const auto conda_meta = tmp_dir.path() / "conda-meta";
+        fs::create_directories(conda_meta);
+        for (std::size_t i = 0; i < 5; ++i)
+        {
+            write_record(conda_meta, i);
+        }
+        const auto index_path = conda_meta / ".mamba-prefix-index";
+        auto channel_context = ChannelContext::make_conda_compatible(mambatests::context());
+
+        REQUIRE_EQ(PrefixData::create(tmp_dir.path(), channel_context).value().records().size(), 5);
+        // Loading a prefix does not write the index
+        CHECK_FALSE(fs::exists(index_path));
+        PrefixData::refresh_index(tmp_dir.path());
+        REQUIRE(fs::exists(index_path));
+
+        SUBCASE("Records from the index")
+        {
+            // An unchanged size and modification time is enough to use the indexed record
+            const auto path = conda_meta / "pkg3-1.3-h0_3.json";
+            const auto mtime = fs::last_write_time(path);
+            auto content = read_contents(path);
+            content.replace(content.find(R"("version": "1.3")"), 16, R"("version": "7.3")");
+            open_ofstream(path) << content;
+            fs::last_write_time(path, mtime);
+            fs::last_write_time(index_path, mtime + std::chrono::seconds(1));
+
+            const auto prefix_data = PrefixData::create(tmp_dir.path(), channel_context).value();
+            CHECK_EQ(prefix_data.records().size(), 5);
+            CHECK_EQ(prefix_data.records().at("pkg3").version, "1.3");
+        }
+
+        SUBCASE("Changed records")
+        {
+            fs::remove(conda_meta / "pkg1-1.1-h0_1.json");
+            {
+                auto out = open_ofstream(conda_meta / "pkg3-1.3-h0_3.json");
+                out << R"({"name": "pkg3", "version": "2.0", "build": "h1_0", )"
+                       R"("channel": "conda-forge", "subdir": "noarch", "depends": []})";
+            }
+            write_record(conda_meta, 7);
+
+            const auto prefix_data = PrefixData::create(tmp_dir.path(), channel_context).value();
+            CHECK_EQ(prefix_data.records().size(), 5);
+            CHECK_FALSE(prefix_data.records().count("pkg1"));
+            CHECK_EQ(prefix_data.records().at("pkg3").version, "2.0");
+            CHECK_EQ(prefix_data.records().at("pkg7").version, "1.7");
+        }
+
+        SUBCASE("Record changed within the index timestamp")
+        {
+            // Same size and modification time as the indexed record
+            const auto path = conda_meta / "pkg3-1.3-h0_3.json";
+            const auto mtime = fs::last_write_time(path);
+            auto content = read_contents(path);
+            content.replace(content.find(R"("version": "1.3")"), 16, R"("version": "7.3")");
+            open_ofstream(path) << content;
+            fs::last_write_time(path, mtime);
+            fs::last_write_time(index_path, mtime);
+
+            const auto prefix_data = PrefixData::create(tmp_dir.path(), channel_context).value();
+            CHECK_EQ(prefix_data.records().at("pkg3").version, "7.3");
+        }
+
+        SUBCASE("Corrupted index")
+        {
+            open_ofstream(index_path) << "not an index";
+            const auto prefix_data = PrefixData::create(tmp_dir.path(), channel_context).value();
+            CHECK_EQ(prefix_data.records().size(), 5);
+        }
+
+        SUBCASE("Refresh")
+        {
+            fs::remove(conda_meta / "pkg1-1.1-h0_1.json");
+            write_record(conda_meta, 7);
+            const auto index_mtime = fs::last_write_time(index_path);
+            PrefixData::create(tmp_dir.path(), channel_context).value();
+            CHECK_EQ(fs::last_write_time(index_path), index_mtime);
+
+            PrefixData::refresh_index(tmp_dir.path());
+            const auto prefix_data = PrefixData::create(tmp_dir.path(), channel_context).value();
+            CHECK_EQ(prefix_data.records().size(), 5);
+            CHECK_FALSE(prefix_data.records().count("pkg1"));
+            CHECK_EQ(prefix_data.records().at("pkg7").version, "1.7");
+        }
+
+        SUBCASE("Refresh with an invalid record")
+        {
+            open_ofstream(conda_meta / "broken-1.0-0.json") << R"({"name": "broken", )";
+            const auto index_content = read_contents(index_path);
+            // The index is left untouched and the error does not reach the caller
+            CHECK_NOTHROW(PrefixData::refresh_index(tmp_dir.path()));
+            CHECK_EQ(read_contents(index_path), index_content);
+        }
+    }
+}
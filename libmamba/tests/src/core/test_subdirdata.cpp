@@ -0,0 +1,84 @@
+// Copyright (c) 2024, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#include <string>
+
+#include <doctest/doctest.h>
+
+#include "mamba/core/subdirdata.hpp"
+#include "mamba/core/util.hpp"
+
+namespace mamba
+{
+    namespace
+    {
+        constexpr auto repodata = R"json({
+            "info": { "subdir": "linux-64" },
+            "packages": {
+                "a-1.0-0.tar.bz2": { "name": "a", "version": "1.0", "depends": ["b"] },
+                "b-1.0-0.tar.bz2": { "name": "b", "version": "1.0" },
+                "c-1.0-0.tar.bz2": { "name": "c", "version": "1.0" }
+            },
+            "packages.conda": {
+                "a-1.0-0.conda": { "name": "a", "version": "1.0", "depends": [] },
+                "c-2.0-0.conda": { "name": "c", "version": "2.0" }
+            },
+            "removed": ["b-0.1-0.tar.bz2"]
+        })json";
+    }
+
+    TEST_SUITE("subdirdata")
+    {
+        TEST_CASE("read_repodata_records")
+        {
+            TemporaryDirectory tmp;
+            const auto file = tmp.path() / "repodata.json";
+            open_ofstream(file) << repodata;
+
+            SUBCASE("Only the selected filenames")
+            {
+                const auto records = read_repodata_records(
+                    file,
+                    { "a-1.0-0.tar.bz2", "a-1.0-0.conda", "c-2.0-0.conda" }
+                );
+                REQUIRE_EQ(records.size(), 3);
+                CHECK_EQ(records.at("a-1.0-0.tar.bz2").at("depends"), nlohmann::json{ "b" });
+                CHECK(records.at("a-1.0-0.conda").at("depends").empty());
+                CHECK_EQ(records.at("c-2.0-0.conda").at("version"), "2.0");
+            }
+
+            SUBCASE("Missing entries are absent")
+            {
+                const auto records = read_repodata_records(
+                    file,
+                    // Extension not matching the section, removed package, and unknown package
+                    { "c-2.0-0.tar.bz2", "b-0.1-0.tar.bz2", "d-1.0-0.conda", "b-1.0-0.tar.bz2" }
+                );
+                REQUIRE_EQ(records.size(), 1);
+                CHECK_EQ(records.at("b-1.0-0.tar.bz2").at("name"), "b");
+                CHECK(read_repodata_records(file, {}).empty());
+            }
+
+            SUBCASE("Missing file")
+            {
+                CHECK(read_repodata_records(tmp.path() / "none.json", { "a-1.0-0.conda" }).empty());
+            }
+
+            SUBCASE("Malformed repodata")
+            {
+                const auto content = std::string(repodata);
+                open_ofstream(file) << content.substr(0, content.find("\"packages.conda\""));
+                CHECK(read_repodata_records(file, { "a-1.0-0.tar.bz2" }).empty());
+
+                open_ofstream(file) << R"json({"packages": {"a-1.0-0.tar.bz2": {"name": }}})json";
+                CHECK(read_repodata_records(file, { "a-1.0-0.tar.bz2" }).empty());
+
+                open_ofstream(file) << R"json(["a-1.0-0.tar.bz2"])json";
+                CHECK(read_repodata_records(file, { "a-1.0-0.tar.bz2" }).empty());
+            }
+        }
+    }
+}
@@ -4,7 +4,13 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <atomic>
 #include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <doctest/doctest.h>
 
@@ -96,4 +102,81 @@ namespace mamba
         }
     }
 #endif
+
+    TEST_SUITE("thread_utils")
+    {
+        TEST_CASE("local_threads_count")
+        {
+            auto params = Context::ThreadsParams();
+            params.extract_threads = 3;
+            CHECK_EQ(local_threads_count(params), 3);
+            params.extract_threads = 0;
+            CHECK_GE(local_threads_count(params), 1);
+            params.extract_threads = -100000;
+            CHECK_EQ(local_threads_count(params), 1);
+        }
+
+        TEST_CASE("parallel_for_each")
+        {
+            const std::size_t max_threads = 4;
+
+            SUBCASE("Each index once")
+            {
+                auto visits = std::vector<std::atomic<int>>(1000);
+                auto mutex = std::mutex();
+                auto thread_ids = std::set<std::thread::id>();
+                parallel_for_each(
+                    max_threads,
+                    visits.size(),
+                    [&](std::size_t i)
+                    {
+                        ++visits[i];
+                        std::lock_guard<std::mutex> lock(mutex);
+                        thread_ids.insert(std::this_thread::get_id());
+                    }
+                );
+                for (const auto& v : visits)
+                {
+                    CHECK_EQ(v.load(), 1);
+                }
+                CHECK_LE(thread_ids.size(), 4);
+            }
+
+            SUBCASE("Small workloads run on the calling thread")
+            {
+                auto thread_ids = std::set<std::thread::id>();
+                parallel_for_each(
+                    max_threads,
+                    10,
+                    [&](std::size_t) { thread_ids.insert(std::this_thread::get_id()); },
+                    /* min_items_per_thread= */ 16
+                );
+                CHECK_EQ(thread_ids, std::set{ std::this_thread::get_id() });
+            }
+
+            SUBCASE("First error is rethrown after all items")
+            {
+                auto count = std::atomic<std::size_t>{ 0 };
+                const auto func = [&](std::size_t i)
+                {
+                    ++count;
+                    if (i % 10 == 3)
+                    {
+                        throw std::runtime_error(std::to_string(i));
+                    }
+                };
+                auto error = std::string();
+                try
+                {
+                    parallel_for_each(max_threads, 100, func);
+                }
+                catch (const std::runtime_error& e)
+                {
+                    error = e.what();
+                }
+                CHECK_EQ(error, "3");
+                CHECK_EQ(count.load(), 100);
+            }
+        }
+    }
 }  // namespace mamba
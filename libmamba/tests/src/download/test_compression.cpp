@@ -0,0 +1,146 @@
+// Copyright (c) 2023, QuantStack and Mamba Contributors
+//
+// Distributed under the terms of the BSD 3-Clause License.
+//
+// The full license is in the file LICENSE, distributed with this software.
+
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "download/compression.hpp"
+
+namespace mamba
+{
+    namespace
+    {
+        std::string make_payload()
+        {
+            std::string payload;
+            for (int i = 0; i < 20000; ++i)
+            {
+                payload += "{\"name\": \"pkg-" + std::to_string(i % 10) + "\"}\n";
+            }
+            return payload;
+        }
+
+        // make_payload() compressed with zstd
+        const std::vector<unsigned char> zstd_payload = {
+            0x28, 0xb5, 0x2f, 0xfd, 0xa0, 0x40, 0x7e, 0x05, 0x00, 0xa4, 0x01, 0x00,
+            0xd8, 0x7b, 0x22, 0x6e, 0x61, 0x6d, 0x65, 0x22, 0x3a, 0x20, 0x22, 0x70,
+            0x6b, 0x67, 0x2d, 0x30, 0x22, 0x7d, 0x0a, 0x31, 0x32, 0x33, 0x34, 0x35,
+            0x36, 0x37, 0x38, 0x39, 0x0b, 0xa0, 0x40, 0x78, 0xff, 0x1e, 0xb0, 0x23,
+            0xeb, 0x49, 0xff, 0xb7, 0x1c, 0x38, 0xcf, 0x66, 0xf3, 0x6c, 0x3e, 0x63,
+            0x2e, 0x25, 0xb7, 0x14, 0x4c, 0x00, 0x00, 0x00, 0x01, 0x00, 0xfd, 0xff,
+            0xb7, 0xdc, 0x00, 0x01, 0x45, 0x00, 0x00, 0x00, 0x01, 0x00, 0x3d, 0x7e,
+            0x39, 0x00, 0x02,
+        };
+
+        // make_payload() compressed with bzip2
+        const std::vector<unsigned char> bzip2_payload = {
+            0x42, 0x5a, 0x68, 0x39, 0x31, 0x41, 0x59, 0x26, 0x53, 0x59, 0x14, 0xdc,
+            0x45, 0x7b, 0x02, 0x74, 0xe7, 0xd9, 0x80, 0x00, 0x10, 0x50, 0x02, 0x7f,
+            0xf0, 0x22, 0x8b, 0x40, 0x0a, 0x30, 0x01, 0x18, 0x01, 0x41, 0xa3, 0x46,
+            0x83, 0x20, 0x34, 0x28, 0x34, 0x68, 0xd0, 0x64, 0x06, 0x81, 0x4a, 0xa8,
+            0x34, 0x00, 0xd3, 0x21, 0xb5, 0x30, 0x08, 0x54, 0x66, 0x08, 0x54, 0x68,
+            0x08, 0x54, 0x60, 0x10, 0xa8, 0xc8, 0x10, 0xa8, 0xd0, 0x25, 0x57, 0x50,
+            0x95, 0x5d, 0x82, 0x55, 0x77, 0x09, 0x55, 0xe0, 0x25, 0x57, 0x90, 0x95,
+            0x5e, 0x82, 0x55, 0x66, 0x12, 0xab, 0xd8, 0x4a, 0xad, 0x02, 0x55, 0x7c,
+            0x04, 0x2a, 0x35, 0x04, 0x2a, 0x35, 0x04, 0x2a, 0x36, 0x04, 0x2a, 0x36,
+            0x04, 0x2a, 0x36, 0x04, 0x2a, 0x30, 0x08, 0x54, 0x60, 0x10, 0xa8, 0xc8,
+            0x08, 0x54, 0x60, 0x10, 0xa8, 0xdc, 0x08, 0x54, 0x7f, 0x17, 0x72, 0x45,
+            0x38, 0x50, 0x90, 0x14, 0xdc, 0x45, 0x7b,
+        };
+
+        std::vector<std::pair<std::string, std::vector<unsigned char>>> compressed_payloads()
+        {
+            return {
+                { "https://repo.mamba.pm/conda-forge/repodata.json.zst", zstd_payload },
+                { "https://repo.mamba.pm/conda-forge/repodata.json.bz2", bzip2_payload },
+            };
+        }
+
+        // Feeds the compressed data in small chunks, as curl would
+        bool write_chunks(download::CompressionStream& stream, std::vector<unsigned char> data)
+        {
+            constexpr std::size_t chunk_size = 7;
+            for (std::size_t pos = 0; pos < data.size(); pos += chunk_size)
+            {
+                const std::size_t size = std::min(chunk_size, data.size() - pos);
+                if (stream.write(reinterpret_cast<char*>(data.data() + pos), size) != size)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    TEST_SUITE("download::compression")
+    {
+        TEST_CASE("decompress_to_writer")
+        {
+            for (const auto& [url, data] : compressed_payloads())
+            {
+                CAPTURE(url);
+                std::string out;
+                auto stream = download::make_compression_stream(
+                    url,
+                    false,
+                    [&out](char* in, std::size_t size)
+                    {
+                        out.append(in, size);
+                        return size;
+                    }
+                );
+                CHECK(write_chunks(*stream, data));
+                CHECK_EQ(out, make_payload());
+            }
+        }
+
+        TEST_CASE("decompress_to_buffer")
+        {
+            for (const auto& [url, data] : compressed_payloads())
+            {
+                CAPTURE(url);
+                std::string out;
+                auto stream = download::make_compression_stream(url, false, out);
+                stream->reserve_output(data.size());
+                CHECK_GE(out.capacity(), data.size());
+                CHECK(write_chunks(*stream, data));
+                stream->finish_output();
+                CHECK_EQ(out, make_payload());
+            }
+        }
+
+        TEST_CASE("no_compression_to_buffer")
+        {
+            const std::string payload = make_payload();
+            std::string out;
+            auto stream = download::make_compression_stream(
+                "https://repo.mamba.pm/conda-forge/repodata.json",
+                false,
+                out
+            );
+            stream->reserve_output(payload.size());
+            CHECK(write_chunks(*stream, { payload.begin(), payload.end() }));
+            stream->finish_output();
+            CHECK_EQ(out, payload);
+        }
+
+        TEST_CASE("corrupted_data")
+        {
+            std::vector<unsigned char> data = zstd_payload;
+            data[4] = 0xff;
+            data[5] = 0xff;
+            std::string out;
+            auto stream = download::make_compression_stream(
+                "https://repo.mamba.pm/conda-forge/repodata.json.zst",
+                false,
+                out
+            );
+            CHECK_FALSE(write_chunks(*stream, data));
+        }
+    }
+}
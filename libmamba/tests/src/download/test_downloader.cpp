@@ -8,6 +8,9 @@
 
 #include "mamba/download/downloader.hpp"
 
+#include "download/curl.hpp"
+#include "download/downloader_impl.hpp"
+
 #include "mambatests.hpp"
 
 namespace mamba
@@ -51,5 +54,111 @@ namespace mamba
             context.output_params.quiet = true;
             CHECK_THROWS_AS(download::download(dl_request, context.mirrors, context), std::runtime_error);
         }
+
+        TEST_CASE("connection_pool_reuses_handles")
+        {
+            auto pool = download::CURLConnectionPool();
+
+            download::CURLHandle handle = pool.acquire_handle();
+            const download::CURLId id = handle.get_id();
+            pool.release_handle(std::move(handle));
+            download::CURLHandle reused = pool.acquire_handle();
+            CHECK_EQ(reused.get_id(), id);
+            pool.release_handle(std::move(reused));
+        }
+
+        TEST_CASE("file_does_not_exist_twice")
+        {
+            // The second download reuses the pooled handles left by the first one
+            auto& context = mambatests::singletons().context;
+            const auto previous_quiet = context.output_params.quiet;
+            auto _ = on_scope_exit([&] { context.output_params.quiet = previous_quiet; });
+            context.output_params.quiet = true;
+
+            for (int i = 0; i < 2; ++i)
+            {
+                download::Request request(
+                    "test",
+                    download::MirrorName(""),
+                    "file:///nonexistent/repodata.json",
+                    "test_download_repodata.json",
+                    false,
+                    true
+                );
+                download::Result res = download::download(std::move(request), context.mirrors, context);
+                CHECK(!res);
+            }
+        }
+
+        TEST_CASE("token_bucket")
+        {
+            using namespace std::chrono_literals;
+            const auto start = download::TokenBucket::clock::now();
+
+            SUBCASE("Unlimited")
+            {
+                auto bucket = download::TokenBucket(0, start);
+                CHECK_FALSE(bucket.is_limited());
+                bucket.consume(1'000'000);
+                CHECK(bucket.has_tokens(start));
+            }
+
+            SUBCASE("Limited")
+            {
+                auto bucket = download::TokenBucket(1000, start);
+                CHECK(bucket.is_limited());
+                CHECK(bucket.has_tokens(start));
+                // A chunk larger than the remaining tokens is still accepted
+                bucket.consume(1500);
+                CHECK_FALSE(bucket.has_tokens(start));
+                CHECK_FALSE(bucket.has_tokens(start + 400ms));
+                CHECK(bucket.has_tokens(start + 600ms));
+            }
+
+            SUBCASE("Capped to one second of tokens")
+            {
+                auto bucket = download::TokenBucket(1000, start);
+                CHECK(bucket.has_tokens(start + 10s));
+                bucket.consume(1001);
+                CHECK_FALSE(bucket.has_tokens(start + 10s));
+            }
+        }
+
+        TEST_CASE("download_budget_host_connections")
+        {
+            auto budget = download::DownloadBudget({ /* .max_host_connections = */ 2 });
+
+            CHECK(budget.can_start_transfer("conda.anaconda.org"));
+            budget.start_transfer("conda.anaconda.org");
+            budget.start_transfer("conda.anaconda.org");
+            CHECK_FALSE(budget.can_start_transfer("conda.anaconda.org"));
+            CHECK(budget.can_start_transfer("repo.anaconda.com"));
+            // Local files are never limited
+            budget.start_transfer("");
+            budget.start_transfer("");
+            CHECK(budget.can_start_transfer(""));
+
+            download::CURLHandle handle;
+            budget.finish_transfer("conda.anaconda.org", handle);
+            CHECK(budget.can_start_transfer("conda.anaconda.org"));
+        }
+
+        TEST_CASE("download_budget_bandwidth")
+        {
+            auto budget = download::DownloadBudget({ 0, /* .max_download_speed = */ 1'000'000 });
+            download::CURLHandle handle;
+
+            budget.start_transfer("conda.anaconda.org");
+            CHECK(budget.try_receive("conda.anaconda.org", handle, 2'000'000));
+            // The global budget is exhausted for about one second
+            CHECK_FALSE(budget.try_receive("repo.anaconda.com", handle, 1));
+            CHECK(budget.has_paused_transfers());
+            CHECK_FALSE(budget.can_start_transfer("repo.anaconda.com"));
+            // Local files are never limited
+            CHECK(budget.try_receive("", handle, 1));
+
+            budget.finish_transfer("repo.anaconda.com", handle);
+            CHECK_FALSE(budget.has_paused_transfers());
+        }
     }
 }
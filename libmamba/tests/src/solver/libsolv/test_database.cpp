@@ -6,8 +6,11 @@
 
 #include <array>
 #include <functional>
+#include <string_view>
+#include <vector>
 
 #include <doctest/doctest.h>
+#include <fmt/format.h>
 
 #include "mamba/core/util.hpp"
 #include "mamba/solver/libsolv/database.hpp"
@@ -173,6 +176,71 @@ TEST_SUITE("solver::libsolv::database")
                     );
                     CHECK_EQ(count, 1);
                 }
+
+                SUBCASE("As package views")
+                {
+                    std::size_t count = 0;
+                    db.for_each_package_matching(
+                        specs::MatchSpec::parse("z").value(),
+                        [&](const libsolv::PackageView& p)
+                        {
+                            count++;
+                            CHECK_EQ(p.name(), "z");
+                            const auto pkg = p.to_package_info();
+                            CHECK_EQ(pkg.name, p.name());
+                            CHECK_EQ(pkg.version, p.version());
+                            CHECK_EQ(pkg.dependencies, p.dependencies());
+                            if (p.version() == "1.0")
+                            {
+                                CHECK(util::any_starts_with(p.dependencies(), "x"));
+                                return util::LoopControl::Break;
+                            }
+                            return util::LoopControl::Continue;
+                        }
+                    );
+                    CHECK_GE(count, 1);
+                    CHECK_LE(count, 2);
+                }
+
+                SUBCASE("As a package table")
+                {
+                    const auto table = db.package_table();
+                    REQUIRE_EQ(table.package_count(), 4);
+                    CHECK_EQ(table.version.size(), 4);
+                    CHECK_EQ(table.dependencies.size(), 4);
+
+                    // Packages are exported in the order of their repositories
+                    auto row = std::size_t(0);
+                    const auto check_row = [&](const libsolv::PackageView& p)
+                    {
+                        REQUIRE_LT(row, table.package_count());
+                        CHECK_EQ(table.name[row], p.name());
+                        CHECK_EQ(table.version[row], p.version());
+                        CHECK_EQ(table.build_string[row], p.build_string());
+                        CHECK_EQ(table.build_number[row], p.build_number());
+                        CHECK_EQ(table.channel[row], p.channel());
+                        const auto deps = table.dependencies[row];
+                        const auto deps_str = std::vector<std::string>(deps.cbegin(), deps.cend());
+                        CHECK_EQ(deps_str, p.dependencies());
+                        row++;
+                    };
+                    db.for_each_package_in_repo(repo1, check_row);
+                    db.for_each_package_in_repo(repo2, check_row);
+                    CHECK_EQ(row, 4);
+
+                    const auto& deps = table.dependencies;
+                    CHECK_EQ(deps.offsets().back(), deps.values().size());
+                    REQUIRE_EQ(deps.values().size(), 1);
+                    CHECK(util::starts_with(deps.values()[0], "x"));
+
+                    const auto repo2_table = db.package_table_in_repo(repo2);
+                    REQUIRE_EQ(repo2_table.package_count(), 1);
+                    CHECK_EQ(repo2_table.name[0], "z");
+                    CHECK_EQ(repo2_table.version[0], "2.0");
+                    CHECK(repo2_table.dependencies[0].empty());
+                    CHECK_EQ(repo2_table.name.data(), "z");
+                    CHECK_EQ(repo2_table.name.offsets(), std::vector<std::int64_t>{ 0, 1 });
+                }
             }
         }
 
@@ -502,4 +570,66 @@ TEST_SUITE("solver::libsolv::database")
             );
         }
     }
+
+    TEST_CASE("Match versions among many packages")
+    {
+        auto db = libsolv::Database({});
+
+        auto pkgs = std::vector<PackageInfo>();
+        for (std::size_t minor = 0; minor < 20; ++minor)
+        {
+            for (std::size_t patch = 0; patch < 5; ++patch)
+            {
+                pkgs.push_back(mkpkg("x", fmt::format("1.{}.{}", minor, patch)));
+            }
+        }
+        pkgs.push_back(mkpkg("x", "not a version"));
+        pkgs.push_back(mkpkg("y", "1.2.0"));
+        db.add_repo_from_packages(pkgs, "repo1");
+
+        const auto count_matching = [&](std::string_view str)
+        {
+            auto ms = specs::MatchSpec::parse(str).value();
+            // Not a simple spec, so that it is matched by mamba rather than natively by libsolv
+            ms.set_build_number(specs::BuildNumberSpec::parse(">=0").value());
+            std::size_t count = 0;
+            db.for_each_package_matching(
+                ms,
+                [&](const PackageInfo& pkg)
+                {
+                    // Packages with an invalid version only match a spec without version
+                    if (const auto version = specs::Version::parse(pkg.version))
+                    {
+                        CHECK(ms.version().contains(version.value()));
+                    }
+                    else
+                    {
+                        CHECK(ms.version().is_explicitly_free());
+                    }
+                    ++count;
+                }
+            );
+            return count;
+        };
+
+        CHECK_EQ(count_matching("x"), 100);
+        CHECK_EQ(count_matching("x==1.2.0"), 1);
+        CHECK_EQ(count_matching("x>=1.2,<1.4"), 10);
+        CHECK_EQ(count_matching("x=1.2"), 5);
+        CHECK_EQ(count_matching("x=1.18,>=1.18.3"), 2);
+        CHECK_EQ(count_matching("x!=1.3.*"), 95);
+        CHECK_EQ(count_matching("x<1.1|>=1.19.4"), 6);
+        CHECK_EQ(count_matching("x>=2.0"), 0);
+
+        // The index of versions is refreshed when packages are added or removed
+        auto repo2 = db.add_repo_from_packages(
+            std::array{ mkpkg("x", "1.2.5"), mkpkg("x", "2.0") },
+            "repo2"
+        );
+        CHECK_EQ(count_matching("x=1.2"), 6);
+        CHECK_EQ(count_matching("x>=2.0"), 1);
+        db.remove_repo(repo2);
+        CHECK_EQ(count_matching("x=1.2"), 5);
+        CHECK_EQ(count_matching("x>=2.0"), 0);
+    }
 }
@@ -762,4 +762,105 @@ TEST_CASE("Create problem graph")
     }
 }
 
+TEST_CASE("Compress graph with default merge criteria")
+{
+    using PbGr = ProblemsGraph;
+    using CpPbGr = CompressedProblemsGraph;
+
+    // The default criteria, evaluated on every pair of nodes
+    auto pairwise_criteria = [](const PbGr& pbs, PbGr::node_id n1, PbGr::node_id n2) -> bool
+    {
+        const auto& g = pbs.graph();
+        auto name = [&g](PbGr::node_id n) -> std::string
+        {
+            return std::visit(
+                [](const auto& node) -> std::string
+                {
+                    using Node = std::decay_t<decltype(node)>;
+                    if constexpr (std::is_same_v<Node, PbGr::RootNode>)
+                    {
+                        return "";
+                    }
+                    else if constexpr (std::is_same_v<Node, PbGr::PackageNode>)
+                    {
+                        return node.name;
+                    }
+                    else
+                    {
+                        return node.name().str();
+                    }
+                },
+                g.node(n)
+            );
+        };
+        auto is_leaf = [&g](PbGr::node_id n) { return g.successors(n).size() == 0; };
+        auto leaves_from = [&g](PbGr::node_id n)
+        {
+            auto leaves = std::vector<PbGr::node_id>();
+            g.for_each_leaf_id_from(n, [&leaves](PbGr::node_id m) { leaves.push_back(m); });
+            return util::flat_set(std::move(leaves));
+        };
+        return (name(n1) == name(n2)) && !(pbs.conflicts().in_conflict(n1, n2))
+               && ((is_leaf(n1) && is_leaf(n2)) || (leaves_from(n1) == leaves_from(n2)))
+               && ((!is_leaf(n1) && !is_leaf(n2)) || (g.predecessors(n1) == g.predecessors(n2)));
+    };
+
+    const auto issues = std::array{
+        std::pair{ "Basic conflict", &create_basic_conflict },
+        std::pair{ "PubGrub example", &create_pubgrub },
+        std::pair{ "Harder PubGrub example", &create_pubgrub_hard },
+        std::pair{ "PubGrub example with missing packages", &create_pubgrub_missing },
+        std::pair{ "Pin conflict", &create_pin_conflict },
+    };
+
+    for (const auto& [name, factory] : issues)
+    {
+        auto& ctx = mambatests::context();
+        auto channel_context = ChannelContext::make_conda_compatible(ctx);
+
+        std::string_view name_copy = name;
+        CAPTURE(name_copy);
+        auto [db, request] = factory(ctx, channel_context);
+        auto outcome = solver::libsolv::Solver().solve(db, request).value();
+        auto& unsolvable = std::get<solver::libsolv::UnSolvable>(outcome);
+
+        for (const auto& pbs : { unsolvable.problems_graph(db),
+                                 simplify_conflicts(unsolvable.problems_graph(db)) })
+        {
+            const auto expected = CpPbGr::from_problems_graph(pbs, pairwise_criteria);
+            const auto actual = CpPbGr::from_problems_graph(pbs);
+
+            REQUIRE_EQ(actual.graph().number_of_nodes(), expected.graph().number_of_nodes());
+            CHECK_EQ(actual.graph().number_of_edges(), expected.graph().number_of_edges());
+            CHECK_EQ(actual.root_node(), expected.root_node());
+            expected.graph().for_each_node_id(
+                [&](CpPbGr::node_id id)
+                {
+                    const auto& node_expected = expected.graph().node(id);
+                    const auto& node_actual = actual.graph().node(id);
+                    REQUIRE_EQ(node_actual.index(), node_expected.index());
+                    std::visit(
+                        [&](const auto& n)
+                        {
+                            using Node = std::decay_t<decltype(n)>;
+                            if constexpr (!std::is_same_v<Node, CpPbGr::RootNode>)
+                            {
+                                const auto& m = std::get<Node>(node_actual);
+                                CHECK_EQ(m.name(), n.name());
+                                CHECK_EQ(m.size(), n.size());
+                            }
+                        },
+                        node_expected
+                    );
+                }
+            );
+            expected.graph().for_each_edge_id(
+                [&](CpPbGr::node_id from, CpPbGr::node_id to)
+                { CHECK(actual.graph().has_edge(from, to)); }
+            );
+            CHECK_EQ(problem_tree_msg(actual), problem_tree_msg(expected));
+        }
+    }
+}
+
 TEST_SUITE_END();
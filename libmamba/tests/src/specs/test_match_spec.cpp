@@ -4,6 +4,11 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <array>
+#include <random>
+#include <string>
+#include <string_view>
+
 #include <doctest/doctest.h>
 
 #include "mamba/specs/match_spec.hpp"
@@ -839,4 +844,99 @@ TEST_SUITE("specs::match_spec")
         CHECK_EQ(spec1_hash, spec2_hash);
         CHECK_NE(spec1_hash, spec3_hash);
     }
+
+    TEST_CASE("parse fast path regression")
+    {
+        // Specs with a leading ``:`` (empty namespace) go through the full parser, while the
+        // same spec without it goes through the fast path.
+        // Version specs between parentheses similarly go through the infix parser.
+        static constexpr auto names = std::array{
+            "python", "numpy", "libgcc-ng", "_openmp", "r-base",
+        };
+        static constexpr auto versions = std::array{
+            "1", "1.2", "3.11.4", "1.2.*", "1.2*", "2.0a1", "1!2.3", "1.0+local", "2019.2", "*",
+        };
+        static constexpr auto ops = std::array{ "", "=", "==", "!=", ">", ">=", "<", "<=", "~=" };
+        static constexpr auto builds = std::array{ "py311_0", "h1234567_0", "*mkl*", "py*", "0" };
+        static constexpr auto seps = std::array{ " ", "", "=", " =", "  " };
+        static constexpr auto noise = std::string_view("abz019._-+*!=<>~,| ");
+
+        auto gen = std::mt19937(4321);
+        const auto pick = [&](const auto& arr) -> std::string
+        { return std::string(arr[gen() % arr.size()]); };
+
+        const auto make_version_spec = [&]()
+        {
+            auto out = pick(ops) + pick(versions);
+            for (auto n = gen() % 3; n > 0; --n)
+            {
+                out += ((gen() % 4) == 0) ? "|" : ",";
+                out += pick(ops) + pick(versions);
+            }
+            return out;
+        };
+
+        for (std::size_t i = 0; i < 3000; ++i)
+        {
+            auto spec = pick(names);
+            switch (gen() % 5)
+            {
+                case 0:
+                    break;
+                case 1:
+                    spec += pick(seps) + make_version_spec();
+                    break;
+                case 2:
+                    spec += pick(seps) + make_version_spec() + " " + pick(builds);
+                    break;
+                case 3:
+                    spec += "=" + pick(versions) + "=" + pick(builds);
+                    break;
+                default:
+                    for (auto n = gen() % 12; n > 0; --n)
+                    {
+                        spec += noise[gen() % noise.size()];
+                    }
+            }
+            CAPTURE(spec);
+
+            const auto fast = MatchSpec::parse(spec);
+            const auto full = MatchSpec::parse(":" + spec);
+            REQUIRE_EQ(fast.has_value(), full.has_value());
+            if (fast.has_value())
+            {
+                CHECK_EQ(fast.value(), full.value());
+                CHECK_EQ(fast->str(), full->str());
+            }
+
+            const auto ver = make_version_spec();
+            CAPTURE(ver);
+            const auto ver_fast = VersionSpec::parse(ver);
+            const auto ver_full = VersionSpec::parse("(" + ver + ")");
+            REQUIRE_EQ(ver_fast.has_value(), ver_full.has_value());
+            if (ver_fast.has_value())
+            {
+                // Free specs are short-circuited to an empty tree, unlike parenthesized ones
+                if (!ver_fast->is_explicitly_free())
+                {
+                    CHECK_EQ(ver_fast.value(), ver_full.value());
+                }
+                CHECK_EQ(ver_fast->str(), ver_full->str());
+            }
+        }
+    }
+
+    TEST_CASE("parse_cached")
+    {
+        const auto ms1 = MatchSpec::parse_cached("numpy >=1.20,<2 py*").value();
+        const auto ms2 = MatchSpec::parse_cached("numpy >=1.20,<2 py*").value();
+        CHECK_EQ(ms1.get(), ms2.get());
+        CHECK_EQ(*ms1, MatchSpec::parse("numpy >=1.20,<2 py*").value());
+
+        const auto ms3 = MatchSpec::parse_cached("conda-forge::numpy[version='>=1.20']").value();
+        CHECK_NE(ms1.get(), ms3.get());
+        CHECK_EQ(ms3->channel().value().str(), "conda-forge");
+
+        CHECK_FALSE(MatchSpec::parse_cached("numpy >=1.20,<2[").has_value());
+    }
 }
@@ -4,10 +4,16 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <array>
+#include <regex>
+#include <string>
+
 #include <doctest/doctest.h>
 
 #include "mamba/specs/regex_spec.hpp"
 
+#include "specs/regex_program.hpp"
+
 using namespace mamba::specs;
 
 TEST_SUITE("specs::regex_spec")
@@ -80,4 +86,63 @@ TEST_SUITE("specs::regex_spec")
         CHECK_EQ(hash_fn(spec1), hash_fn(spec2));
         CHECK_NE(hash_fn(spec1), hash_fn(spec3));
     }
+
+    TEST_CASE("Same matches as std::regex")
+    {
+        static constexpr auto patterns = std::array{
+            "",
+            "mkl",
+            ".*",
+            "py.*",
+            "py3[0-9]+_.*",
+            "^py3[0-9]+_.*",
+            "^.*(accelerate|mkl)$",
+            ".*cuda.*",
+            "cuda11.8*",
+            "h[a-f0-9]+_\\d+",
+            "[^_]*_[0-9]",
+            "(a|ab)(c|bcd)(d*)",
+            "(a*)*b",
+            "(a|)+",
+            "(?:py|pypy)3\\d?_\\w+?",
+            "a?b?c?",
+            "[-a]+|[a-]+",
+            "\\.\\*\\$",
+            "\\S+\\s\\D\\W",
+            "a|^b|c$",
+            "x^|$y",
+        };
+        static constexpr auto inputs = std::array{
+            "",        "mkl",        "nomkl",  "py",           "python",     "py310_0",
+            "py3_0",   "py37h1234_0", "cuda",  "cuda11.8",     "cuda11x888", "h1234abc_12",
+            "abcd",    "abd",         "abcdd", "aaaab",        "b",          "ab",
+            "_0",      "pypy39_pp73", "py3_",  "accelerate",   "xmkl",       "a-a",
+            ".*$",     "a b",         "a b-",  "a\nb",        "c",          "abc",
+        };
+
+        for (const auto* pattern : patterns)
+        {
+            CAPTURE(pattern);
+            const auto spec = RegexSpec::parse(pattern).value();
+            const auto regex = std::regex(pattern);
+            REQUIRE(RegexProgram::compile(spec.str()).has_value());
+            for (const auto* input : inputs)
+            {
+                CAPTURE(input);
+                CHECK_EQ(spec.contains(input), std::regex_match(input, regex));
+            }
+        }
+    }
+
+    TEST_CASE("Unsupported constructs")
+    {
+        for (const auto* pattern : { "a{2,3}", "(a)\\1", "\\bpy", "(?=a)a", "[[:alpha:]]+" })
+        {
+            CAPTURE(pattern);
+            CHECK_FALSE(RegexProgram::compile(pattern).has_value());
+            // Still handled through std::regex
+            const auto spec = RegexSpec::parse(pattern).value();
+            CHECK_EQ(spec.contains("aa"), std::regex_match("aa", std::regex(pattern)));
+        }
+    }
 }
@@ -97,6 +97,47 @@ TEST_SUITE("specs::version")
         CHECK_GE(Version(0, { { { 11 }, { 0 }, { 0, "post" } } }), Version(0, { { { 2 }, { 0 } } }));
     }
 
+    TEST_CASE("sort_key")
+    {
+        // Equivalent versions have the same key
+        CHECK_EQ(Version().sort_key(), Version(0, { { { 0 } } }).sort_key());
+        CHECK_EQ(
+            Version(0, { { { 1, "a" } } }).sort_key(),
+            Version(0, { { { 1, "a" }, {} }, { {} } }).sort_key()
+        );
+        CHECK_NE(Version(0, { { { 1 } } }).sort_key(), Version(1, { { { 1 } } }).sort_key());
+
+        // clang-format off
+        // Empty atoms and parts in the middle compare depending on what comes next
+        auto const sorted = std::vector<Version>{
+            Version(0, {{{1}}, {{0, "a"}}}),
+            Version(0, {{{1}}, {{0}, {0, "dev"}}}),
+            Version(0, {{{1}}, {{0}}, {{0, "dev"}}}),
+            Version(0, {{{1}}}),
+            Version(0, {{{1}}}, {{{0}}, {{1}}}),
+            Version(0, {{{1}}, {{0}}, {{1, "dev"}}}),
+            Version(0, {{{1}}, {{0}, {0, "post"}}}),
+            Version(0, {{{1}}, {{0}, {1}}}),
+            Version(0, {{{1}}, {{0, "post"}}}),
+            Version(0, {{{1}}, {{1, "dev"}}}),
+            Version(0, {{{1}}, {{255}}}),
+            Version(0, {{{1}}, {{256}}}),
+            Version(0, {{{2}}}),
+            Version(1, {{{0}}}),
+        };
+        // clang-format on
+        for (std::size_t i = 0; i < sorted.size(); ++i)
+        {
+            for (std::size_t j = 0; j < sorted.size(); ++j)
+            {
+                CAPTURE(sorted[i].str());
+                CAPTURE(sorted[j].str());
+                CHECK_EQ(sorted[i] < sorted[j], i < j);
+                CHECK_EQ(sorted[i] == sorted[j], i == j);
+            }
+        }
+    }
+
     TEST_CASE("starts_with")
     {
         SUBCASE("positive")
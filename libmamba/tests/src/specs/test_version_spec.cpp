@@ -4,13 +4,18 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <algorithm>
 #include <array>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include <doctest/doctest.h>
 
 #include "mamba/specs/version_spec.hpp"
 
+#include "doctest-printer/vector.hpp"
+
 using namespace mamba::specs;
 
 TEST_SUITE("specs::version_spec")
@@ -459,4 +464,146 @@ TEST_SUITE("specs::version_spec")
         CHECK_EQ(hash_fn(spec1), hash_fn(spec2));
         CHECK_NE(hash_fn(spec1), hash_fn(spec3));
     }
+
+    TEST_CASE("VersionIntervalSet")
+    {
+        const auto v1 = "1.0"_v;
+        const auto v2 = "2.0"_v;
+        const auto v3 = "3.0"_v;
+
+        CHECK(VersionIntervalSet().is_free());
+        CHECK(VersionIntervalSet::make_free().contains(v1));
+        CHECK(VersionIntervalSet::make_empty().is_empty());
+        CHECK_FALSE(VersionIntervalSet::make_empty().contains(v1));
+
+        const auto eq = VersionIntervalSet::make_equal_to(v2);
+        CHECK_FALSE(eq.contains(v1));
+        CHECK(eq.contains(v2));
+        CHECK(eq.contains("2"_v));
+        CHECK_FALSE(eq.contains("2.0.1"_v));
+        CHECK_FALSE(eq.contains(v3));
+        CHECK_EQ(eq.complement(), VersionIntervalSet::make_not_equal_to(v2));
+        CHECK_EQ(eq.complement().complement(), eq);
+
+        const auto range = VersionIntervalSet::make_greater_equal(v1).intersection(
+            VersionIntervalSet::make_less(v3)
+        );
+        CHECK_EQ(range.intervals().size(), 1);
+        CHECK(range.contains(v1));
+        CHECK(range.contains(v2));
+        CHECK_FALSE(range.contains(v3));
+        CHECK(range.intersection(VersionIntervalSet::make_greater(v3)).is_empty());
+
+        // Adjacent intervals are merged
+        const auto merged = VersionIntervalSet::make_less(v2).union_with(
+            VersionIntervalSet::make_greater_equal(v2)
+        );
+        CHECK(merged.is_free());
+        CHECK_EQ(
+            VersionIntervalSet::make_less(v2).union_with(eq),
+            VersionIntervalSet::make_less_equal(v2)
+        );
+
+        auto approx = VersionIntervalSet::make_less(v2);
+        approx.set_exact(false);
+        CHECK_FALSE(approx.union_with(eq).is_exact());
+        CHECK_FALSE(approx.intersection(eq).is_exact());
+        CHECK(approx.complement().is_free());
+        CHECK_FALSE(approx.complement().is_exact());
+    }
+
+    TEST_CASE("VersionSpec::to_interval_set")
+    {
+        static constexpr auto versions_str = std::array{
+            "0",       "0.1",     "0.9a1",  "1!0.5",  "1.0a",    "1.0.dev", "1",
+            "1.0",     "1.0.0",   "1.0.1",  "1.0post", "1.1a1",  "1.1",     "1.1.0.1",
+            "1.1_1",   "1.1.1",   "1.1.1g", "1.2",     "1.2.0",  "1.2a",    "1a.2",
+            "1.2.3",   "1.3",    "1.10",    "1.11.1", "2.0a",    "2.0.dev1",
+            "2",       "2.0",     "2.0+1",  "2.0.1",   "2.1",    "2.11",    "3.0",
+            "3.9.18",  "3.10",    "3.10.1", "3.11",    "3.11.4", "3.12.0",  "10.0",
+            "2019.2",  "1!1.0",   "1!2.3",  "2!1.0",
+        };
+
+        auto versions = std::vector<Version>();
+        for (auto str : versions_str)
+        {
+            versions.push_back(Version::parse(str).value());
+        }
+        std::sort(versions.begin(), versions.end());
+
+        static constexpr auto specs_str = std::array{
+            "*",
+            "==1.0",
+            "!=1.0",
+            ">1.1",
+            ">=1.1",
+            "<2.0",
+            "<=2.0",
+            ">=1.0,<2.0",
+            "<1.0|>=2.0",
+            "(>=1.0,<1.1)|(>2.0,<=3.10)",
+            ">=1.0,<1.1,!=1.0.1",
+            "1.*",
+            "1.1.*",
+            "=1.2",
+            "=2",
+            "=0",
+            "!=1.1.*",
+            "~=1.1",
+            "~=1.1.0",
+            "~=2.0",
+            "~=3.10.1",
+            ">=1.1,!=1.1.*",
+            "1.2.*|>=3.0",
+            "1!1.*",
+            "1.1.*,<1.1.1",
+            "3.11.*|3.12.*",
+        };
+
+        for (auto str : specs_str)
+        {
+            CAPTURE(str);
+            const auto spec = VersionSpec::parse(str).value();
+            const auto set = spec.to_interval_set();
+
+            auto expected = std::vector<std::string>();
+            for (const auto& ver : versions)
+            {
+                CAPTURE(ver.str());
+                if (set.is_exact())
+                {
+                    CHECK_EQ(set.contains(ver), spec.contains(ver));
+                }
+                else if (spec.contains(ver))
+                {
+                    CHECK(set.contains(ver));
+                }
+                if (spec.contains(ver))
+                {
+                    expected.push_back(ver.str());
+                }
+            }
+
+            auto contained = std::vector<std::string>();
+            spec.for_each_contained(
+                versions.cbegin(),
+                versions.cend(),
+                [](const Version& ver) -> const Version& { return ver; },
+                [&](const Version& ver) { contained.push_back(ver.str()); }
+            );
+            CHECK_EQ(contained, expected);
+        }
+
+        CHECK(VersionSpec::parse(">=1.0,<2.0").value().to_interval_set().is_exact());
+        CHECK_FALSE(VersionSpec::parse("=1.2").value().to_interval_set().is_exact());
+        // The approximation still excludes versions with another leading atom
+        const auto starts = VersionSpec::parse("=1.2").value().to_interval_set();
+        CHECK_FALSE(starts.contains("2.0"_v));
+        CHECK_FALSE(starts.contains("0.9"_v));
+        CHECK_FALSE(starts.contains("1!1.2"_v));
+        const auto compatible = VersionSpec::parse("~=3.10.1").value().to_interval_set();
+        CHECK_FALSE(compatible.contains("3.11"_v));
+        CHECK_FALSE(compatible.contains("3.10.0"_v));
+        CHECK(compatible.contains("3.10.2"_v));
+    }
 }
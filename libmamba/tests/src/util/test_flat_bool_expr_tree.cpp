@@ -15,6 +15,7 @@
 #include "mamba/util/flat_bool_expr_tree.hpp"
 
 #include "doctest-printer/array.hpp"
+#include "doctest-printer/vector.hpp"
 
 using namespace mamba::util;
 
@@ -508,4 +509,55 @@ TEST_SUITE("util::flat_bool_expr_tree")
         // There could be many representations, here is one
         CHECK_EQ(result, "((x0 or x1) and ((x2 or (x3 or x4)) and x5)) or x6");
     }
+
+    TEST_CASE("Postfix traversal")
+    {
+        auto parser = InfixParser<std::size_t, BoolOperator>{};
+        // Infix:  ((x0 or x1) and (x2 or x3 or x4) and x5) or x6
+        CHECK(parser.push_left_parenthesis());
+        CHECK(parser.push_left_parenthesis());
+        CHECK(parser.push_variable(0));
+        CHECK(parser.push_operator(BoolOperator::logical_or));
+        CHECK(parser.push_variable(1));
+        CHECK(parser.push_right_parenthesis());
+        CHECK(parser.push_operator(BoolOperator::logical_and));
+        CHECK(parser.push_left_parenthesis());
+        CHECK(parser.push_variable(2));
+        CHECK(parser.push_operator(BoolOperator::logical_or));
+        CHECK(parser.push_variable(3));
+        CHECK(parser.push_operator(BoolOperator::logical_or));
+        CHECK(parser.push_variable(4));
+        CHECK(parser.push_right_parenthesis());
+        CHECK(parser.push_operator(BoolOperator::logical_and));
+        CHECK(parser.push_variable(5));
+        CHECK(parser.push_right_parenthesis());
+        CHECK(parser.push_operator(BoolOperator::logical_or));
+        CHECK(parser.push_variable(6));
+        CHECK(parser.finalize());
+        auto tree = flat_bool_expr_tree(std::move(parser).tree());
+
+        auto result = std::vector<std::string>();
+        tree.postfix_for_each(
+            [&](const auto& token)
+            {
+                using Token = std::decay_t<decltype(token)>;
+                if constexpr (std::is_same_v<Token, BoolOperator>)
+                {
+                    result.push_back((token == BoolOperator::logical_or) ? "or" : "and");
+                }
+                else
+                {
+                    result.push_back("x" + std::to_string(token));
+                }
+            }
+        );
+        CHECK_EQ(
+            result,
+            std::vector<std::string>{
+                "x0", "x1", "or", "x2", "x3", "x4", "or", "or", "x5", "and", "and", "x6", "or" }
+        );
+
+        auto empty = flat_bool_expr_tree<std::size_t>();
+        empty.postfix_for_each([&](const auto&) { CHECK(false); });
+    }
 }
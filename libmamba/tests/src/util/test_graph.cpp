@@ -509,4 +509,30 @@ TEST_SUITE("util::graph")
         CHECK(is_reachable(graph, 0, 6));
         CHECK_FALSE(is_reachable(graph, 6, 0));
     }
+
+    TEST_CASE("Deep graph")
+    {
+        // Deep enough to overflow the call stack with a recursive search
+        static constexpr std::size_t n_nodes = 500'000;
+        auto g = DiGraph<std::size_t>();
+        auto prev = g.add_node(0);
+        const auto first = prev;
+        for (std::size_t i = 1; i < n_nodes; ++i)
+        {
+            const auto n = g.add_node(i);
+            g.add_edge(prev, n);
+            prev = n;
+        }
+        const auto last = prev;
+
+        CHECK(is_reachable(g, first, last));
+        CHECK_FALSE(is_reachable(g, last, first));
+
+        using node_id = typename decltype(g)::node_id;
+        auto sorted = std::vector<node_id>();
+        sorted.reserve(n_nodes);
+        topological_sort_for_each_node_id(g, [&sorted](node_id n) { sorted.push_back(n); });
+        REQUIRE_EQ(sorted.size(), n_nodes);
+        CHECK(std::is_sorted(sorted.cbegin(), sorted.cend()));
+    }
 }
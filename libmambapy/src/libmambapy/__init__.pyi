@@ -452,6 +452,30 @@ class Context:
         def connect_timeout_secs(self, arg0: float) -> None:
             pass
         @property
+        def max_download_speed(self) -> int:
+            """
+            :type: int
+            """
+        @max_download_speed.setter
+        def max_download_speed(self, arg0: int) -> None:
+            pass
+        @property
+        def max_host_connections(self) -> int:
+            """
+            :type: int
+            """
+        @max_host_connections.setter
+        def max_host_connections(self, arg0: int) -> None:
+            pass
+        @property
+        def max_host_download_speed(self) -> int:
+            """
+            :type: int
+            """
+        @max_host_download_speed.setter
+        def max_host_download_speed(self, arg0: int) -> None:
+            pass
+        @property
         def max_retries(self) -> int:
             """
             :type: int
@@ -1718,8 +1742,8 @@ def sign(data: str, secret_key: str) -> str:
 def simplify_conflicts(arg0: ProblemsGraph) -> ProblemsGraph:
     pass
 
+@typing.overload
 def transmute(
-    context: Context,
     source_package: Path,
     destination_package: Path,
     compression_level: int,
@@ -1727,6 +1751,18 @@ def transmute(
 ) -> bool:
     pass
 
+@typing.overload
+def transmute(
+    context: Context,
+    source_package: Path,
+    destination_package: Path,
+    compression_level: int,
+    compression_threads: int = 1,
+) -> bool:
+    """
+    Deprecated, the context argument is ignored.
+    """
+
 MAMBA_CLEAN_ALL = 1
 MAMBA_CLEAN_INDEX = 2
 MAMBA_CLEAN_LOCKS = 16
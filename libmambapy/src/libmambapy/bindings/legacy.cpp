@@ -421,7 +421,8 @@ bind_submodule_impl(pybind11::module_ m)
         &load_subdir_in_database,
         py::arg("context"),
         py::arg("database"),
-        py::arg("subdir")
+        py::arg("subdir"),
+        py::call_guard<py::gil_scoped_release>()
     );
 
     m.def(
@@ -429,7 +430,8 @@ bind_submodule_impl(pybind11::module_ m)
         &load_installed_packages_in_database,
         py::arg("context"),
         py::arg("database"),
-        py::arg("prefix_data")
+        py::arg("prefix_data"),
+        py::call_guard<py::gil_scoped_release>()
     );
 
     py::class_<MultiPackageCache>(m, "MultiPackageCache")
@@ -455,9 +457,13 @@ bind_submodule_impl(pybind11::module_ m)
         .def("to_conda", &MTransaction::to_conda)
         .def("log_json", &MTransaction::log_json)
         .def("print", &MTransaction::print)
-        .def("fetch_extract_packages", &MTransaction::fetch_extract_packages)
+        .def(
+            "fetch_extract_packages",
+            &MTransaction::fetch_extract_packages,
+            py::call_guard<py::gil_scoped_release>()
+        )
         .def("prompt", &MTransaction::prompt)
-        .def("execute", &MTransaction::execute);
+        .def("execute", &MTransaction::execute, py::call_guard<py::gil_scoped_release>());
 
     py::class_<History>(m, "History")
         .def(
@@ -591,7 +597,7 @@ bind_submodule_impl(pybind11::module_ m)
             py::arg("repodata_fn"),
             py::arg("url")
         )
-        .def("download", &SubdirIndex::download)
+        .def("download", &SubdirIndex::download, py::call_guard<py::gil_scoped_release>())
         .def("__len__", &SubdirIndex::size)
         .def("__getitem__", &SubdirIndex::operator[])
         .def(
@@ -748,6 +754,12 @@ bind_submodule_impl(pybind11::module_ m)
         .def_readwrite("user_agent", &Context::RemoteFetchParams::user_agent)
         // .def_readwrite("read_timeout_secs", &Context::RemoteFetchParams::read_timeout_secs)
         .def_readwrite("proxy_servers", &Context::RemoteFetchParams::proxy_servers)
+        .def_readwrite("max_host_connections", &Context::RemoteFetchParams::max_host_connections)
+        .def_readwrite("max_download_speed", &Context::RemoteFetchParams::max_download_speed)
+        .def_readwrite(
+            "max_host_download_speed",
+            &Context::RemoteFetchParams::max_host_download_speed
+        )
         .def_readwrite("connect_timeout_secs", &Context::RemoteFetchParams::connect_timeout_secs);
 
     py::class_<Context::OutputParams>(ctx, "OutputParams")
@@ -1184,14 +1196,23 @@ bind_submodule_impl(pybind11::module_ m)
 
     m.def(
         "transmute",
-        +[](Context& context,
+        py::overload_cast<const fs::u8path&, const fs::u8path&, int, int>(&transmute),
+        py::arg("source_package"),
+        py::arg("destination_package"),
+        py::arg("compression_level"),
+        py::arg("compression_threads") = 1
+    );
+
+    m.def(
+        "transmute",
+        +[](Context& /* context */,
             const fs::u8path& pkg_file,
             const fs::u8path& target,
             int compression_level,
             int compression_threads)
         {
-            const auto extract_options = mamba::ExtractOptions::from_context(context);
-            return transmute(pkg_file, target, compression_level, compression_threads, extract_options);
+            deprecated("The context argument is ignored, call ``transmute`` without it.", "2.0");
+            return transmute(pkg_file, target, compression_level, compression_threads);
         },
         py::arg("context"),
         py::arg("source_package"),
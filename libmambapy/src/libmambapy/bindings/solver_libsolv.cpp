@@ -9,6 +9,7 @@
 #include <pybind11/pybind11.h>
 
 #include "mamba/solver/libsolv/database.hpp"
+#include "mamba/solver/libsolv/package_table.hpp"
 #include "mamba/solver/libsolv/parameters.hpp"
 #include "mamba/solver/libsolv/repo_info.hpp"
 #include "mamba/solver/libsolv/solver.hpp"
@@ -21,6 +22,63 @@
 
 namespace mambapy
 {
+    namespace
+    {
+        /** A read-only view on the memory of a column, keeping the column alive. */
+        struct ColumnBuffer
+        {
+            pybind11::object owner;
+            const void* ptr;
+            pybind11::ssize_t size;
+            pybind11::ssize_t itemsize;
+            std::string format;
+        };
+
+        template <typename T>
+        auto make_column_buffer(pybind11::object owner, const T* ptr, std::size_t size)
+            -> ColumnBuffer
+        {
+            return {
+                /* .owner= */ std::move(owner),
+                /* .ptr= */ ptr,
+                /* .size= */ static_cast<pybind11::ssize_t>(size),
+                /* .itemsize= */ static_cast<pybind11::ssize_t>(sizeof(T)),
+                /* .format= */ pybind11::format_descriptor<T>::format(),
+            };
+        }
+
+        template <typename T>
+        auto make_column_buffer(pybind11::object owner, const std::vector<T>& values)
+            -> ColumnBuffer
+        {
+            return make_column_buffer(std::move(owner), values.data(), values.size());
+        }
+
+        auto normalize_index(pybind11::ssize_t idx, std::size_t size) -> std::size_t
+        {
+            const auto ssize = static_cast<pybind11::ssize_t>(size);
+            if (idx < 0)
+            {
+                idx += ssize;
+            }
+            if ((idx < 0) || (idx >= ssize))
+            {
+                throw pybind11::index_error();
+            }
+            return static_cast<std::size_t>(idx);
+        }
+
+        auto strings_to_list(const std::vector<std::string_view>& strings) -> pybind11::list
+        {
+            auto out = pybind11::list(strings.size());
+            for (std::size_t i = 0; i < strings.size(); ++i)
+            {
+                out[i] = pybind11::str(strings[i].data(), strings[i].size());
+            }
+            return out;
+        }
+    }
+
     void bind_submodule_solver_libsolv(pybind11::module_ m)
     {
         namespace py = pybind11;
@@ -116,6 +174,117 @@ namespace mambapy
             .def("__copy__", &copy<RepoInfo>)
             .def("__deepcopy__", &deepcopy<RepoInfo>, py::arg("memo"));
 
+        py::class_<ColumnBuffer>(m, "ColumnBuffer", py::buffer_protocol())
+            .def_buffer(
+                [](ColumnBuffer& self) -> py::buffer_info
+                {
+                    return {
+                        const_cast<void*>(self.ptr),
+                        self.itemsize,
+                        self.format,
+                        1,
+                        { self.size },
+                        { self.itemsize },
+                        /* readonly= */ true,
+                    };
+                }
+            )
+            .def("__len__", [](const ColumnBuffer& self) { return self.size; });
+
+        py::class_<StringColumn>(m, "StringColumn")
+            .def("__len__", &StringColumn::size)
+            .def(
+                "__getitem__",
+                [](const StringColumn& self, py::ssize_t idx)
+                { return self[normalize_index(idx, self.size())]; },
+                py::arg("index")
+            )
+            .def(
+                "to_list",
+                [](const StringColumn& self)
+                {
+                    auto out = py::list(self.size());
+                    for (std::size_t i = 0; i < self.size(); ++i)
+                    {
+                        const auto str = self[i];
+                        out[i] = py::str(str.data(), str.size());
+                    }
+                    return out;
+                }
+            )
+            .def_property_readonly(
+                "data",
+                [](py::object self)
+                {
+                    const auto& data = self.cast<const StringColumn&>().data();
+                    return make_column_buffer(
+                        self,
+                        reinterpret_cast<const std::uint8_t*>(data.data()),
+                        data.size()
+                    );
+                }
+            )
+            .def_property_readonly(
+                "offsets",
+                [](py::object self)
+                { return make_column_buffer(self, self.cast<const StringColumn&>().offsets()); }
+            );
+
+        py::class_<StringListColumn>(m, "StringListColumn")
+            .def("__len__", &StringListColumn::size)
+            .def(
+                "__getitem__",
+                [](const StringListColumn& self, py::ssize_t idx)
+                { return strings_to_list(self[normalize_index(idx, self.size())]); },
+                py::arg("index")
+            )
+            .def(
+                "to_list",
+                [](const StringListColumn& self)
+                {
+                    auto out = py::list(self.size());
+                    for (std::size_t i = 0; i < self.size(); ++i)
+                    {
+                        out[i] = strings_to_list(self[i]);
+                    }
+                    return out;
+                }
+            )
+            .def_property_readonly(
+                "values",
+                &StringListColumn::values,
+                py::return_value_policy::reference_internal
+            )
+            .def_property_readonly(
+                "offsets",
+                [](py::object self)
+                { return make_column_buffer(self, self.cast<const StringListColumn&>().offsets()); }
+            );
+
+        constexpr auto numeric_column = [](std::vector<std::uint64_t> PackageTable::*column)
+        {
+            return [column](py::object self)
+            { return make_column_buffer(self, self.cast<const PackageTable&>().*column); };
+        };
+
+        py::class_<PackageTable>(m, "PackageTable")
+            .def("__len__", &PackageTable::package_count)
+            .def_readonly("name", &PackageTable::name)
+            .def_readonly("version", &PackageTable::version)
+            .def_readonly("build_string", &PackageTable::build_string)
+            .def_property_readonly("build_number", numeric_column(&PackageTable::build_number))
+            .def_readonly("channel", &PackageTable::channel)
+            .def_readonly("package_url", &PackageTable::package_url)
+            .def_readonly("platform", &PackageTable::platform)
+            .def_readonly("filename", &PackageTable::filename)
+            .def_readonly("license", &PackageTable::license)
+            .def_readonly("md5", &PackageTable::md5)
+            .def_readonly("sha256", &PackageTable::sha256)
+            .def_property_readonly("size", numeric_column(&PackageTable::size))
+            .def_property_readonly("timestamp", numeric_column(&PackageTable::timestamp))
+            .def_readonly("dependencies", &PackageTable::dependencies)
+            .def_readonly("constrains", &PackageTable::constrains);
+
         py::class_<Database>(m, "Database")
             .def(py::init<specs::ChannelResolveParams>(), py::arg("channel_params"))
             .def("set_logger", &Database::set_logger, py::call_guard<py::gil_scoped_acquire>())
@@ -128,7 +297,8 @@ namespace mambapy
                 py::arg("add_pip_as_python_dependency") = PipAsPythonDependency::No,
                 py::arg("package_types") = PackageTypes::CondaOrElseTarBz2,
                 py::arg("verify_packages") = VerifyPackages::No,
-                py::arg("repodata_parser") = RepodataParser::Mamba
+                py::arg("repodata_parser") = RepodataParser::Mamba,
+                py::call_guard<py::gil_scoped_release>()
             )
             .def(
                 "add_repo_from_native_serialization",
@@ -136,7 +306,8 @@ namespace mambapy
                 py::arg("path"),
                 py::arg("expected"),
                 py::arg("channel_id"),
-                py::arg("add_pip_as_python_dependency") = PipAsPythonDependency::No
+                py::arg("add_pip_as_python_dependency") = PipAsPythonDependency::No,
+                py::call_guard<py::gil_scoped_release>()
             )
             .def(
                 "add_repo_from_packages",
@@ -148,6 +319,7 @@ namespace mambapy
                     {
                         pkg_infos.push_back(pkg.cast<specs::PackageInfo>());
                     }
+                    py::gil_scoped_release release;
                     return db.add_repo_from_packages(pkg_infos, name, add);
                 },
                 py::arg("packages"),
@@ -159,7 +331,8 @@ namespace mambapy
                 &Database::native_serialize_repo,
                 py::arg("repo"),
                 py::arg("path"),
-                py::arg("metadata")
+                py::arg("metadata"),
+                py::call_guard<py::gil_scoped_release>()
             )
             .def("set_installed_repo", &Database::set_installed_repo, py::arg("repo"))
             .def("installed_repo", &Database::installed_repo)
@@ -182,6 +355,17 @@ namespace mambapy
                 },
                 py::arg("repo")
             )
+            .def(
+                "package_table",
+                &Database::package_table,
+                py::call_guard<py::gil_scoped_release>()
+            )
+            .def(
+                "package_table_in_repo",
+                &Database::package_table_in_repo,
+                py::arg("repo"),
+                py::call_guard<py::gil_scoped_release>()
+            )
             .def(
                 "packages_matching",
                 [](Database& db, const specs::MatchSpec& ms)
@@ -237,7 +421,10 @@ namespace mambapy
             .def(
                 "solve",
                 [](Solver& self, Database& db, const solver::Request& request)
-                { return self.solve(db, request); }
+                { return self.solve(db, request); },
+                py::arg("database"),
+                py::arg("request"),
+                py::call_guard<py::gil_scoped_release>()
             )
             .def("add_jobs", solver_job_v2_migrator)
             .def("add_global_job", solver_job_v2_migrator)
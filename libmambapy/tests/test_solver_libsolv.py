@@ -1,3 +1,4 @@
+import concurrent.futures
 import copy
 import json
 import itertools
@@ -165,6 +166,41 @@ def test_Database_RepoInfo_from_packages(add_pip_as_python_dependency):
     assert db.installed_repo() is None
 
 
+def test_Database_package_table():
+    db = libsolv.Database(libmambapy.specs.ChannelResolveParams())
+    repo1 = db.add_repo_from_packages(
+        [
+            libmambapy.specs.PackageInfo(name="x", version="1.0", build_number=3, size=10),
+            libmambapy.specs.PackageInfo(name="z", version="2.0", depends=["x>=1.0"]),
+        ],
+    )
+    repo2 = db.add_repo_from_packages([libmambapy.specs.PackageInfo(name="python")])
+
+    table = db.package_table()
+    assert len(table) == 3
+    assert table.name.to_list() == ["x", "z", "python"]
+    assert table.version[1] == "2.0"
+    assert table.name[-1] == "python"
+    with pytest.raises(IndexError):
+        table.name[3]
+
+    # Columns are exported with the memory layout of Arrow arrays
+    assert bytes(memoryview(table.name.data)) == b"xzpython"
+    assert memoryview(table.name.offsets).tolist() == [0, 1, 2, 8]
+    assert memoryview(table.build_number).tolist() == [3, 0, 0]
+    assert memoryview(table.size).tolist() == [10, 0, 0]
+
+    deps = table.dependencies
+    assert len(deps) == 3
+    assert [len(d) for d in deps.to_list()] == [0, 1, 0]
+    assert deps[1][0].startswith("x")
+    assert memoryview(deps.offsets).tolist() == [0, 0, 1, 1]
+    assert len(deps.values) == 1
+
+    assert db.package_table_in_repo(repo1).name.to_list() == ["x", "z"]
+    assert db.package_table_in_repo(repo2).name.to_list() == ["python"]
+
+
 @pytest.fixture
 def tmp_repodata_json(tmp_path):
     file = tmp_path / "repodata.json"
@@ -298,3 +334,28 @@ def test_Solver_Solution():
 
     assert isinstance(outcome, libmambapy.solver.Solution)
     assert len(outcome.actions) == 1
+
+
+def test_Solver_concurrent_databases(tmp_repodata_json):
+    Request = libmambapy.solver.Request
+
+    def load_and_solve(parser):
+        db = libsolv.Database(libmambapy.specs.ChannelResolveParams())
+        messages = []
+        db.set_logger(lambda level, msg: messages.append(msg))
+        db.add_repo_from_repodata_json(
+            path=tmp_repodata_json,
+            url="https://repo.mamba.pm/conda-forge",
+            channel_id="conda-forge",
+            repodata_parser=parser,
+        )
+        request = Request([Request.Install(libmambapy.specs.MatchSpec.parse("foo"))])
+        return libsolv.Solver().solve(db, request)
+
+    # The GIL is released in long running calls, separate databases can be used concurrently
+    parsers = ["Mamba", "Libsolv"] * 8
+    with concurrent.futures.ThreadPoolExecutor(max_workers=4) as executor:
+        outcomes = list(executor.map(load_and_solve, parsers))
+
+    assert all(isinstance(o, libmambapy.solver.Solution) for o in outcomes)
+    assert all(len(o.actions) == 1 for o in outcomes)
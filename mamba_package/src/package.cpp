@@ -104,8 +104,7 @@ set_package_command(CLI::App* com, mamba::Context& context)
                 fs::absolute(infile),
                 fs::absolute(dest),
                 compression_level,
-                compression_threads,
-                ExtractOptions::from_context(context)
+                compression_threads
             );
         }
     );
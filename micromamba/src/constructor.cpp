@@ -4,14 +4,25 @@
 //
 // The full license is in the file LICENSE, distributed with this software.
 
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include <CLI/App.hpp>
+#include <nlohmann/json.hpp>
 
 #include "constructor.hpp"
 #include "mamba/api/configuration.hpp"
 #include "mamba/api/install.hpp"
+#include "mamba/core/package_store.hpp"
 #include "mamba/core/package_handling.hpp"
 #include "mamba/core/subdirdata.hpp"
+#include "mamba/core/thread_utils.hpp"
 #include "mamba/core/util.hpp"
+#include "mamba/specs/archive.hpp"
 #include "mamba/util/string.hpp"
 
 
@@ -64,6 +75,91 @@ set_constructor_command(CLI::App* subcom, mamba::Configuration& config)
     );
 }
 
+namespace
+{
+    auto repodata_cache_name(const specs::PackageInfo& pkg_info) -> std::string
+    {
+        std::string channel_url;
+        if (pkg_info.package_url.size() > pkg_info.filename.size())
+        {
+            channel_url = pkg_info.package_url.substr(
+                0,
+                pkg_info.package_url.size() - pkg_info.filename.size()
+            );
+        }
+        return util::concat(cache_name_from_url(channel_url), ".json");
+    }
+
+    void extract_package(
+        const fs::u8path& pkgs_dir,
+        const specs::PackageInfo& pkg_info,
+        nlohmann::json repodata_record,
+        const ExtractOptions& options,
+        bool subprocess
+    )
+    {
+        fs::u8path entry = pkgs_dir / pkg_info.filename;
+        fs::u8path base_path = pkgs_dir / specs::strip_archive_extension(pkg_info.filename);
+        LOG_TRACE << "Extracting " << pkg_info.filename << std::endl;
+
+        // In-process extractions change the working directory and cannot run concurrently
+        if (subprocess)
+        {
+            extract_subproc(entry, base_path, options);
+        }
+        else
+        {
+            extract(entry, base_path, options);
+        }
+        if (options.content_store)
+        {
+            deduplicate_package_files(base_path, content_store_path(pkgs_dir));
+        }
+
+        fs::u8path repodata_record_path = base_path / "info" / "repodata_record.json";
+        fs::u8path index_path = base_path / "info" / "index.json";
+
+        nlohmann::json index;
+        std::ifstream index_file{ index_path.std_path() };
+        index_file >> index;
+
+        if (!repodata_record.is_null())
+        {
+            // update values from index if there are any that are not part of the
+            // repodata_record.json yet
+            repodata_record.insert(index.cbegin(), index.cend());
+        }
+        else
+        {
+            LOG_WARNING << "Did not find a repodata record for " << pkg_info.package_url;
+            repodata_record = index;
+
+            repodata_record["size"] = fs::file_size(entry);
+            if (!pkg_info.md5.empty())
+            {
+                repodata_record["md5"] = pkg_info.md5;
+            }
+            if (!pkg_info.sha256.empty())
+            {
+                repodata_record["sha256"] = pkg_info.sha256;
+            }
+        }
+
+        repodata_record["fn"] = pkg_info.filename;
+        repodata_record["url"] = pkg_info.package_url;
+        repodata_record["channel"] = pkg_info.channel;
+
+        if (repodata_record.find("size") == repodata_record.end() || repodata_record["size"] == 0)
+        {
+            repodata_record["size"] = fs::file_size(entry);
+        }
+
+        LOG_TRACE << "Writing " << repodata_record_path;
+        std::ofstream repodata_record_of{ repodata_record_path.std_path() };
+        repodata_record_of << repodata_record.dump(4);
+    }
+}
+
 void
 construct(Configuration& config, const fs::u8path& prefix, bool extract_conda_pkgs, bool extract_tarball)
 {
@@ -75,111 +171,70 @@ construct(Configuration& config, const fs::u8path& prefix, bool extract_conda_pk
         );
     config.load();
 
-    std::map<std::string, nlohmann::json> repodatas;
-
     if (extract_conda_pkgs)
     {
-        auto find_package = [](nlohmann::json& j, const std::string& fn) -> nlohmann::json
-        {
-            try
-            {
-                if (util::ends_with(fn, ".tar.bz2"))
-                {
-                    return j.at("packages").at(fn);
-                }
-                else if (util::ends_with(fn, ".conda"))
-                {
-                    return j.at("packages.conda").at(fn);
-                }
-            }
-            catch (nlohmann::json::out_of_range& /*e*/)
-            { /* */
-            }
-            LOG_WARNING << "Could not find entry in repodata cache for " << fn;
-            return {};
-        };
         fs::u8path pkgs_dir = prefix / "pkgs";
         fs::u8path urls_file = pkgs_dir / "urls";
 
+        auto pkg_infos = std::vector<specs::PackageInfo>();
         for (const auto& raw_url : read_lines(urls_file))
         {
-            auto pkg_info = specs::PackageInfo::from_url(raw_url)
-                                .or_else([](specs::ParseError&& err) { throw std::move(err); })
-                                .value();
-
-            fs::u8path entry = pkgs_dir / pkg_info.filename;
-            LOG_TRACE << "Extracting " << pkg_info.filename << std::endl;
-            std::cout << "Extracting " << pkg_info.filename << std::endl;
-
-            fs::u8path base_path = extract(entry, ExtractOptions::from_context(config.context()));
-
-            fs::u8path repodata_record_path = base_path / "info" / "repodata_record.json";
-            fs::u8path index_path = base_path / "info" / "index.json";
-
-            std::string channel_url;
-            if (pkg_info.package_url.size() > pkg_info.filename.size())
-            {
-                channel_url = pkg_info.package_url.substr(
-                    0,
-                    pkg_info.package_url.size() - pkg_info.filename.size()
-                );
-            }
-            std::string repodata_cache_name = util::concat(cache_name_from_url(channel_url), ".json");
-            fs::u8path repodata_location = pkgs_dir / "cache" / repodata_cache_name;
+            pkg_infos.push_back(specs::PackageInfo::from_url(raw_url)
+                                    .or_else([](specs::ParseError&& err) { throw std::move(err); })
+                                    .value());
+        }
 
-            nlohmann::json repodata_record;
+        // Read each repodata cache once, only materializing the records of our packages
+        auto filenames_by_cache = std::map<std::string, std::vector<std::string>>();
+        for (const auto& pkg_info : pkg_infos)
+        {
+            filenames_by_cache[repodata_cache_name(pkg_info)].push_back(pkg_info.filename);
+        }
+        using record_map = std::unordered_map<std::string, nlohmann::json>;
+        auto records_by_cache = std::map<std::string, record_map>();
+        for (const auto& [cache_name, filenames] : filenames_by_cache)
+        {
+            fs::u8path repodata_location = pkgs_dir / "cache" / cache_name;
             if (fs::exists(repodata_location))
             {
-                if (repodatas.find(repodata_cache_name) == repodatas.end())
-                {
-                    auto infile = open_ifstream(repodata_location);
-                    nlohmann::json j;
-                    infile >> j;
-                    repodatas[repodata_cache_name] = j;
-                }
-                auto& j = repodatas[repodata_cache_name];
-                repodata_record = find_package(j, pkg_info.filename);
+                records_by_cache[cache_name] = read_repodata_records(repodata_location, filenames);
             }
+        }
 
-            nlohmann::json index;
-            std::ifstream index_file{ index_path.std_path() };
-            index_file >> index;
-
-            if (!repodata_record.is_null())
+        const auto find_record = [&](const specs::PackageInfo& pkg_info) -> nlohmann::json
+        {
+            const auto cache_it = records_by_cache.find(repodata_cache_name(pkg_info));
+            if (cache_it == records_by_cache.cend())
             {
-                // update values from index if there are any that are not part of the
-                // repodata_record.json yet
-                repodata_record.insert(index.cbegin(), index.cend());
+                return {};
             }
-            else
+            const auto record_it = cache_it->second.find(pkg_info.filename);
+            if (record_it == cache_it->second.cend())
             {
-                LOG_WARNING << "Did not find a repodata record for " << pkg_info.package_url;
-                repodata_record = index;
-
-                repodata_record["size"] = fs::file_size(entry);
-                if (!pkg_info.md5.empty())
-                {
-                    repodata_record["md5"] = pkg_info.md5;
-                }
-                if (!pkg_info.sha256.empty())
-                {
-                    repodata_record["sha256"] = pkg_info.sha256;
-                }
+                LOG_WARNING << "Could not find entry in repodata cache for " << pkg_info.filename;
+                return {};
             }
+            return record_it->second;
+        };
 
-            repodata_record["fn"] = pkg_info.filename;
-            repodata_record["url"] = pkg_info.package_url;
-            repodata_record["channel"] = pkg_info.channel;
-
-            if (repodata_record.find("size") == repodata_record.end() || repodata_record["size"] == 0)
+        // Extractions are independent, they run in parallel following the extract_threads setting
+        const auto threads_count = local_threads_count(config.context().threads_params);
+        const auto options = ExtractOptions::from_context(config.context());
+        const bool subprocess = std::min(threads_count, pkg_infos.size()) > 1;
+        std::mutex print_mutex;
+        parallel_for_each(
+            threads_count,
+            pkg_infos.size(),
+            [&](std::size_t i)
             {
-                repodata_record["size"] = fs::file_size(entry);
+                const auto& pkg_info = pkg_infos[i];
+                {
+                    std::lock_guard<std::mutex> lock(print_mutex);
+                    std::cout << "Extracting " << pkg_info.filename << std::endl;
+                }
+                extract_package(pkgs_dir, pkg_info, find_record(pkg_info), options, subprocess);
             }
-
-            LOG_TRACE << "Writing " << repodata_record_path;
-            std::ofstream repodata_record_of{ repodata_record_path.std_path() };
-            repodata_record_of << repodata_record.dump(4);
-        }
+        );
     }
 
     if (extract_tarball)
@@ -129,10 +129,15 @@ set_env_command(CLI::App* com, Configuration& config)
             config.load();
 
             auto channel_context = mamba::ChannelContext::make_conda_compatible(ctx);
+            // TODO: handle error
+            auto exp_prefix_data = PrefixData::create(
+                ctx.prefix_params.target_prefix,
+                channel_context,
+                local_threads_count(ctx.threads_params)
+            );
+            auto& pd = exp_prefix_data.value();
             if (explicit_format)
             {
-                // TODO: handle error
-                auto pd = PrefixData::create(ctx.prefix_params.target_prefix, channel_context).value();
                 auto records = pd.sorted_records();
                 std::cout << "# This file may be used to create an environment using:\n"
                           << "# $ conda create --name <env> --file <this file>\n"
@@ -165,7 +170,6 @@ set_env_command(CLI::App* com, Configuration& config)
             }
             else
             {
-                auto pd = PrefixData::create(ctx.prefix_params.target_prefix, channel_context).value();
                 History& hist = pd.history();
 
                 const auto& versions_map = pd.records();
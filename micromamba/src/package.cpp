@@ -123,8 +123,7 @@ set_package_command(CLI::App* subcom, Configuration& config)
                 fs::absolute(infile),
                 fs::absolute(dest),
                 compression_level,
-                compression_threads,
-                ExtractOptions::from_context(config.context())
+                compression_threads
             );
         }
     );
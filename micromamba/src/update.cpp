@@ -34,7 +34,7 @@ namespace
         bool found = false;
         database.for_each_package_matching(
             spec,
-            [&](const auto&)
+            [&](const solver::libsolv::PackageView&)
             {
                 found = true;
                 return util::LoopControl::Break;
@@ -46,20 +46,25 @@ namespace
     auto database_latest_package(solver::libsolv::Database& db, specs::MatchSpec spec)
         -> std::optional<specs::PackageInfo>
     {
-        auto out = std::optional<specs::PackageInfo>();
+        auto latest = std::optional<solver::libsolv::PackageView>();
+        auto latest_version = specs::Version();
         db.for_each_package_matching(
             spec,
-            [&](auto pkg)
+            [&](const solver::libsolv::PackageView& pkg)
             {
-                if (!out
-                    || (specs::Version::parse(pkg.version).value_or(specs::Version())
-                        > specs::Version::parse(out->version).value_or(specs::Version())))
+                auto version = specs::Version::parse(pkg.version()).value_or(specs::Version());
+                if (!latest || (version > latest_version))
                 {
-                    out = std::move(pkg);
+                    latest = pkg;
+                    latest_version = std::move(version);
                 }
             }
         );
-        return out;
+        if (latest)
+        {
+            return latest->to_package_info();
+        }
+        return std::nullopt;
     };
 }
 
@@ -126,7 +131,11 @@ update_self(Configuration& config, const std::optional<std::string>& version)
 
     ctx.download_only = true;
     MTransaction t(ctx, db, { latest_micromamba.value() }, package_caches);
-    auto exp_prefix_data = PrefixData::create(ctx.prefix_params.root_prefix, channel_context);
+    auto exp_prefix_data = PrefixData::create(
+        ctx.prefix_params.root_prefix,
+        channel_context,
+        local_threads_count(ctx.threads_params)
+    );
     if (!exp_prefix_data)
     {
         throw exp_prefix_data.error();
@@ -0,0 +1,97 @@
+import json
+import os
+
+import pytest
+
+from . import helpers
+
+
+def make_package_folder(pkgs_dir, name, size=1000):
+    folder = pkgs_dir / name
+    (folder / "info").mkdir(parents=True)
+    (folder / "info" / "index.json").write_text(json.dumps({"name": name.split("-")[0]}))
+    (folder / "lib").mkdir()
+    (folder / "lib" / "data.bin").write_bytes(b"\0" * size)
+    paths = {"paths": [{"_path": "lib/data.bin", "size_in_bytes": size}], "paths_version": 1}
+    (folder / "info" / "paths.json").write_text(json.dumps(paths))
+    return folder
+
+
+def make_env(root_prefix, env_name, pkg_names):
+    conda_meta = root_prefix / "envs" / env_name / "conda-meta"
+    conda_meta.mkdir(parents=True)
+    for pkg_name in pkg_names:
+        name, version, build = pkg_name.split("-")
+        record = {
+            "name": name,
+            "version": version,
+            "build": build,
+            "build_number": 0,
+            "channel": "conda-forge",
+            "subdir": "noarch",
+            "fn": f"{pkg_name}.tar.bz2",
+            "depends": [],
+        }
+        (conda_meta / f"{pkg_name}.json").write_text(json.dumps(record))
+
+
+def output_line(output, pattern):
+    return next(line.strip() for line in output.splitlines() if pattern in line)
+
+
+@pytest.fixture
+def tmp_cache_with_env(tmp_home, tmp_root_prefix):
+    pkgs_dir = tmp_root_prefix / "pkgs"
+    unused = [make_package_folder(pkgs_dir, f"unused{i}-1.0-0", size=1000 * i) for i in range(50)]
+    used = make_package_folder(pkgs_dir, "used-1.0-0")
+    make_env(tmp_root_prefix, "env", ["used-1.0-0"])
+    yield pkgs_dir, used, unused
+
+
+def test_clean_packages_dry_run(tmp_cache_with_env):
+    pkgs_dir, used, unused = tmp_cache_with_env
+
+    res = helpers.clean("--packages", "--dry-run")
+
+    assert f"{len(unused)} entries" in res
+    # The recorded package sizes are read instead of walking the folders
+    assert "Estimated total size" in res
+    assert all(folder.exists() for folder in unused)
+    assert used.exists()
+    # Loading the environment does not write into it
+    assert not (pkgs_dir.parent / "envs" / "env" / "conda-meta" / ".mamba-prefix-index").exists()
+
+
+@pytest.mark.parametrize("extract_threads", [1, 4])
+def test_clean_packages(tmp_cache_with_env, monkeypatch, extract_threads):
+    pkgs_dir, used, unused = tmp_cache_with_env
+    monkeypatch.setenv("MAMBA_EXTRACT_THREADS", str(extract_threads))
+
+    dry_run_res = helpers.clean("--packages", "--dry-run")
+    res = helpers.clean("--packages", no_dry_run=True)
+
+    assert "Estimated total size" in dry_run_res
+    assert "Estimated total size" not in res
+    assert "Total size" in res
+    assert not any(folder.exists() for folder in unused)
+    assert used.exists()
+
+
+def test_clean_packages_content_store(tmp_home, tmp_root_prefix):
+    pkgs_dir = tmp_root_prefix / "pkgs"
+    folder = make_package_folder(pkgs_dir, "stored-1.0-0", size=5_000_000)
+    store_entry = pkgs_dir / "store" / "00" / "data"
+    store_entry.parent.mkdir(parents=True)
+    os.link(folder / "lib" / "data.bin", store_entry)
+
+    # Files linked to the store are only freed by collecting the store entries
+    dry_run_res = helpers.clean("--packages", "--dry-run")
+    assert "Estimated total size" not in dry_run_res
+    assert "MB" not in output_line(dry_run_res, "Total size")
+    assert store_entry.exists()
+
+    res = helpers.clean("--packages", no_dry_run=True)
+    assert "MB" not in output_line(res, "Total size")
+    assert "MB" in output_line(res, "Removed content store entries")
+    assert not folder.exists()
+    assert not store_entry.exists()
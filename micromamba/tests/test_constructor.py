@@ -1,8 +1,12 @@
 import glob
+import hashlib
 import json
 import os
 import shutil
 import subprocess
+from pathlib import Path
+
+import pytest
 
 from . import helpers
 
@@ -83,3 +87,38 @@ class TestInstall:
             assert repodata_record["md5"] == "123412341234"
             assert repodata_record["url"] == "http://testurl.com/conda-forge/linux-64/" + pkg
             assert repodata_record["depends"] == index["depends"]
+
+
+@pytest.mark.parametrize("extract_threads", [1, 4])
+def test_extract_many_pkgs(tmp_home, tmp_root_prefix, tmp_path, monkeypatch, extract_threads):
+    pkgs_dir = tmp_path / "installer" / "pkgs"
+    (pkgs_dir / "cache").mkdir(parents=True)
+    channel_url = "http://testurl.com/conda-forge/linux-64/"
+    filenames = [f"cph_test_data-0.0.1-{i}.tar.bz2" for i in range(6)]
+    for fn in filenames:
+        shutil.copy(Path(__file__).parent / "data" / "cph_test_data-0.0.1-0.tar.bz2", pkgs_dir / fn)
+    (pkgs_dir / "urls").write_text("\n".join(channel_url + fn for fn in filenames))
+
+    # Repodata records for all packages but the last one
+    repodata = {
+        "info": {"subdir": "linux-64"},
+        "packages": {fn: {"license": f"license-{i}"} for i, fn in enumerate(filenames[:-1])},
+        "packages.conda": {},
+    }
+    cache_name = hashlib.md5(channel_url.encode()).hexdigest()[:8] + ".json"
+    (pkgs_dir / "cache" / cache_name).write_text(json.dumps(repodata))
+
+    monkeypatch.setenv("MAMBA_EXTRACT_THREADS", str(extract_threads))
+    constructor("--prefix", str(pkgs_dir.parent), "--extract-conda-pkgs")
+
+    for i, fn in enumerate(filenames):
+        extracted = pkgs_dir / fn.removesuffix(".tar.bz2")
+        assert (extracted / "info" / "index.json").exists()
+        record = json.loads((extracted / "info" / "repodata_record.json").read_text())
+        assert record["fn"] == fn
+        assert record["url"] == channel_url + fn
+        if i < len(filenames) - 1:
+            assert record["license"] == f"license-{i}"
+        else:
+            assert record.get("license") != f"license-{i}"
+        assert record["size"] == (pkgs_dir / fn).stat().st_size
@@ -1,3 +1,4 @@
+import json
 import os
 import platform
 import shutil
@@ -879,6 +880,17 @@ def test_pyc_compilation(tmp_home, tmp_root_prefix, version, build, cache_tag):
     assert (site_packages / pyc_fn).exists()
     assert pyc_fn.name in six_meta
 
+    # The compiled files are cached in the extracted package and reused by other environments
+    six_meta = next((env_prefix / "conda-meta").glob("six-*.json")).read_text()
+    extracted_dir = Path(json.loads(six_meta)["extracted_package_dir"])
+    cached_pyc = extracted_dir / "info" / "pyc_cache" / version / "site-packages" / pyc_fn
+    assert cached_pyc.exists()
+
+    other_prefix = tmp_root_prefix / "envs" / "otherenv"
+    helpers.create("-n", "otherenv", *cmd[2:])
+    other_site_packages = other_prefix / site_packages.relative_to(env_prefix)
+    assert (other_site_packages / pyc_fn).read_bytes() == cached_pyc.read_bytes()
+
 
 @pytest.mark.parametrize("shared_pkgs_dirs", [True], indirect=True)
 def test_create_check_dirs(tmp_home, tmp_root_prefix):
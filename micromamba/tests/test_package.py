@@ -138,6 +138,43 @@ def test_extract_compress(cph_test_file: Path, tmp_path: Path):
     assert_sorted(names[: len(info_files)])
 
 
+def assert_create_archive_order(names):
+    info_files = [f for f in names if f.startswith("info/")]
+    assert names[: len(info_files)] == info_files
+    assert_sorted(names[: len(info_files)])
+    assert_sorted(names[len(info_files) :])
+
+
+def test_transmute_round_trip(cph_test_file: Path, tmp_path: Path):
+    shutil.copy(cph_test_file, tmp_path)
+    stem = cph_test_file.name.removesuffix(".tar.bz2")
+
+    mamba_exe = helpers.get_umamba()
+    subprocess.check_call([mamba_exe, "package", "transmute", str(tmp_path / cph_test_file.name)])
+    as_conda = tmp_path / "out" / f"{stem}.conda"
+    as_conda.parent.mkdir()
+    shutil.move(tmp_path / as_conda.name, as_conda)
+    subprocess.check_call([mamba_exe, "package", "transmute", str(as_conda)])
+
+    # The unsorted source gives packages ordered like the ones created from a directory
+    with zipfile.ZipFile(as_conda) as zip_ref:
+        for part in ("info", "pkg"):
+            with zip_ref.open(f"{part}-{stem}.tar.zst") as fi:
+                dcf = zstandard.ZstdDecompressor().stream_reader(fi)
+                with tarfile.open(fileobj=dcf, mode="r|") as z:
+                    assert_sorted(z.getnames())
+
+    round_trip = tmp_path / "out" / cph_test_file.name
+    assert_create_archive_order(tarfile.open(round_trip).getnames())
+    compare_two_tarfiles(tarfile.open(cph_test_file), tarfile.open(round_trip))
+
+    # Transmuting is reproducible
+    first = round_trip.read_bytes()
+    round_trip.unlink()
+    subprocess.check_call([mamba_exe, "package", "transmute", str(as_conda)])
+    assert round_trip.read_bytes() == first
+
+
 def test_transmute(cph_test_file: Path, tmp_path: Path):
     (tmp_path / "cph").mkdir(parents=True)
     (tmp_path / "mm").mkdir(parents=True)
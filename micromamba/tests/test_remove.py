@@ -1,3 +1,4 @@
+import json
 import os
 import sys
 import platform
@@ -83,6 +84,28 @@ def test_remove_force(tmp_home, tmp_root_prefix, tmp_xtensor_env, tmp_env_name):
     assert res["actions"]["PREFIX"] == str(tmp_xtensor_env)
 
 
+@pytest.mark.parametrize("shared_pkgs_dirs", [True], indirect=True)
+def test_remove_prunes_empty_directories(tmp_home, tmp_root_prefix, tmp_xtensor_env, tmp_env_name):
+    xtensor_meta = next((tmp_xtensor_env / "conda-meta").glob("xtensor-[0-9]*.json"))
+    xtensor_files = [
+        tmp_xtensor_env / p["_path"]
+        for p in json.loads(xtensor_meta.read_text())["paths_data"]["paths"]
+    ]
+    xtensor_dirs = {f.parent for f in xtensor_files} - {tmp_xtensor_env}
+
+    res = helpers.remove("xtensor", "-p", tmp_xtensor_env, "--json", "--force", no_dry_run=True)
+    assert res["success"]
+
+    assert not xtensor_meta.exists()
+    for f in xtensor_files:
+        assert not f.exists()
+    for d in xtensor_dirs:
+        # Directories are removed only if empty
+        assert (not d.exists()) or any(d.iterdir())
+    assert not (tmp_xtensor_env / "include" / "xtensor").exists()
+    assert tmp_xtensor_env.exists()
+
+
 @pytest.mark.parametrize("shared_pkgs_dirs", [True], indirect=True)
 def test_remove_no_prune_deps(tmp_home, tmp_root_prefix, tmp_xtensor_env, tmp_env_name):
     helpers.install("xtensor-python", "-n", tmp_env_name, no_dry_run=True)